@@ -0,0 +1,84 @@
+// Copyright 2024 Michael Fabian 'Xaymar' Dirks <info@xaymar.com>
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include <list>
+#include <numeric>
+#include <thread>
+#include "benchmark.hpp"
+#include "stingray_data.hpp"
+#include "stingray_file_table.hpp"
+
+static auto load = hellextractor::benchmark::benchmark("container/load", [](hellextractor::benchmark::state& state) {
+	auto const& containers = state.fixture().containers;
+	for (size_t iteration = 0; iteration < state.iterations(); iteration++) {
+		for (auto const& path : containers) {
+			stingray::data_110000F0 container{path};
+			hellextractor::benchmark::keep(container.files());
+		}
+	}
+	state.items(containers.size());
+});
+
+static auto merge = hellextractor::benchmark::benchmark("container/merge", [](hellextractor::benchmark::state& state) {
+	std::list<stingray::data_110000F0> containers;
+	size_t                             files = 0;
+	for (auto const& path : state.fixture().containers) {
+		files += containers.emplace_back(path).files();
+	}
+
+	// Same as the merge in the extract mode.
+	for (size_t iteration = 0; iteration < state.iterations(); iteration++) {
+		stingray::file_table table;
+		for (auto const& cont : containers) {
+			table.add(cont);
+		}
+
+		std::vector<size_t> rows(table.size());
+		std::iota(rows.begin(), rows.end(), 0);
+		hellextractor::benchmark::keep(table.merge(rows, std::thread::hardware_concurrency(), false).rows.size());
+	}
+	state.items(files);
+});
+
+static auto scan = hellextractor::benchmark::benchmark("container/scan", [](hellextractor::benchmark::state& state) {
+	std::list<stingray::data_110000F0> containers;
+	size_t                             files = 0;
+	for (auto const& path : state.fixture().containers) {
+		files += containers.emplace_back(path).files();
+	}
+
+	// Resolve every file the way the merge and the extraction loop do.
+	for (size_t iteration = 0; iteration < state.iterations(); iteration++) {
+		size_t bytes = 0;
+		for (auto const& cont : containers) {
+			for (size_t i = 0, edx = cont.files(); i < edx; i++) {
+				auto file = cont.meta_unchecked(i);
+				bytes += file.main_size + file.stream_size + file.gpu_size;
+			}
+		}
+		hellextractor::benchmark::keep(bytes);
+	}
+	state.items(files);
+});
+
+static auto select_type = hellextractor::benchmark::benchmark("container/select", [](hellextractor::benchmark::state& state) {
+	std::list<stingray::data_110000F0> containers;
+	stingray::file_table               table;
+	for (auto const& path : state.fixture().containers) {
+		table.add(containers.emplace_back(path));
+	}
+
+	// Pick all textures, the same as 'extract -T texture'.
+	for (size_t iteration = 0; iteration < state.iterations(); iteration++) {
+		hellextractor::benchmark::keep(table.select(0x329ec6a0c63842cdull).size());
+	}
+	state.items(table.size());
+});
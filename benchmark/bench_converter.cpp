@@ -0,0 +1,81 @@
+// Copyright 2024 Michael Fabian 'Xaymar' Dirks <info@xaymar.com>
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include <list>
+#include "benchmark.hpp"
+#include "converter.hpp"
+#include "sink.hpp"
+#include "stingray_data.hpp"
+#include "synthetic.hpp"
+
+/** Every file of the kind in the synthetic install. The containers stay mapped for as long as the list exists. */
+static std::vector<stingray::data_110000F0::meta_t> files_of(hellextractor::benchmark::state& state, std::list<stingray::data_110000F0>& containers, hellextractor::synthetic::kind kind)
+{
+	std::vector<stingray::data_110000F0::meta_t> files;
+	for (auto const& path : state.fixture().containers) {
+		auto const& container = containers.emplace_back(path);
+		for (size_t idx = 0; idx < container.files(); idx++) {
+			if (container.file(idx).type == hellextractor::synthetic::type(kind)) {
+				files.push_back(container.meta(idx));
+			}
+		}
+	}
+	return files;
+}
+
+static void outputs(hellextractor::benchmark::state& state, hellextractor::synthetic::kind kind)
+{
+	std::list<stingray::data_110000F0> containers;
+	auto                               files = files_of(state, containers, kind);
+
+	hellextractor::converter::pool converters;
+	for (size_t iteration = 0; iteration < state.iterations(); iteration++) {
+		for (auto const& meta : files) {
+			hellextractor::benchmark::keep(converters.find(meta)->outputs().size());
+		}
+	}
+	state.items(files.size());
+}
+
+/** Extract every output into a sink that discards it, which leaves only the cost of the converter itself. */
+static void extract(hellextractor::benchmark::state& state, hellextractor::synthetic::kind kind)
+{
+	std::list<stingray::data_110000F0> containers;
+	auto                               files = files_of(state, containers, kind);
+
+	hellextractor::converter::pool converters;
+	for (size_t iteration = 0; iteration < state.iterations(); iteration++) {
+		for (auto const& meta : files) {
+			auto converter = converters.find(meta);
+			for (auto const& output : converter->outputs()) {
+				hellextractor::discard_sink sink;
+				converter->extract(output.section, sink);
+				sink.close();
+				hellextractor::benchmark::keep(sink.size());
+			}
+		}
+	}
+	state.items(files.size());
+}
+
+typedef hellextractor::synthetic::kind kind_t;
+
+static auto outputs_texture      = hellextractor::benchmark::benchmark("converter/outputs/texture", [](hellextractor::benchmark::state& state) { outputs(state, kind_t::TEXTURE); });
+static auto outputs_bik          = hellextractor::benchmark::benchmark("converter/outputs/bik", [](hellextractor::benchmark::state& state) { outputs(state, kind_t::BIK); });
+static auto outputs_unit         = hellextractor::benchmark::benchmark("converter/outputs/unit", [](hellextractor::benchmark::state& state) { outputs(state, kind_t::UNIT); });
+static auto outputs_wwise_stream = hellextractor::benchmark::benchmark("converter/outputs/wwise_stream", [](hellextractor::benchmark::state& state) { outputs(state, kind_t::WWISE_STREAM); });
+static auto outputs_wwise_bank   = hellextractor::benchmark::benchmark("converter/outputs/wwise_bank", [](hellextractor::benchmark::state& state) { outputs(state, kind_t::WWISE_BANK); });
+
+static auto extract_texture      = hellextractor::benchmark::benchmark("converter/extract/texture", [](hellextractor::benchmark::state& state) { extract(state, kind_t::TEXTURE); });
+static auto extract_bik          = hellextractor::benchmark::benchmark("converter/extract/bik", [](hellextractor::benchmark::state& state) { extract(state, kind_t::BIK); });
+static auto extract_unit         = hellextractor::benchmark::benchmark("converter/extract/unit", [](hellextractor::benchmark::state& state) { extract(state, kind_t::UNIT); });
+static auto extract_wwise_stream = hellextractor::benchmark::benchmark("converter/extract/wwise_stream", [](hellextractor::benchmark::state& state) { extract(state, kind_t::WWISE_STREAM); });
+static auto extract_wwise_bank   = hellextractor::benchmark::benchmark("converter/extract/wwise_bank", [](hellextractor::benchmark::state& state) { extract(state, kind_t::WWISE_BANK); });
@@ -0,0 +1,62 @@
+// Copyright 2024 Michael Fabian 'Xaymar' Dirks <info@xaymar.com>
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include <list>
+#include "benchmark.hpp"
+#include "hash_db.hpp"
+#include "hasher.hpp"
+#include "stingray_data.hpp"
+#include "string_printf.hpp"
+
+static void murmur(hellextractor::benchmark::state& state, size_t size)
+{
+	auto              hasher = hellextractor::hash::instance::create(hellextractor::hash::type::MURMUR_64A);
+	std::vector<char> buffer(size, 'a');
+	for (size_t iteration = 0; iteration < state.iterations(); iteration++) {
+		hellextractor::benchmark::keep(hasher->hash(buffer.data(), buffer.size()).data());
+	}
+	state.bytes(size);
+	state.items(1);
+}
+
+static auto murmur_16   = hellextractor::benchmark::benchmark("murmur64a/16", [](hellextractor::benchmark::state& state) { murmur(state, 16); });
+static auto murmur_64   = hellextractor::benchmark::benchmark("murmur64a/64", [](hellextractor::benchmark::state& state) { murmur(state, 64); });
+static auto murmur_4096 = hellextractor::benchmark::benchmark("murmur64a/4096", [](hellextractor::benchmark::state& state) { murmur(state, 4096); });
+
+static auto db_load = hellextractor::benchmark::benchmark("hash_db/load", [](hellextractor::benchmark::state& state) {
+	size_t names = 0;
+	for (size_t iteration = 0; iteration < state.iterations(); iteration++) {
+		hellextractor::hash_db db{state.fixture().names};
+		names = db.strings().size();
+	}
+	state.items(names);
+});
+
+static auto db_lookup = hellextractor::benchmark::benchmark("hash_db/lookup", [](hellextractor::benchmark::state& state) {
+	hellextractor::hash_db db{state.fixture().names};
+
+	std::vector<stingray::hash_t> ids;
+	for (auto const& path : state.fixture().containers) {
+		stingray::data_110000F0 container{path};
+		for (size_t idx = 0; idx < container.files(); idx++) {
+			ids.push_back(container.file(idx).id);
+		}
+	}
+
+	for (size_t iteration = 0; iteration < state.iterations(); iteration++) {
+		size_t found = 0;
+		for (auto const& id : ids) {
+			found += (db.strings().find(id) != db.strings().end()) ? 1 : 0;
+		}
+		hellextractor::benchmark::keep(found);
+	}
+	state.items(ids.size());
+});
@@ -0,0 +1,73 @@
+// Copyright 2024 Michael Fabian 'Xaymar' Dirks <info@xaymar.com>
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include <algorithm>
+#include <list>
+#include "benchmark.hpp"
+#include "endian.h"
+#include "hash_db.hpp"
+#include "stingray_data.hpp"
+#include "string_printf.hpp"
+
+/** Build the output path of every file the same way as the extract mode: translate the name and type, fall back to
+ * the hashes in both byte orders, then combine the first permutation with the output directory.
+ */
+static auto build = hellextractor::benchmark::benchmark("path/build", [](hellextractor::benchmark::state& state) {
+	std::list<hellextractor::hash_db> namedbs;
+	std::list<hellextractor::hash_db> strings;
+	namedbs.emplace_back(state.fixture().names);
+
+	std::vector<stingray::data_110000F0::file_t> files;
+	for (auto const& path : state.fixture().containers) {
+		stingray::data_110000F0 container{path};
+		for (size_t idx = 0; idx < container.files(); idx++) {
+			files.push_back(container.file(idx));
+		}
+	}
+
+	auto translations = [](stingray::hash_t hash, std::list<hellextractor::hash_db>& primary, std::list<hellextractor::hash_db>& secondary) {
+		std::vector<std::string> translations;
+		for (auto* dbs : {&primary, &secondary}) {
+			for (auto& db : *dbs) {
+				if (auto tv = db.strings().find(hash); db.strings().end() != tv) {
+					if (std::find(translations.cbegin(), translations.cend(), tv->second) == translations.end()) {
+						translations.push_back(tv->second);
+					}
+				}
+			}
+		}
+		return translations;
+	};
+
+	std::filesystem::path output_path = state.fixture().directory / "output";
+	for (size_t iteration = 0; iteration < state.iterations(); iteration++) {
+		for (auto const& file : files) {
+			auto file_names = translations(file.id, namedbs, strings);
+			file_names.emplace_back(string_printf("%016" PRIx64, (uint64_t)file.id));
+			file_names.emplace_back(string_printf("%016" PRIx64, bswap64((uint64_t)file.id)));
+
+			auto file_types = translations(file.type, namedbs, strings);
+			file_types.emplace_back(string_printf("%016" PRIx64, (uint64_t)file.type));
+			file_types.emplace_back(string_printf("%016" PRIx64, bswap64((uint64_t)file.type)));
+
+			std::vector<std::pair<std::string, std::string>> permutations;
+			for (auto const& fn : file_names) {
+				for (auto const& ft : file_types) {
+					permutations.emplace_back(fn, ft);
+				}
+			}
+
+			auto base_file_path = output_path / std::filesystem::path(permutations[0].first).replace_extension(permutations[0].second);
+			hellextractor::benchmark::keep(base_file_path.native().size());
+		}
+	}
+	state.items(files.size());
+});
@@ -0,0 +1,208 @@
+// Copyright 2024 Michael Fabian 'Xaymar' Dirks <info@xaymar.com>
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "benchmark.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <iostream>
+#include <map>
+#include <optional>
+#include <regex>
+#include "string_printf.hpp"
+#include "synthetic.hpp"
+
+namespace hellextractor::benchmark {
+	struct benchmark_info {
+		std::string          name;
+		benchmark_function_t fn;
+
+		typedef std::map<std::string, benchmark_info> benchmark_list_t;
+
+		static benchmark_list_t& get()
+		{
+			static benchmark_list_t list;
+			return list;
+		}
+	};
+
+	benchmark::benchmark(std::string name, benchmark_function_t fn)
+	{
+		benchmark_info::get().try_emplace(name, benchmark_info{name, fn});
+	}
+} // namespace hellextractor::benchmark
+
+hellextractor::benchmark::state::~state() {}
+
+hellextractor::benchmark::state::state(fixture_t const& fixture, size_t iterations) : _fixture(fixture), _iterations(iterations), _bytes(0), _items(0) {}
+
+hellextractor::benchmark::fixture_t const& hellextractor::benchmark::state::fixture() const
+{
+	return _fixture;
+}
+
+size_t hellextractor::benchmark::state::iterations() const
+{
+	return _iterations;
+}
+
+void hellextractor::benchmark::state::bytes(size_t bytes)
+{
+	_bytes = bytes;
+}
+
+size_t hellextractor::benchmark::state::bytes() const
+{
+	return _bytes;
+}
+
+void hellextractor::benchmark::state::items(size_t items)
+{
+	_items = items;
+}
+
+size_t hellextractor::benchmark::state::items() const
+{
+	return _items;
+}
+
+/** Generate the synthetic install, or reuse it if an earlier run already generated it with the same options. */
+static hellextractor::benchmark::fixture_t prepare(std::filesystem::path directory, hellextractor::synthetic::options_t const& options)
+{
+	hellextractor::benchmark::fixture_t fixture{directory, {}, directory / "names.txt"};
+	if (!std::filesystem::exists(fixture.names)) {
+		std::cout << "Generating synthetic data in: " << directory.generic_string() << std::endl;
+		hellextractor::synthetic::generator{options}.generate(directory);
+	}
+	for (auto const& entry : std::filesystem::directory_iterator(directory)) {
+		if (entry.is_regular_file() && !entry.path().has_extension()) {
+			fixture.containers.push_back(entry.path());
+		}
+	}
+	std::sort(fixture.containers.begin(), fixture.containers.end());
+	return fixture;
+}
+
+static std::string rate(double value, char const* unit)
+{
+	static constexpr char const* prefixes[] = {"", "k", "M", "G", "T"};
+	size_t                       prefix     = 0;
+	for (; (value >= 1000.) && ((prefix + 1) < std::size(prefixes)); prefix++) {
+		value /= 1000.;
+	}
+	return string_printf("%7.2f %s%s/s", value, prefixes[prefix], unit);
+}
+
+int main(int argc, const char** argv)
+try {
+	hellextractor::synthetic::options_t  options;
+	std::optional<std::filesystem::path> data_path;
+	std::optional<std::regex>            filter;
+	double                               min_time = 0.5;
+	bool                                 list     = false;
+
+	for (int idx = 1; idx < argc; ++idx) {
+		std::string arg   = argv[idx];
+		bool        value = (idx + 1) < argc;
+		if ((arg == "-h") || (arg == "--help")) {
+			auto self = std::filesystem::path(argv[0]).filename();
+			std::cout << self.generic_string() << " [options]" << std::endl;
+			std::cout << "Runs micro-benchmarks against a reproducible synthetic install." << std::endl;
+			std::cout << std::endl;
+			std::cout << "Options" << std::endl;
+			std::cout << "  -h, --help            Show this help" << std::endl;
+			std::cout << "  -l, --list            List all benchmarks and exit." << std::endl;
+			std::cout << "  -f, --filter <regex>  Only run benchmarks whose name matches." << std::endl;
+			std::cout << "  -t, --time <seconds>  Minimum time to run each benchmark for. Default is 0.5." << std::endl;
+			std::cout << "  -d, --data <path>     Directory for the synthetic install. Default is a directory in the temporary directory named after the options, which is reused by later runs." << std::endl;
+			std::cout << "      --seed <seed>     Seed for the synthetic install. Default is 1." << std::endl;
+			std::cout << "  -c, --containers <count>  Number of containers. Default is 4." << std::endl;
+			std::cout << "  -n, --files <count>   Number of files in each container. Default is 1000." << std::endl;
+			std::cout << "  -m, --mix <kind>=<weight>[,...]  Relative weight of each kind of file, see the generate mode." << std::endl;
+			std::cout << std::endl;
+			return 1;
+		} else if ((arg == "-l") || (arg == "--list")) {
+			list = true;
+		} else if (((arg == "-f") || (arg == "--filter")) && value) {
+			filter = argv[++idx];
+		} else if (((arg == "-t") || (arg == "--time")) && value) {
+			min_time = std::stod(argv[++idx]);
+		} else if (((arg == "-d") || (arg == "--data")) && value) {
+			data_path = std::filesystem::absolute(argv[++idx]);
+		} else if ((arg == "--seed") && value) {
+			options.seed = std::stoull(argv[++idx]);
+		} else if (((arg == "-c") || (arg == "--containers")) && value) {
+			options.containers = std::stoull(argv[++idx]);
+		} else if (((arg == "-n") || (arg == "--files")) && value) {
+			options.files = std::stoull(argv[++idx]);
+		} else if (((arg == "-m") || (arg == "--mix")) && value) {
+			hellextractor::synthetic::parse_mix(argv[++idx], options);
+		} else {
+			std::cerr << "Unrecognized argument: " << arg << std::endl;
+			return 1;
+		}
+	}
+
+	auto const& benchmarks = hellextractor::benchmark::benchmark_info::get();
+	if (list) {
+		for (auto const& kv : benchmarks) {
+			std::cout << kv.first << std::endl;
+		}
+		return 0;
+	}
+
+	if (!data_path.has_value()) {
+		std::string mix;
+		for (auto weight : options.mix) {
+			mix += string_printf("-%" PRIu32, weight);
+		}
+		data_path = std::filesystem::temp_directory_path() / string_printf("hellextractor-benchmark-%" PRIu64 "-%zux%zu%s", options.seed, options.containers, options.files, mix.c_str());
+	}
+	auto fixture = prepare(data_path.value(), options);
+	std::cout << fixture.containers.size() << " containers" << std::endl;
+	std::cout << std::endl;
+
+	std::cout << string_printf("%-40s %12s %14s %16s %16s", "Benchmark", "Iterations", "Time", "Items", "Bytes") << std::endl;
+	for (auto const& kv : benchmarks) {
+		if (filter.has_value() && !std::regex_search(kv.first, filter.value())) {
+			continue;
+		}
+
+		// Keep increasing the iterations until a single run takes long enough to be measured reliably.
+		size_t iterations = 1;
+		double elapsed    = 0;
+		while (true) {
+			hellextractor::benchmark::state state{fixture, iterations};
+
+			auto start = std::chrono::steady_clock::now();
+			kv.second.fn(state);
+			elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+			if ((elapsed >= min_time) || (iterations >= (size_t(1) << 40))) {
+				double per_iteration = elapsed / static_cast<double>(iterations);
+				std::cout << string_printf("%-40s %12zu %11.0f ns %16s %16s", //
+											   kv.first.c_str(), iterations, per_iteration * 1e9, //
+											   state.items() ? rate(static_cast<double>(state.items()) / per_iteration, "").c_str() : "", //
+											   state.bytes() ? rate(static_cast<double>(state.bytes()) / per_iteration, "B").c_str() : "")
+						  << std::endl;
+				break;
+			}
+
+			double scale = (elapsed > 0) ? (min_time * 1.2 / elapsed) : 100.;
+			iterations   = std::max(iterations + 1, static_cast<size_t>(static_cast<double>(iterations) * std::min(scale, 100.)));
+		}
+	}
+
+	return 0;
+} catch (const std::exception& ex) {
+	std::cerr << "Exception: " << ex.what() << std::endl;
+	return 1;
+}
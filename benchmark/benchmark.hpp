@@ -0,0 +1,71 @@
+// Copyright 2024 Michael Fabian 'Xaymar' Dirks <info@xaymar.com>
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#pragma once
+#include <cinttypes>
+#include <cstddef>
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace hellextractor::benchmark {
+	/** Synthetic install shared by all benchmarks, generated once per run. */
+	struct fixture_t {
+		std::filesystem::path              directory;
+		std::vector<std::filesystem::path> containers;
+		std::filesystem::path              names;
+	};
+
+	class state {
+		fixture_t const& _fixture;
+		size_t           _iterations;
+		size_t           _bytes;
+		size_t           _items;
+
+		public:
+		~state();
+		state(fixture_t const& fixture, size_t iterations);
+
+		fixture_t const& fixture() const;
+
+		/** Number of times the benchmark has to repeat its work. */
+		size_t iterations() const;
+
+		/** Set the number of bytes processed per iteration. */
+		void bytes(size_t bytes);
+
+		size_t bytes() const;
+
+		/** Set the number of items processed per iteration. */
+		void items(size_t items);
+
+		size_t items() const;
+	};
+
+	typedef std::function<void(state&)> benchmark_function_t;
+
+	struct benchmark {
+		benchmark(std::string name, benchmark_function_t fn);
+	};
+
+	/** Keep the compiler from optimizing away a value that is otherwise unused. */
+	template<typename T>
+	inline void keep(T const& value)
+	{
+#if defined(_MSC_VER)
+		static volatile char const* sink;
+		sink = reinterpret_cast<char const volatile*>(&value);
+#else
+		asm volatile("" : : "r,m"(value) : "memory");
+#endif
+	}
+} // namespace hellextractor::benchmark
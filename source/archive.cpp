@@ -0,0 +1,552 @@
+// Copyright 2024 Michael Fabian 'Xaymar' Dirks <info@xaymar.com>
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "archive.hpp"
+#include <algorithm>
+#include <cstring>
+#include <ctime>
+#include <stdexcept>
+#include "endian.h"
+#include "string_printf.hpp"
+#include "trace.hpp"
+
+#include <zlib-ng.h>
+
+// Known information
+// - zlib-ng only accepts 32-bit lengths, so everything larger is fed in chunks.
+// - ZIP64 extra fields are only written where a value does not fit, which keeps small archives readable by old tools.
+
+static constexpr size_t   chunk_max       = 1ull << 30;
+static constexpr uint64_t zip_limit32     = 0xFFFFFFFFull;
+static constexpr uint64_t zip_limit16     = 0xFFFFull;
+static constexpr size_t   tar_block       = 512;
+static constexpr uint64_t tar_octal_limit = 077777777777ull;
+
+static void put16(std::vector<char>& buf, uint16_t v)
+{
+	v = htole16(v);
+	buf.insert(buf.end(), reinterpret_cast<char const*>(&v), reinterpret_cast<char const*>(&v) + sizeof(v));
+}
+
+static void put32(std::vector<char>& buf, uint32_t v)
+{
+	v = htole32(v);
+	buf.insert(buf.end(), reinterpret_cast<char const*>(&v), reinterpret_cast<char const*>(&v) + sizeof(v));
+}
+
+static void put64(std::vector<char>& buf, uint64_t v)
+{
+	v = htole64(v);
+	buf.insert(buf.end(), reinterpret_cast<char const*>(&v), reinterpret_cast<char const*>(&v) + sizeof(v));
+}
+
+hellextractor::archive::~archive()
+{
+	try {
+		close();
+	} catch (...) {
+	}
+}
+
+hellextractor::archive::archive(std::filesystem::path path, format fmt, size_t threads) : _format(fmt), _offset(0), _max_in_flight(), _closing(false)
+{
+	_stream = std::ofstream{path, std::ios::trunc | std::ios::binary | std::ios::out};
+	if (!_stream || _stream.bad() || !_stream.is_open()) {
+		throw std::runtime_error(string_printf("Failed to open archive '%s'.", path.generic_string().c_str()));
+	}
+
+	// All entries share the time the archive was created at.
+	std::time_t now = std::time(nullptr);
+	std::tm     tm  = *std::localtime(&now);
+	_time           = static_cast<int64_t>(now);
+	_dos_time       = static_cast<uint16_t>((tm.tm_hour << 11) | (tm.tm_min << 5) | (tm.tm_sec / 2));
+	_dos_date       = static_cast<uint16_t>((std::max(tm.tm_year - 80, 0) << 9) | ((tm.tm_mon + 1) << 5) | tm.tm_mday);
+
+	threads        = std::max<size_t>(threads, 1);
+	_max_in_flight = threads * 4;
+	if (_format == format::ZIP) {
+		for (size_t idx = 0; idx < threads; idx++) {
+			_workers.emplace_back([this]() { work(); });
+		}
+	}
+	_writer = std::thread([this]() { write(); });
+}
+
+void hellextractor::archive::add(std::string name, std::string data, int32_t level)
+{
+	auto entry      = std::make_shared<entry_t>();
+	entry->name     = std::move(name);
+	entry->owned    = std::move(data);
+	entry->sections = {{entry->owned.data(), entry->owned.size()}};
+	entry->level    = level;
+	push(entry);
+}
+
+void hellextractor::archive::add(std::string name, std::vector<std::pair<void const*, size_t>> sections, int32_t level)
+{
+	auto entry      = std::make_shared<entry_t>();
+	entry->name     = std::move(name);
+	entry->sections = std::move(sections);
+	entry->level    = level;
+	push(entry);
+}
+
+void hellextractor::archive::add(std::string name, std::string owned, std::vector<std::pair<void const*, size_t>> sections, int32_t level)
+{
+	auto entry      = std::make_shared<entry_t>();
+	entry->name     = std::move(name);
+	entry->owned    = std::move(owned);
+	entry->sections = std::move(sections);
+	entry->level    = level;
+
+	// The owned data doesn't move anymore, so the sections can point into it now.
+	size_t offset = 0;
+	for (auto& section : entry->sections) {
+		if (section.first == nullptr) {
+			if (section.second > (entry->owned.size() - offset)) {
+				throw std::overflow_error("offset+size > size");
+			}
+			section.first = entry->owned.data() + offset;
+			offset += section.second;
+		}
+	}
+	push(entry);
+}
+
+void hellextractor::archive::close()
+{
+	if (!_writer.joinable()) {
+		return;
+	}
+
+	{
+		std::unique_lock<std::mutex> lock(_lock);
+		_closing = true;
+	}
+	_work_cv.notify_all();
+	_done_cv.notify_all();
+
+	for (auto& worker : _workers) {
+		worker.join();
+	}
+	_workers.clear();
+	_writer.join();
+
+	if (_error) {
+		std::rethrow_exception(_error);
+	}
+
+	if (_format == format::ZIP) {
+		finish_zip();
+	} else {
+		finish_tar();
+	}
+	_stream.close();
+}
+
+hellextractor::archive::format hellextractor::archive::detect(std::filesystem::path const& path)
+{
+	if (path.extension() == ".tar") {
+		return format::TAR;
+	}
+	return format::ZIP;
+}
+
+void hellextractor::archive::push(std::shared_ptr<entry_t> entry)
+{
+	entry->done = false;
+	entry->size = 0;
+	for (auto const& section : entry->sections) {
+		entry->size += section.second;
+	}
+
+	{
+		std::unique_lock<std::mutex> lock(_lock);
+		_space_cv.wait(lock, [this]() { return (_order.size() < _max_in_flight) || _error; });
+		if (_error) {
+			std::rethrow_exception(_error);
+		}
+
+		_order.push_back(entry);
+		if (_format == format::ZIP) {
+			_work.push_back(entry);
+		} else {
+			// Tar is store-only and has no checksum over the content, so there is nothing to do for the workers.
+			entry->done = true;
+		}
+	}
+	_work_cv.notify_one();
+	_done_cv.notify_all();
+}
+
+void hellextractor::archive::work()
+{
+	hellextractor::trace::name_thread("archive worker");
+	while (true) {
+		std::shared_ptr<entry_t> entry;
+		{
+			std::unique_lock<std::mutex> lock(_lock);
+			_work_cv.wait(lock, [this]() { return _closing || !_work.empty(); });
+			if (_work.empty()) {
+				return;
+			}
+			entry = _work.front();
+			_work.pop_front();
+		}
+
+		try {
+			hellextractor::trace::span span{"compress"};
+			if (span) {
+				span.detail(entry->name);
+			}
+			compress(*entry);
+		} catch (...) {
+			std::unique_lock<std::mutex> lock(_lock);
+			if (!_error) {
+				_error = std::current_exception();
+			}
+		}
+
+		{
+			std::unique_lock<std::mutex> lock(_lock);
+			entry->done = true;
+		}
+		_done_cv.notify_all();
+	}
+}
+
+void hellextractor::archive::write()
+{
+	hellextractor::trace::name_thread("archive writer");
+	while (true) {
+		std::shared_ptr<entry_t> entry;
+		bool                     failed;
+		{
+			std::unique_lock<std::mutex> lock(_lock);
+			_done_cv.wait(lock, [this]() { return (!_order.empty() && _order.front()->done) || (_closing && _order.empty()); });
+			if (_order.empty()) {
+				return;
+			}
+			entry = _order.front();
+			_order.pop_front();
+			failed = static_cast<bool>(_error);
+		}
+		_space_cv.notify_all();
+
+		if (failed) {
+			continue;
+		}
+
+		try {
+			hellextractor::trace::span span{"archive_write"};
+			if (span) {
+				span.detail(entry->name);
+			}
+			if (_format == format::ZIP) {
+				write_zip(*entry);
+			} else {
+				write_tar(*entry);
+			}
+		} catch (...) {
+			{
+				std::unique_lock<std::mutex> lock(_lock);
+				if (!_error) {
+					_error = std::current_exception();
+				}
+			}
+			_space_cv.notify_all();
+		}
+	}
+}
+
+void hellextractor::archive::compress(entry_t& entry)
+{
+	uint32_t crc = 0;
+	for (auto const& section : entry.sections) {
+		auto   ptr  = reinterpret_cast<uint8_t const*>(section.first);
+		size_t left = section.second;
+		while (left > 0) {
+			uint32_t chunk = static_cast<uint32_t>(std::min(left, chunk_max));
+			crc            = zng_crc32(crc, ptr, chunk);
+			ptr += chunk;
+			left -= chunk;
+		}
+	}
+	entry.crc = crc;
+
+	if ((entry.level <= 0) || (entry.size == 0)) {
+		return;
+	}
+
+	zng_stream strm = {};
+	if (zng_deflateInit2(&strm, std::min(entry.level, 9), Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+		throw std::runtime_error("zng_deflateInit2 failed.");
+	}
+	std::shared_ptr<zng_stream> guard(&strm, [](zng_stream* p) { zng_deflateEnd(p); });
+
+	auto&  out  = entry.compressed;
+	size_t used = 0;
+	auto   pump = [&strm, &out, &used](int flush) {
+		int result;
+		do {
+			if (used == out.size()) {
+				out.resize(std::max<size_t>(out.size() * 2, 64 * 1024));
+			}
+			strm.next_out  = reinterpret_cast<uint8_t*>(out.data()) + used;
+			strm.avail_out = static_cast<uint32_t>(std::min(out.size() - used, chunk_max));
+			result         = zng_deflate(&strm, flush);
+			used           = reinterpret_cast<char*>(strm.next_out) - out.data();
+			if (result == Z_STREAM_ERROR) {
+				throw std::runtime_error("zng_deflate failed.");
+			}
+		} while ((strm.avail_out == 0) || ((flush == Z_FINISH) && (result != Z_STREAM_END)));
+	};
+
+	out.reserve(entry.size / 2);
+	for (auto const& section : entry.sections) {
+		auto   ptr  = reinterpret_cast<uint8_t const*>(section.first);
+		size_t left = section.second;
+		while (left > 0) {
+			uint32_t chunk = static_cast<uint32_t>(std::min(left, chunk_max));
+			strm.next_in   = ptr;
+			strm.avail_in  = chunk;
+			pump(Z_NO_FLUSH);
+			ptr += chunk;
+			left -= chunk;
+		}
+	}
+	strm.next_in  = nullptr;
+	strm.avail_in = 0;
+	pump(Z_FINISH);
+
+	if (used >= entry.size) {
+		// Incompressible, store it instead.
+		out.clear();
+		out.shrink_to_fit();
+	} else {
+		out.resize(used);
+	}
+}
+
+void hellextractor::archive::write_zip(entry_t& entry)
+{
+	bool     stored = entry.compressed.empty();
+	uint64_t csize  = stored ? entry.size : entry.compressed.size();
+	bool     zip64  = (entry.size >= zip_limit32) || (csize >= zip_limit32);
+
+	directory_t dir{
+		.name            = entry.name,
+		.offset          = _offset,
+		.size            = entry.size,
+		.compressed_size = csize,
+		.crc             = entry.crc,
+		.method          = static_cast<uint16_t>(stored ? 0 : 8),
+	};
+
+	std::vector<char> header;
+	header.reserve(30 + entry.name.size() + 20);
+	put32(header, 0x04034b50);
+	put16(header, zip64 ? 45 : 20);
+	put16(header, 0x0800); // Names are UTF-8.
+	put16(header, dir.method);
+	put16(header, _dos_time);
+	put16(header, _dos_date);
+	put32(header, dir.crc);
+	put32(header, zip64 ? static_cast<uint32_t>(zip_limit32) : static_cast<uint32_t>(csize));
+	put32(header, zip64 ? static_cast<uint32_t>(zip_limit32) : static_cast<uint32_t>(entry.size));
+	put16(header, static_cast<uint16_t>(entry.name.size()));
+	put16(header, zip64 ? 20 : 0);
+	header.insert(header.end(), entry.name.begin(), entry.name.end());
+	if (zip64) {
+		put16(header, 0x0001);
+		put16(header, 16);
+		put64(header, entry.size);
+		put64(header, csize);
+	}
+	put(header.data(), header.size());
+
+	if (stored) {
+		for (auto const& section : entry.sections) {
+			put(section.first, section.second);
+		}
+	} else {
+		put(entry.compressed.data(), entry.compressed.size());
+	}
+
+	_directory.push_back(std::move(dir));
+}
+
+void hellextractor::archive::write_tar(entry_t& entry)
+{
+	std::vector<char> header;
+
+	// Names which don't fit into the ustar name and prefix fields are written as a GNU long name record first.
+	std::string name   = entry.name;
+	std::string prefix = {};
+	if (name.size() > 100) {
+		auto pos = name.find('/', name.size() > 101 ? name.size() - 101 : 0);
+		if ((pos != std::string::npos) && (pos <= 155) && ((name.size() - pos - 1) <= 100) && (pos > 0)) {
+			prefix = name.substr(0, pos);
+			name   = name.substr(pos + 1);
+		} else {
+			std::vector<char> data(entry.name.begin(), entry.name.end());
+			data.push_back('\0');
+
+			auto long_header = tar_header("././@LongLink", {}, data.size(), 'L');
+			put(long_header.data(), long_header.size());
+			put(data.data(), data.size());
+			pad(data.size());
+
+			name = entry.name.substr(0, 100);
+		}
+	}
+
+	header = tar_header(name, prefix, entry.size, '0');
+	put(header.data(), header.size());
+	for (auto const& section : entry.sections) {
+		put(section.first, section.second);
+	}
+	pad(entry.size);
+}
+
+std::vector<char> hellextractor::archive::tar_header(std::string const& name, std::string const& prefix, uint64_t size, char type)
+{
+	std::vector<char> header(tar_block, '\0');
+	auto              field = [&header](size_t offset, size_t length, std::string const& value) { memcpy(header.data() + offset, value.data(), std::min(length, value.size())); };
+
+	field(0, 100, name);
+	field(100, 8, "0000644");
+	field(108, 8, "0000000");
+	field(116, 8, "0000000");
+	if (size > tar_octal_limit) {
+		// GNU base-256 encoding for files of 8 GiB and larger.
+		header[124] = static_cast<char>(0x80);
+		for (size_t idx = 0; idx < 8; idx++) {
+			header[124 + 11 - idx] = static_cast<char>((size >> (idx * 8)) & 0xFF);
+		}
+	} else {
+		field(124, 12, string_printf("%011" PRIo64, size));
+	}
+	field(136, 12, string_printf("%011" PRIo64, static_cast<uint64_t>(std::max<int64_t>(_time, 0))));
+	field(148, 8, "        ");
+	header[156] = type;
+	field(257, 6, std::string("ustar\0", 6));
+	field(263, 2, "00");
+	field(345, 155, prefix);
+
+	uint32_t checksum = 0;
+	for (auto c : header) {
+		checksum += static_cast<uint8_t>(c);
+	}
+	field(148, 8, string_printf("%06" PRIo32, checksum));
+	header[154] = '\0';
+	header[155] = ' ';
+
+	return header;
+}
+
+void hellextractor::archive::finish_zip()
+{
+	uint64_t cd_offset = _offset;
+	for (auto const& dir : _directory) {
+		std::vector<char> extra;
+		if (dir.size >= zip_limit32) {
+			put64(extra, dir.size);
+		}
+		if (dir.compressed_size >= zip_limit32) {
+			put64(extra, dir.compressed_size);
+		}
+		if (dir.offset >= zip_limit32) {
+			put64(extra, dir.offset);
+		}
+
+		std::vector<char> header;
+		header.reserve(46 + dir.name.size() + 4 + extra.size());
+		put32(header, 0x02014b50);
+		put16(header, 45);
+		put16(header, extra.empty() ? 20 : 45);
+		put16(header, 0x0800);
+		put16(header, dir.method);
+		put16(header, _dos_time);
+		put16(header, _dos_date);
+		put32(header, dir.crc);
+		put32(header, static_cast<uint32_t>(std::min(dir.compressed_size, zip_limit32)));
+		put32(header, static_cast<uint32_t>(std::min(dir.size, zip_limit32)));
+		put16(header, static_cast<uint16_t>(dir.name.size()));
+		put16(header, static_cast<uint16_t>(extra.empty() ? 0 : (4 + extra.size())));
+		put16(header, 0); // Comment
+		put16(header, 0); // Disk
+		put16(header, 0); // Internal attributes
+		put32(header, 0); // External attributes
+		put32(header, static_cast<uint32_t>(std::min(dir.offset, zip_limit32)));
+		header.insert(header.end(), dir.name.begin(), dir.name.end());
+		if (!extra.empty()) {
+			put16(header, 0x0001);
+			put16(header, static_cast<uint16_t>(extra.size()));
+			header.insert(header.end(), extra.begin(), extra.end());
+		}
+		put(header.data(), header.size());
+	}
+	uint64_t cd_size = _offset - cd_offset;
+	uint64_t entries = _directory.size();
+
+	std::vector<char> footer;
+	if ((entries >= zip_limit16) || (cd_offset >= zip_limit32) || (cd_size >= zip_limit32)) {
+		uint64_t eocd64_offset = _offset;
+
+		put32(footer, 0x06064b50);
+		put64(footer, 44);
+		put16(footer, 45);
+		put16(footer, 45);
+		put32(footer, 0);
+		put32(footer, 0);
+		put64(footer, entries);
+		put64(footer, entries);
+		put64(footer, cd_size);
+		put64(footer, cd_offset);
+
+		put32(footer, 0x07064b50);
+		put32(footer, 0);
+		put64(footer, eocd64_offset);
+		put32(footer, 1);
+	}
+	put32(footer, 0x06054b50);
+	put16(footer, 0);
+	put16(footer, 0);
+	put16(footer, static_cast<uint16_t>(std::min(entries, zip_limit16)));
+	put16(footer, static_cast<uint16_t>(std::min(entries, zip_limit16)));
+	put32(footer, static_cast<uint32_t>(std::min(cd_size, zip_limit32)));
+	put32(footer, static_cast<uint32_t>(std::min(cd_offset, zip_limit32)));
+	put16(footer, 0);
+	put(footer.data(), footer.size());
+}
+
+void hellextractor::archive::finish_tar()
+{
+	std::vector<char> footer(tar_block * 2, '\0');
+	put(footer.data(), footer.size());
+}
+
+void hellextractor::archive::pad(uint64_t size)
+{
+	static char const zero[tar_block] = {};
+	if (size_t rest = size % tar_block; rest != 0) {
+		put(zero, tar_block - rest);
+	}
+}
+
+void hellextractor::archive::put(void const* data, size_t size)
+{
+	_stream.write(reinterpret_cast<char const*>(data), size);
+	if (!_stream) {
+		throw std::runtime_error("Failed to write to archive.");
+	}
+	_offset += size;
+}
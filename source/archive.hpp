@@ -0,0 +1,135 @@
+// Copyright 2024 Michael Fabian 'Xaymar' Dirks <info@xaymar.com>
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+#include <cinttypes>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace hellextractor {
+	/** Single file archive output (zip or store-only tar).
+	 *
+	 * Entries are compressed on a pool of worker threads, but are always written in the order they were added by a
+	 * single writer thread, which also keeps track of the central directory. Nothing is ever written to a temporary file.
+	 */
+	class archive {
+		public:
+		enum class format {
+			ZIP,
+			TAR,
+		};
+
+		private:
+		struct entry_t {
+			std::string                                 name;
+			std::string                                 owned;
+			std::vector<std::pair<void const*, size_t>> sections;
+			int32_t                                     level;
+
+			// Filled in by the workers.
+			bool              done;
+			uint64_t          size;
+			uint32_t          crc;
+			std::vector<char> compressed;
+		};
+
+		struct directory_t {
+			std::string name;
+			uint64_t    offset;
+			uint64_t    size;
+			uint64_t    compressed_size;
+			uint32_t    crc;
+			uint16_t    method;
+		};
+
+		format        _format;
+		std::ofstream _stream;
+		uint64_t      _offset;
+		int64_t       _time;
+		uint16_t      _dos_time;
+		uint16_t      _dos_date;
+
+		std::mutex                           _lock;
+		std::condition_variable              _work_cv;
+		std::condition_variable              _done_cv;
+		std::condition_variable              _space_cv;
+		std::deque<std::shared_ptr<entry_t>> _work;
+		std::deque<std::shared_ptr<entry_t>> _order;
+		size_t                               _max_in_flight;
+		bool                                 _closing;
+		std::exception_ptr                   _error;
+
+		std::vector<std::thread> _workers;
+		std::thread              _writer;
+
+		std::vector<directory_t> _directory;
+
+		public:
+		~archive();
+		archive(std::filesystem::path path, format fmt, size_t threads);
+
+		/** Add an entry which owns its data.
+		 *
+		 * @param level Deflate level from 0 (store) to 9. Ignored for tar.
+		 */
+		void add(std::string name, std::string data, int32_t level);
+
+		/** Add an entry which references memory that stays valid until close() returns, such as mapped containers.
+		 *
+		 * @param level Deflate level from 0 (store) to 9. Ignored for tar.
+		 */
+		void add(std::string name, std::vector<std::pair<void const*, size_t>> sections, int32_t level);
+
+		/** Add an entry made up of owned data and of memory that stays valid until close() returns.
+		 *
+		 * Sections with a null pointer are taken from the owned data, one after another.
+		 *
+		 * @param level Deflate level from 0 (store) to 9. Ignored for tar.
+		 */
+		void add(std::string name, std::string owned, std::vector<std::pair<void const*, size_t>> sections, int32_t level);
+
+		/** Flush all pending entries and write the central directory or end of archive marker. */
+		void close();
+
+		static format detect(std::filesystem::path const& path);
+
+		private:
+		void push(std::shared_ptr<entry_t> entry);
+
+		void work();
+
+		void write();
+
+		void compress(entry_t& entry);
+
+		void write_zip(entry_t& entry);
+
+		void write_tar(entry_t& entry);
+
+		void finish_zip();
+
+		void finish_tar();
+
+		std::vector<char> tar_header(std::string const& name, std::string const& prefix, uint64_t size, char type);
+
+		void pad(uint64_t size);
+
+		void put(void const* data, size_t size);
+	};
+} // namespace hellextractor
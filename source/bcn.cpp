@@ -0,0 +1,619 @@
+// Copyright 2024 Michael Fabian 'Xaymar' Dirks <info@xaymar.com>
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "bcn.hpp"
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <utility>
+#include "half.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define BCN_SSE2
+#include <emmintrin.h>
+#endif
+
+// DXGI formats that can be decoded.
+static constexpr uint32_t R8G8B8A8_TYPELESS   = 27;
+static constexpr uint32_t R8G8B8A8_UNORM_SRGB = 29;
+static constexpr uint32_t BC1_TYPELESS        = 70;
+static constexpr uint32_t BC1_UNORM_SRGB      = 72;
+static constexpr uint32_t BC2_TYPELESS        = 73;
+static constexpr uint32_t BC2_UNORM_SRGB      = 75;
+static constexpr uint32_t BC3_TYPELESS        = 76;
+static constexpr uint32_t BC3_UNORM_SRGB      = 78;
+static constexpr uint32_t BC4_TYPELESS        = 79;
+static constexpr uint32_t BC4_SNORM           = 81;
+static constexpr uint32_t BC5_TYPELESS        = 82;
+static constexpr uint32_t BC5_SNORM           = 84;
+static constexpr uint32_t B8G8R8A8_UNORM      = 87;
+static constexpr uint32_t B8G8R8A8_TYPELESS   = 90;
+static constexpr uint32_t B8G8R8A8_UNORM_SRGB = 91;
+static constexpr uint32_t BC6H_TYPELESS       = 94;
+static constexpr uint32_t BC6H_SF16           = 96;
+static constexpr uint32_t BC7_TYPELESS        = 97;
+static constexpr uint32_t BC7_UNORM_SRGB      = 99;
+
+static uint8_t const weights2[4]  = {0, 21, 43, 64};
+static uint8_t const weights3[8]  = {0, 9, 18, 27, 37, 46, 55, 64};
+static uint8_t const weights4[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+static uint8_t const* const weights[5] = {nullptr, nullptr, weights2, weights3, weights4};
+
+static uint8_t const partitions2[64][16] = {
+	{0, 0, 1, 1, 0, 0, 1, 1, 0, 0, 1, 1, 0, 0, 1, 1}, {0, 0, 0, 1, 0, 0, 0, 1, 0, 0, 0, 1, 0, 0, 0, 1}, {0, 1, 1, 1, 0, 1, 1, 1, 0, 1, 1, 1, 0, 1, 1, 1}, {0, 0, 0, 1, 0, 0, 1, 1, 0, 0, 1, 1, 0, 1, 1, 1},
+	{0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 1, 0, 0, 1, 1}, {0, 0, 1, 1, 0, 1, 1, 1, 0, 1, 1, 1, 1, 1, 1, 1}, {0, 0, 0, 1, 0, 0, 1, 1, 0, 1, 1, 1, 1, 1, 1, 1}, {0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 1, 1, 0, 1, 1, 1},
+	{0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 1, 1}, {0, 0, 1, 1, 0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1}, {0, 0, 0, 0, 0, 0, 0, 1, 0, 1, 1, 1, 1, 1, 1, 1}, {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 1, 1, 1},
+	{0, 0, 0, 1, 0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1}, {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1}, {0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1}, {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1},
+	{0, 0, 0, 0, 1, 0, 0, 0, 1, 1, 1, 0, 1, 1, 1, 1}, {0, 1, 1, 1, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0}, {0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 1, 1, 1, 0}, {0, 1, 1, 1, 0, 0, 1, 1, 0, 0, 0, 1, 0, 0, 0, 0},
+	{0, 0, 1, 1, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0}, {0, 0, 0, 0, 1, 0, 0, 0, 1, 1, 0, 0, 1, 1, 1, 0}, {0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 1, 1, 0, 0}, {0, 1, 1, 1, 0, 0, 1, 1, 0, 0, 1, 1, 0, 0, 0, 1},
+	{0, 0, 1, 1, 0, 0, 0, 1, 0, 0, 0, 1, 0, 0, 0, 0}, {0, 0, 0, 0, 1, 0, 0, 0, 1, 0, 0, 0, 1, 1, 0, 0}, {0, 1, 1, 0, 0, 1, 1, 0, 0, 1, 1, 0, 0, 1, 1, 0}, {0, 0, 1, 1, 0, 1, 1, 0, 0, 1, 1, 0, 1, 1, 0, 0},
+	{0, 0, 0, 1, 0, 1, 1, 1, 1, 1, 1, 0, 1, 0, 0, 0}, {0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0}, {0, 1, 1, 1, 0, 0, 0, 1, 1, 0, 0, 0, 1, 1, 1, 0}, {0, 0, 1, 1, 1, 0, 0, 1, 1, 0, 0, 1, 1, 1, 0, 0},
+	{0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1}, {0, 0, 0, 0, 1, 1, 1, 1, 0, 0, 0, 0, 1, 1, 1, 1}, {0, 1, 0, 1, 1, 0, 1, 0, 0, 1, 0, 1, 1, 0, 1, 0}, {0, 0, 1, 1, 0, 0, 1, 1, 1, 1, 0, 0, 1, 1, 0, 0},
+	{0, 0, 1, 1, 1, 1, 0, 0, 0, 0, 1, 1, 1, 1, 0, 0}, {0, 1, 0, 1, 0, 1, 0, 1, 1, 0, 1, 0, 1, 0, 1, 0}, {0, 1, 1, 0, 1, 0, 0, 1, 0, 1, 1, 0, 1, 0, 0, 1}, {0, 1, 0, 1, 1, 0, 1, 0, 1, 0, 1, 0, 0, 1, 0, 1},
+	{0, 1, 1, 1, 0, 0, 1, 1, 1, 1, 0, 0, 1, 1, 1, 0}, {0, 0, 0, 1, 0, 0, 1, 1, 1, 1, 0, 0, 1, 0, 0, 0}, {0, 0, 1, 1, 0, 0, 1, 0, 0, 1, 0, 0, 1, 1, 0, 0}, {0, 0, 1, 1, 1, 0, 1, 1, 1, 1, 0, 1, 1, 1, 0, 0},
+	{0, 1, 1, 0, 1, 0, 0, 1, 1, 0, 0, 1, 0, 1, 1, 0}, {0, 0, 1, 1, 1, 1, 0, 0, 1, 1, 0, 0, 0, 0, 1, 1}, {0, 1, 1, 0, 0, 1, 1, 0, 1, 0, 0, 1, 1, 0, 0, 1}, {0, 0, 0, 0, 0, 1, 1, 0, 0, 1, 1, 0, 0, 0, 0, 0},
+	{0, 1, 0, 0, 1, 1, 1, 0, 0, 1, 0, 0, 0, 0, 0, 0}, {0, 0, 1, 0, 0, 1, 1, 1, 0, 0, 1, 0, 0, 0, 0, 0}, {0, 0, 0, 0, 0, 0, 1, 0, 0, 1, 1, 1, 0, 0, 1, 0}, {0, 0, 0, 0, 0, 1, 0, 0, 1, 1, 1, 0, 0, 1, 0, 0},
+	{0, 1, 1, 0, 1, 1, 0, 0, 1, 0, 0, 1, 0, 0, 1, 1}, {0, 0, 1, 1, 0, 1, 1, 0, 1, 1, 0, 0, 1, 0, 0, 1}, {0, 1, 1, 0, 0, 0, 1, 1, 1, 0, 0, 1, 1, 1, 0, 0}, {0, 0, 1, 1, 1, 0, 0, 1, 1, 1, 0, 0, 0, 1, 1, 0},
+	{0, 1, 1, 0, 1, 1, 0, 0, 1, 1, 0, 0, 1, 0, 0, 1}, {0, 1, 1, 0, 0, 0, 1, 1, 0, 0, 1, 1, 1, 0, 0, 1}, {0, 1, 1, 1, 1, 1, 1, 0, 1, 0, 0, 0, 0, 0, 0, 1}, {0, 0, 0, 1, 1, 0, 0, 0, 1, 1, 1, 0, 0, 1, 1, 1},
+	{0, 0, 0, 0, 1, 1, 1, 1, 0, 0, 1, 1, 0, 0, 1, 1}, {0, 0, 1, 1, 0, 0, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0}, {0, 0, 1, 0, 0, 0, 1, 0, 1, 1, 1, 0, 1, 1, 1, 0}, {0, 1, 0, 0, 0, 1, 0, 0, 0, 1, 1, 1, 0, 1, 1, 1},
+};
+
+static uint8_t const partitions3[64][16] = {
+	{0, 0, 1, 1, 0, 0, 1, 1, 0, 2, 2, 1, 2, 2, 2, 2}, {0, 0, 0, 1, 0, 0, 1, 1, 2, 2, 1, 1, 2, 2, 2, 1}, {0, 0, 0, 0, 2, 0, 0, 1, 2, 2, 1, 1, 2, 2, 1, 1}, {0, 2, 2, 2, 0, 0, 2, 2, 0, 0, 1, 1, 0, 1, 1, 1},
+	{0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 2, 2, 1, 1, 2, 2}, {0, 0, 1, 1, 0, 0, 1, 1, 0, 0, 2, 2, 0, 0, 2, 2}, {0, 0, 2, 2, 0, 0, 2, 2, 1, 1, 1, 1, 1, 1, 1, 1}, {0, 0, 1, 1, 0, 0, 1, 1, 2, 2, 1, 1, 2, 2, 1, 1},
+	{0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2}, {0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1, 2, 2, 2, 2}, {0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 2, 2, 2, 2}, {0, 0, 1, 2, 0, 0, 1, 2, 0, 0, 1, 2, 0, 0, 1, 2},
+	{0, 1, 1, 2, 0, 1, 1, 2, 0, 1, 1, 2, 0, 1, 1, 2}, {0, 1, 2, 2, 0, 1, 2, 2, 0, 1, 2, 2, 0, 1, 2, 2}, {0, 0, 1, 1, 0, 1, 1, 2, 1, 1, 2, 2, 1, 2, 2, 2}, {0, 0, 1, 1, 2, 0, 0, 1, 2, 2, 0, 0, 2, 2, 2, 0},
+	{0, 0, 0, 1, 0, 0, 1, 1, 0, 1, 1, 2, 1, 1, 2, 2}, {0, 1, 1, 1, 0, 0, 1, 1, 2, 0, 0, 1, 2, 2, 0, 0}, {0, 0, 0, 0, 1, 1, 2, 2, 1, 1, 2, 2, 1, 1, 2, 2}, {0, 0, 2, 2, 0, 0, 2, 2, 0, 0, 2, 2, 1, 1, 1, 1},
+	{0, 1, 1, 1, 0, 1, 1, 1, 0, 2, 2, 2, 0, 2, 2, 2}, {0, 0, 0, 1, 0, 0, 0, 1, 2, 2, 2, 1, 2, 2, 2, 1}, {0, 0, 0, 0, 0, 0, 1, 1, 0, 1, 2, 2, 0, 1, 2, 2}, {0, 0, 0, 0, 1, 1, 0, 0, 2, 2, 1, 0, 2, 2, 1, 0},
+	{0, 1, 2, 2, 0, 1, 2, 2, 0, 0, 1, 1, 0, 0, 0, 0}, {0, 0, 1, 2, 0, 0, 1, 2, 1, 1, 2, 2, 2, 2, 2, 2}, {0, 1, 1, 0, 1, 2, 2, 1, 1, 2, 2, 1, 0, 1, 1, 0}, {0, 0, 0, 0, 0, 1, 1, 0, 1, 2, 2, 1, 1, 2, 2, 1},
+	{0, 0, 2, 2, 1, 1, 0, 2, 1, 1, 0, 2, 0, 0, 2, 2}, {0, 1, 1, 0, 0, 1, 1, 0, 2, 0, 0, 2, 2, 2, 2, 2}, {0, 0, 1, 1, 0, 1, 2, 2, 0, 1, 2, 2, 0, 0, 1, 1}, {0, 0, 0, 0, 2, 0, 0, 0, 2, 2, 1, 1, 2, 2, 2, 1},
+	{0, 0, 0, 0, 0, 0, 0, 2, 1, 1, 2, 2, 1, 2, 2, 2}, {0, 2, 2, 2, 0, 0, 2, 2, 0, 0, 1, 2, 0, 0, 1, 1}, {0, 0, 1, 1, 0, 0, 1, 2, 0, 0, 2, 2, 0, 2, 2, 2}, {0, 1, 2, 0, 0, 1, 2, 0, 0, 1, 2, 0, 0, 1, 2, 0},
+	{0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 0, 0, 0, 0}, {0, 1, 2, 0, 1, 2, 0, 1, 2, 0, 1, 2, 0, 1, 2, 0}, {0, 1, 2, 0, 2, 0, 1, 2, 1, 2, 0, 1, 0, 1, 2, 0}, {0, 0, 1, 1, 2, 2, 0, 0, 1, 1, 2, 2, 0, 0, 1, 1},
+	{0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 0, 0, 0, 0, 1, 1}, {0, 1, 0, 1, 0, 1, 0, 1, 2, 2, 2, 2, 2, 2, 2, 2}, {0, 0, 0, 0, 0, 0, 0, 0, 2, 1, 2, 1, 2, 1, 2, 1}, {0, 0, 2, 2, 1, 1, 2, 2, 0, 0, 2, 2, 1, 1, 2, 2},
+	{0, 0, 2, 2, 0, 0, 1, 1, 0, 0, 2, 2, 0, 0, 1, 1}, {0, 2, 2, 0, 1, 2, 2, 1, 0, 2, 2, 0, 1, 2, 2, 1}, {0, 1, 0, 1, 2, 2, 2, 2, 2, 2, 2, 2, 0, 1, 0, 1}, {0, 0, 0, 0, 2, 1, 2, 1, 2, 1, 2, 1, 2, 1, 2, 1},
+	{0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 2, 2, 2, 2}, {0, 2, 2, 2, 0, 1, 1, 1, 0, 2, 2, 2, 0, 1, 1, 1}, {0, 0, 0, 2, 1, 1, 1, 2, 0, 0, 0, 2, 1, 1, 1, 2}, {0, 0, 0, 0, 2, 1, 1, 2, 2, 1, 1, 2, 2, 1, 1, 2},
+	{0, 2, 2, 2, 0, 1, 1, 1, 0, 1, 1, 1, 0, 2, 2, 2}, {0, 0, 0, 2, 1, 1, 1, 2, 1, 1, 1, 2, 0, 0, 0, 2}, {0, 1, 1, 0, 0, 1, 1, 0, 0, 1, 1, 0, 2, 2, 2, 2}, {0, 0, 0, 0, 0, 0, 0, 0, 2, 1, 1, 2, 2, 1, 1, 2},
+	{0, 1, 1, 0, 0, 1, 1, 0, 2, 2, 2, 2, 2, 2, 2, 2}, {0, 0, 2, 2, 0, 0, 1, 1, 0, 0, 1, 1, 0, 0, 2, 2}, {0, 0, 2, 2, 1, 1, 2, 2, 1, 1, 2, 2, 0, 0, 2, 2}, {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 1, 1, 2},
+	{0, 0, 0, 2, 0, 0, 0, 1, 0, 0, 0, 2, 0, 0, 0, 1}, {0, 2, 2, 2, 1, 2, 2, 2, 0, 2, 2, 2, 1, 2, 2, 2}, {0, 1, 0, 1, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2}, {0, 1, 1, 1, 2, 0, 1, 1, 2, 2, 0, 1, 2, 2, 2, 0},
+};
+
+static uint8_t const anchors2[64] = {
+	15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, //
+	15, 2, 8, 2, 2, 8, 8, 15, 2, 8, 2, 2, 8, 8, 2, 2, //
+	15, 15, 6, 8, 2, 8, 15, 15, 2, 8, 2, 2, 2, 15, 15, 6, //
+	6, 2, 6, 8, 15, 15, 2, 2, 15, 15, 15, 15, 15, 2, 2, 15, //
+};
+
+static uint8_t const anchors3_1[64] = {
+	3, 3, 15, 15, 8, 3, 15, 15, 8, 8, 6, 6, 6, 5, 3, 3, //
+	3, 3, 8, 15, 3, 3, 6, 10, 5, 8, 8, 6, 8, 5, 15, 15, //
+	8, 15, 3, 5, 6, 10, 8, 15, 15, 3, 15, 5, 15, 15, 15, 15, //
+	3, 15, 5, 5, 5, 8, 5, 10, 5, 10, 8, 13, 15, 12, 3, 3, //
+};
+
+static uint8_t const anchors3_2[64] = {
+	15, 8, 8, 3, 15, 15, 3, 8, 15, 15, 15, 15, 15, 15, 15, 8, //
+	15, 8, 15, 3, 15, 8, 15, 8, 3, 15, 6, 10, 15, 15, 10, 8, //
+	15, 3, 15, 10, 10, 8, 9, 10, 6, 15, 8, 15, 3, 6, 6, 8, //
+	15, 3, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 3, 15, 15, 8, //
+};
+
+namespace {
+	/** Little endian bit reader over a single 128-bit block. */
+	class bit_reader {
+		uint64_t _lo;
+		uint64_t _hi;
+		size_t   _pos;
+
+		public:
+		bit_reader(uint8_t const* block) : _pos(0)
+		{
+			memcpy(&_lo, block, sizeof(_lo));
+			memcpy(&_hi, block + sizeof(_lo), sizeof(_hi));
+		}
+
+		uint32_t read(size_t count)
+		{
+			uint64_t value;
+			if (_pos >= 64) {
+				value = _hi >> (_pos - 64);
+			} else if (_pos == 0) {
+				value = _lo;
+			} else {
+				value = (_lo >> _pos) | (_hi << (64 - _pos));
+			}
+			_pos += count;
+			return static_cast<uint32_t>(value & ((1ull << count) - 1));
+		}
+	};
+} // namespace
+
+/** Interpolate all four channels between two 8-bit endpoints with 6-bit weights, as BC7 does. */
+static inline void interpolate(uint8_t const* e0, uint8_t const* e1, uint32_t wc, uint32_t wa, uint8_t* out)
+{
+#ifdef BCN_SSE2
+	// Interleave the endpoints per channel, so a single multiply-add computes (64 - w) * e0 + w * e1 for all of them.
+	uint32_t a, b;
+	memcpy(&a, e0, sizeof(a));
+	memcpy(&b, e1, sizeof(b));
+	__m128i e = _mm_unpacklo_epi8(_mm_unpacklo_epi8(_mm_cvtsi32_si128(static_cast<int>(a)), _mm_cvtsi32_si128(static_cast<int>(b))), _mm_setzero_si128());
+	__m128i w = _mm_set_epi16(static_cast<short>(wa), static_cast<short>(64 - wa), static_cast<short>(wc), static_cast<short>(64 - wc), static_cast<short>(wc), static_cast<short>(64 - wc), static_cast<short>(wc), static_cast<short>(64 - wc));
+	__m128i r = _mm_srli_epi32(_mm_add_epi32(_mm_madd_epi16(e, w), _mm_set1_epi32(32)), 6);
+	r         = _mm_packs_epi32(r, r);
+	r         = _mm_packus_epi16(r, r);
+	uint32_t v = static_cast<uint32_t>(_mm_cvtsi128_si32(r));
+	memcpy(out, &v, sizeof(v));
+#else
+	for (size_t c = 0; c < 3; c++) {
+		out[c] = static_cast<uint8_t>(((64 - wc) * e0[c] + wc * e1[c] + 32) >> 6);
+	}
+	out[3] = static_cast<uint8_t>(((64 - wa) * e0[3] + wa * e1[3] + 32) >> 6);
+#endif
+}
+
+static inline void expand565(uint16_t color, uint8_t* out)
+{
+	uint8_t r = (color >> 11) & 0x1F;
+	uint8_t g = (color >> 5) & 0x3F;
+	uint8_t b = color & 0x1F;
+	out[0]    = static_cast<uint8_t>((r << 3) | (r >> 2));
+	out[1]    = static_cast<uint8_t>((g << 2) | (g >> 4));
+	out[2]    = static_cast<uint8_t>((b << 3) | (b >> 2));
+	out[3]    = 255;
+}
+
+/** BC1 color block, also used by BC2 and BC3 which never use the three color mode. */
+static void decode_color(uint8_t const* src, uint8_t* out, bool three_color)
+{
+	uint16_t c0 = static_cast<uint16_t>(src[0] | (src[1] << 8));
+	uint16_t c1 = static_cast<uint16_t>(src[2] | (src[3] << 8));
+	uint32_t indices;
+	memcpy(&indices, src + 4, sizeof(indices));
+
+	uint8_t palette[4][4];
+	expand565(c0, palette[0]);
+	expand565(c1, palette[1]);
+	if ((c0 > c1) || !three_color) {
+		for (size_t c = 0; c < 3; c++) {
+			palette[2][c] = static_cast<uint8_t>((2 * palette[0][c] + palette[1][c]) / 3);
+			palette[3][c] = static_cast<uint8_t>((palette[0][c] + 2 * palette[1][c]) / 3);
+		}
+		palette[2][3] = palette[3][3] = 255;
+	} else {
+		for (size_t c = 0; c < 3; c++) {
+			palette[2][c] = static_cast<uint8_t>((palette[0][c] + palette[1][c]) / 2);
+			palette[3][c] = 0;
+		}
+		palette[2][3] = 255;
+		palette[3][3] = 0;
+	}
+
+	for (size_t idx = 0; idx < 16; idx++, indices >>= 2) {
+		memcpy(out + idx * 4, palette[indices & 3], 4);
+	}
+}
+
+/** BC3 alpha block, also used for the channels of BC4 and BC5. */
+static void decode_alpha(uint8_t const* src, uint8_t* out, size_t channel, bool is_signed)
+{
+	int32_t palette[8];
+	if (is_signed) {
+		palette[0] = std::max<int32_t>(static_cast<int8_t>(src[0]), -127);
+		palette[1] = std::max<int32_t>(static_cast<int8_t>(src[1]), -127);
+	} else {
+		palette[0] = src[0];
+		palette[1] = src[1];
+	}
+	if (palette[0] > palette[1]) {
+		for (int32_t idx = 1; idx < 7; idx++) {
+			palette[idx + 1] = ((7 - idx) * palette[0] + idx * palette[1]) / 7;
+		}
+	} else {
+		for (int32_t idx = 1; idx < 5; idx++) {
+			palette[idx + 1] = ((5 - idx) * palette[0] + idx * palette[1]) / 5;
+		}
+		palette[6] = is_signed ? -127 : 0;
+		palette[7] = is_signed ? 127 : 255;
+	}
+	if (is_signed) {
+		for (auto& value : palette) {
+			value = (value + 127) * 255 / 254;
+		}
+	}
+
+	uint64_t indices = 0;
+	memcpy(&indices, src + 2, 6);
+	for (size_t idx = 0; idx < 16; idx++, indices >>= 3) {
+		out[idx * 4 + channel] = static_cast<uint8_t>(palette[indices & 7]);
+	}
+}
+
+static void decode_bc7(uint8_t const* src, uint8_t* out)
+{
+	struct mode_t {
+		uint8_t subsets;
+		uint8_t partition_bits;
+		uint8_t rotation_bits;
+		uint8_t selection_bits;
+		uint8_t color_bits;
+		uint8_t alpha_bits;
+		uint8_t endpoint_pbits;
+		uint8_t shared_pbits;
+		uint8_t index_bits;
+		uint8_t index2_bits;
+	};
+	static mode_t const modes[8] = {
+		{3, 4, 0, 0, 4, 0, 1, 0, 3, 0}, //
+		{2, 6, 0, 0, 6, 0, 0, 1, 3, 0}, //
+		{3, 6, 0, 0, 5, 0, 0, 0, 2, 0}, //
+		{2, 6, 0, 0, 7, 0, 1, 0, 2, 0}, //
+		{1, 0, 2, 1, 5, 6, 0, 0, 2, 3}, //
+		{1, 0, 2, 0, 7, 8, 0, 0, 2, 2}, //
+		{1, 0, 0, 0, 7, 7, 1, 0, 4, 0}, //
+		{2, 6, 0, 0, 5, 5, 1, 0, 2, 0}, //
+	};
+
+	bit_reader bits(src);
+
+	size_t mode = 0;
+	while ((mode < 8) && !bits.read(1)) {
+		mode++;
+	}
+	if (mode == 8) { // Reserved, decodes to transparent black.
+		memset(out, 0, 64);
+		return;
+	}
+	auto const& info = modes[mode];
+
+	uint32_t partition = bits.read(info.partition_bits);
+	uint32_t rotation  = bits.read(info.rotation_bits);
+	uint32_t selection = bits.read(info.selection_bits);
+
+	size_t  endpoints = info.subsets * 2u;
+	uint8_t ep[6][4];
+	for (size_t c = 0; c < 3; c++) {
+		for (size_t e = 0; e < endpoints; e++) {
+			ep[e][c] = static_cast<uint8_t>(bits.read(info.color_bits));
+		}
+	}
+	for (size_t e = 0; e < endpoints; e++) {
+		ep[e][3] = info.alpha_bits ? static_cast<uint8_t>(bits.read(info.alpha_bits)) : 255;
+	}
+
+	// Apply p-bits, then expand every endpoint to 8 bits.
+	size_t color_bits = info.color_bits;
+	size_t alpha_bits = info.alpha_bits;
+	if (info.endpoint_pbits || info.shared_pbits) {
+		uint32_t pbits[6];
+		if (info.endpoint_pbits) {
+			for (size_t e = 0; e < endpoints; e++) {
+				pbits[e] = bits.read(1);
+			}
+		} else {
+			for (size_t s = 0; s < info.subsets; s++) {
+				pbits[s * 2] = pbits[s * 2 + 1] = bits.read(1);
+			}
+		}
+		for (size_t e = 0; e < endpoints; e++) {
+			for (size_t c = 0; c < (alpha_bits ? 4u : 3u); c++) {
+				ep[e][c] = static_cast<uint8_t>((ep[e][c] << 1) | pbits[e]);
+			}
+		}
+		color_bits++;
+		if (alpha_bits) {
+			alpha_bits++;
+		}
+	}
+	for (size_t e = 0; e < endpoints; e++) {
+		for (size_t c = 0; c < 3; c++) {
+			ep[e][c] = static_cast<uint8_t>((ep[e][c] << (8 - color_bits)) | (ep[e][c] << (8 - color_bits) >> color_bits));
+		}
+		if (alpha_bits) {
+			ep[e][3] = static_cast<uint8_t>((ep[e][3] << (8 - alpha_bits)) | (ep[e][3] << (8 - alpha_bits) >> alpha_bits));
+		}
+	}
+
+	// Figure out which subset each pixel belongs to, and which pixels are anchors with one less index bit.
+	uint8_t const* subset = nullptr;
+	size_t         anchor1 = 0, anchor2 = 0;
+	static uint8_t const single[16] = {0};
+	if (info.subsets == 3) {
+		subset  = partitions3[partition];
+		anchor1 = anchors3_1[partition];
+		anchor2 = anchors3_2[partition];
+	} else if (info.subsets == 2) {
+		subset  = partitions2[partition];
+		anchor1 = anchor2 = anchors2[partition];
+	} else {
+		subset = single;
+	}
+
+	uint8_t indices[16];
+	for (size_t idx = 0; idx < 16; idx++) {
+		bool anchor  = (idx == 0) || ((info.subsets > 1) && ((idx == anchor1) || (idx == anchor2)));
+		indices[idx] = static_cast<uint8_t>(bits.read(info.index_bits - (anchor ? 1 : 0)));
+	}
+	uint8_t indices2[16];
+	if (info.index2_bits) {
+		for (size_t idx = 0; idx < 16; idx++) {
+			indices2[idx] = static_cast<uint8_t>(bits.read(info.index2_bits - (idx == 0 ? 1 : 0)));
+		}
+	}
+
+	uint8_t const* color_weights = weights[info.index_bits];
+	uint8_t const* alpha_weights = weights[info.index_bits];
+	uint8_t const* color_index   = indices;
+	uint8_t const* alpha_index   = indices;
+	if (info.index2_bits) {
+		alpha_weights = weights[info.index2_bits];
+		alpha_index   = indices2;
+		if (selection) {
+			std::swap(color_weights, alpha_weights);
+			std::swap(color_index, alpha_index);
+		}
+	}
+
+	for (size_t idx = 0; idx < 16; idx++) {
+		size_t   s = subset[idx];
+		uint8_t* p = out + idx * 4;
+		interpolate(ep[s * 2], ep[s * 2 + 1], color_weights[color_index[idx]], alpha_weights[alpha_index[idx]], p);
+		if (rotation) {
+			std::swap(p[3], p[rotation - 1]);
+		}
+	}
+}
+
+static void decode_bc6h(uint8_t const* src, uint8_t* out, bool is_signed)
+{
+	// Endpoint fields: w and x are the first region, y and z the second one.
+	enum : uint8_t { RW, GW, BW, RX, GX, BX, RY, GY, BY, RZ, GZ, BZ };
+
+	/** Bits read one at a time into field, starting at bit 'from' and stepping towards bit 'to'. */
+	struct bits_t {
+		uint8_t field;
+		uint8_t from;
+		uint8_t to;
+	};
+
+	struct mode_t {
+		uint8_t       regions;
+		bool          transformed;
+		uint8_t       endpoint_bits;
+		uint8_t       delta_bits[3];
+		bits_t const* layout;
+		size_t        layout_size;
+	};
+
+	static bits_t const layout1[]  = {{GY, 4, 4}, {BY, 4, 4}, {BZ, 4, 4}, {RW, 0, 9}, {GW, 0, 9}, {BW, 0, 9}, {RX, 0, 4}, {GZ, 4, 4}, {GY, 0, 3}, {GX, 0, 4}, {BZ, 0, 0}, {GZ, 0, 3}, {BX, 0, 4}, {BZ, 1, 1}, {BY, 0, 3}, {RY, 0, 4}, {BZ, 2, 2}, {RZ, 0, 4}, {BZ, 3, 3}};
+	static bits_t const layout2[]  = {{GY, 5, 5}, {GZ, 4, 4}, {GZ, 5, 5}, {RW, 0, 6}, {BZ, 0, 0}, {BZ, 1, 1}, {BY, 4, 4}, {GW, 0, 6}, {BY, 5, 5}, {BZ, 2, 2}, {GY, 4, 4}, {BW, 0, 6}, {BZ, 3, 3}, {BZ, 5, 5}, {BZ, 4, 4}, {RX, 0, 5}, {GY, 0, 3}, {GX, 0, 5}, {GZ, 0, 3}, {BX, 0, 5}, {BY, 0, 3}, {RY, 0, 5}, {RZ, 0, 5}};
+	static bits_t const layout3[]  = {{RW, 0, 9}, {GW, 0, 9}, {BW, 0, 9}, {RX, 0, 4}, {RW, 10, 10}, {GY, 0, 3}, {GX, 0, 3}, {GW, 10, 10}, {BZ, 0, 0}, {GZ, 0, 3}, {BX, 0, 3}, {BW, 10, 10}, {BZ, 1, 1}, {BY, 0, 3}, {RY, 0, 4}, {BZ, 2, 2}, {RZ, 0, 4}, {BZ, 3, 3}};
+	static bits_t const layout4[]  = {{RW, 0, 9}, {GW, 0, 9}, {BW, 0, 9}, {RX, 0, 3}, {RW, 10, 10}, {GZ, 4, 4}, {GY, 0, 3}, {GX, 0, 4}, {GW, 10, 10}, {GZ, 0, 3}, {BX, 0, 3}, {BW, 10, 10}, {BZ, 1, 1}, {BY, 0, 3}, {RY, 0, 3}, {BZ, 0, 0}, {BZ, 2, 2}, {RZ, 0, 3}, {GY, 4, 4}, {BZ, 3, 3}};
+	static bits_t const layout5[]  = {{RW, 0, 9}, {GW, 0, 9}, {BW, 0, 9}, {RX, 0, 3}, {RW, 10, 10}, {BY, 4, 4}, {GY, 0, 3}, {GX, 0, 3}, {GW, 10, 10}, {BZ, 0, 0}, {GZ, 0, 3}, {BX, 0, 4}, {BW, 10, 10}, {BY, 0, 3}, {RY, 0, 3}, {BZ, 1, 1}, {BZ, 2, 2}, {RZ, 0, 3}, {BZ, 4, 4}, {BZ, 3, 3}};
+	static bits_t const layout6[]  = {{RW, 0, 8}, {BY, 4, 4}, {GW, 0, 8}, {GY, 4, 4}, {BW, 0, 8}, {BZ, 4, 4}, {RX, 0, 4}, {GZ, 4, 4}, {GY, 0, 3}, {GX, 0, 4}, {BZ, 0, 0}, {GZ, 0, 3}, {BX, 0, 4}, {BZ, 1, 1}, {BY, 0, 3}, {RY, 0, 4}, {BZ, 2, 2}, {RZ, 0, 4}, {BZ, 3, 3}};
+	static bits_t const layout7[]  = {{RW, 0, 7}, {GZ, 4, 4}, {BY, 4, 4}, {GW, 0, 7}, {BZ, 2, 2}, {GY, 4, 4}, {BW, 0, 7}, {BZ, 3, 3}, {BZ, 4, 4}, {RX, 0, 5}, {GY, 0, 3}, {GX, 0, 4}, {BZ, 0, 0}, {GZ, 0, 3}, {BX, 0, 4}, {BZ, 1, 1}, {BY, 0, 3}, {RY, 0, 5}, {RZ, 0, 5}};
+	static bits_t const layout8[]  = {{RW, 0, 7}, {BZ, 0, 0}, {BY, 4, 4}, {GW, 0, 7}, {GY, 5, 5}, {GY, 4, 4}, {BW, 0, 7}, {GZ, 5, 5}, {BZ, 4, 4}, {RX, 0, 4}, {GZ, 4, 4}, {GY, 0, 3}, {GX, 0, 5}, {GZ, 0, 3}, {BX, 0, 4}, {BZ, 1, 1}, {BY, 0, 3}, {RY, 0, 4}, {BZ, 2, 2}, {RZ, 0, 4}, {BZ, 3, 3}};
+	static bits_t const layout9[]  = {{RW, 0, 7}, {BZ, 1, 1}, {BY, 4, 4}, {GW, 0, 7}, {BY, 5, 5}, {GY, 4, 4}, {BW, 0, 7}, {BZ, 5, 5}, {BZ, 4, 4}, {RX, 0, 4}, {GZ, 4, 4}, {GY, 0, 3}, {GX, 0, 4}, {BZ, 0, 0}, {GZ, 0, 3}, {BX, 0, 5}, {BY, 0, 3}, {RY, 0, 4}, {BZ, 2, 2}, {RZ, 0, 4}, {BZ, 3, 3}};
+	static bits_t const layout10[] = {{RW, 0, 5}, {GZ, 4, 4}, {BZ, 0, 0}, {BZ, 1, 1}, {BY, 4, 4}, {GW, 0, 5}, {GY, 5, 5}, {BY, 5, 5}, {BZ, 2, 2}, {GY, 4, 4}, {BW, 0, 5}, {GZ, 5, 5}, {BZ, 3, 3}, {BZ, 5, 5}, {BZ, 4, 4}, {RX, 0, 5}, {GY, 0, 3}, {GX, 0, 5}, {GZ, 0, 3}, {BX, 0, 5}, {BY, 0, 3}, {RY, 0, 5}, {RZ, 0, 5}};
+	static bits_t const layout11[] = {{RW, 0, 9}, {GW, 0, 9}, {BW, 0, 9}, {RX, 0, 9}, {GX, 0, 9}, {BX, 0, 9}};
+	static bits_t const layout12[] = {{RW, 0, 9}, {GW, 0, 9}, {BW, 0, 9}, {RX, 0, 8}, {RW, 10, 10}, {GX, 0, 8}, {GW, 10, 10}, {BX, 0, 8}, {BW, 10, 10}};
+	static bits_t const layout13[] = {{RW, 0, 9}, {GW, 0, 9}, {BW, 0, 9}, {RX, 0, 7}, {RW, 11, 10}, {GX, 0, 7}, {GW, 11, 10}, {BX, 0, 7}, {BW, 11, 10}};
+	static bits_t const layout14[] = {{RW, 0, 9}, {GW, 0, 9}, {BW, 0, 9}, {RX, 0, 3}, {RW, 15, 10}, {GX, 0, 3}, {GW, 15, 10}, {BX, 0, 3}, {BW, 15, 10}};
+
+#define BC6H_MODE(regions, transformed, bits, dr, dg, db, layout) \
+	mode_t                                                        \
+	{                                                             \
+		regions, transformed, bits, {dr, dg, db}, layout, std::size(layout) \
+	}
+	static mode_t const mode1  = BC6H_MODE(2, true, 10, 5, 5, 5, layout1);
+	static mode_t const mode2  = BC6H_MODE(2, true, 7, 6, 6, 6, layout2);
+	static mode_t const mode3  = BC6H_MODE(2, true, 11, 5, 4, 4, layout3);
+	static mode_t const mode4  = BC6H_MODE(2, true, 11, 4, 5, 4, layout4);
+	static mode_t const mode5  = BC6H_MODE(2, true, 11, 4, 4, 5, layout5);
+	static mode_t const mode6  = BC6H_MODE(2, true, 9, 5, 5, 5, layout6);
+	static mode_t const mode7  = BC6H_MODE(2, true, 8, 6, 5, 5, layout7);
+	static mode_t const mode8  = BC6H_MODE(2, true, 8, 5, 6, 5, layout8);
+	static mode_t const mode9  = BC6H_MODE(2, true, 8, 5, 5, 6, layout9);
+	static mode_t const mode10 = BC6H_MODE(2, false, 6, 6, 6, 6, layout10);
+	static mode_t const mode11 = BC6H_MODE(1, false, 10, 10, 10, 10, layout11);
+	static mode_t const mode12 = BC6H_MODE(1, true, 11, 9, 9, 9, layout12);
+	static mode_t const mode13 = BC6H_MODE(1, true, 12, 8, 8, 8, layout13);
+	static mode_t const mode14 = BC6H_MODE(1, true, 16, 4, 4, 4, layout14);
+#undef BC6H_MODE
+
+	// Indexed by the 5 mode bits. The two bit modes only look at the lowest two bits.
+	static mode_t const* const modes[32] = {
+		&mode1, &mode2, &mode3, &mode11, &mode1, &mode2, &mode4, &mode12, //
+		&mode1, &mode2, &mode5, &mode13, &mode1, &mode2, &mode6, &mode14, //
+		&mode1, &mode2, &mode7, nullptr, &mode1, &mode2, &mode8, nullptr, //
+		&mode1, &mode2, &mode9, nullptr, &mode1, &mode2, &mode10, nullptr, //
+	};
+
+	bit_reader bits(src);
+
+	uint32_t mode_bits = bits.read(2);
+	if (mode_bits >= 2) {
+		mode_bits |= bits.read(3) << 2;
+	}
+	mode_t const* mode = modes[mode_bits];
+	if (!mode) { // Reserved, decodes to black.
+		for (size_t idx = 0; idx < 16; idx++) {
+			out[idx * 4 + 0] = out[idx * 4 + 1] = out[idx * 4 + 2] = 0;
+			out[idx * 4 + 3]                                       = 255;
+		}
+		return;
+	}
+
+	int32_t e[12] = {0};
+	for (size_t idx = 0; idx < mode->layout_size; idx++) {
+		auto const& field = mode->layout[idx];
+		int32_t     step  = (field.from <= field.to) ? 1 : -1;
+		for (int32_t bit = field.from;; bit += step) {
+			e[field.field] |= static_cast<int32_t>(bits.read(1)) << bit;
+			if (bit == field.to) {
+				break;
+			}
+		}
+	}
+	uint32_t partition = (mode->regions == 2) ? bits.read(5) : 0;
+
+	auto sign_extend = [](int32_t value, size_t count) {
+		int32_t shift = 32 - static_cast<int32_t>(count);
+		return static_cast<int32_t>(static_cast<uint32_t>(value) << shift) >> shift;
+	};
+
+	// Undo the delta transform and sign extension.
+	size_t  endpoints = mode->regions * 2u;
+	int32_t mask      = (1 << mode->endpoint_bits) - 1;
+	if (is_signed) {
+		for (size_t c = 0; c < 3; c++) {
+			e[c] = sign_extend(e[c], mode->endpoint_bits);
+		}
+	}
+	for (size_t ep = 1; ep < endpoints; ep++) {
+		for (size_t c = 0; c < 3; c++) {
+			int32_t& value = e[ep * 3 + c];
+			if (mode->transformed) {
+				value = (e[c] + sign_extend(value, mode->delta_bits[c])) & mask;
+			}
+			if (is_signed) {
+				value = sign_extend(value, mode->endpoint_bits);
+			}
+		}
+	}
+
+	// Unquantize the endpoints to 16 bits.
+	int32_t bits_count = mode->endpoint_bits;
+	for (size_t idx = 0; idx < endpoints * 3; idx++) {
+		int32_t& value = e[idx];
+		if (!is_signed) {
+			if (bits_count >= 15) {
+			} else if (value == 0) {
+			} else if (value == mask) {
+				value = 0xFFFF;
+			} else {
+				value = ((value << 16) + 0x8000) >> bits_count;
+			}
+		} else if (bits_count < 16) {
+			bool    negative = value < 0;
+			int32_t v        = negative ? -value : value;
+			if (v == 0) {
+			} else if (v >= ((1 << (bits_count - 1)) - 1)) {
+				v = 0x7FFF;
+			} else {
+				v = ((v << 15) + 0x4000) >> (bits_count - 1);
+			}
+			value = negative ? -v : v;
+		}
+	}
+
+	size_t         index_bits = (mode->regions == 2) ? 3 : 4;
+	uint8_t const* w          = weights[index_bits];
+	size_t         anchor     = (mode->regions == 2) ? anchors2[partition] : 0;
+	for (size_t idx = 0; idx < 16; idx++) {
+		uint32_t index  = bits.read(index_bits - (((idx == 0) || (idx == anchor)) ? 1 : 0));
+		size_t   region = (mode->regions == 2) ? partitions2[partition][idx] : 0;
+		int32_t* e0     = e + region * 6;
+		int32_t* e1     = e0 + 3;
+
+		uint8_t* p = out + idx * 4;
+		for (size_t c = 0; c < 3; c++) {
+			int32_t  v = ((64 - w[index]) * e0[c] + w[index] * e1[c] + 32) >> 6;
+			uint16_t half;
+			if (!is_signed) {
+				half = static_cast<uint16_t>((v * 31) >> 6);
+			} else {
+				v    = (v < 0) ? -(((-v) * 31) >> 5) : ((v * 31) >> 5);
+				half = static_cast<uint16_t>((v < 0) ? (0x8000 | -v) : v);
+			}
+			float f = std::clamp(half_to_float(half), 0.f, 1.f);
+			p[c]    = static_cast<uint8_t>(f * 255.f + .5f);
+		}
+		p[3] = 255;
+	}
+}
+
+bool hellextractor::bcn::supported(uint32_t format)
+{
+	return ((format >= R8G8B8A8_TYPELESS) && (format <= R8G8B8A8_UNORM_SRGB)) //
+		   || ((format >= BC1_TYPELESS) && (format <= BC5_SNORM)) //
+		   || (format == B8G8R8A8_UNORM) || (format == B8G8R8A8_TYPELESS) || (format == B8G8R8A8_UNORM_SRGB) //
+		   || ((format >= BC6H_TYPELESS) && (format <= BC7_UNORM_SRGB));
+}
+
+void hellextractor::bcn::decode(uint32_t format, uint8_t const* data, uint32_t width, uint32_t height, size_t y, size_t rows, uint8_t* pixels, size_t stride)
+{
+	rows = std::min<size_t>(rows, (y < height) ? (height - y) : 0);
+
+	if ((format <= R8G8B8A8_UNORM_SRGB) || (format >= B8G8R8A8_UNORM && format <= B8G8R8A8_UNORM_SRGB)) {
+		bool bgra = (format >= B8G8R8A8_UNORM);
+		for (size_t row = 0; row < rows; row++) {
+			uint8_t const* src = data + (y + row) * width * 4ull;
+			uint8_t*       dst = pixels + row * stride;
+			memcpy(dst, src, width * 4ull);
+			if (bgra) {
+				for (size_t x = 0; x < width; x++) {
+					std::swap(dst[x * 4], dst[x * 4 + 2]);
+				}
+			}
+		}
+		return;
+	}
+
+	size_t block_bytes = (((format >= BC1_TYPELESS) && (format <= BC1_UNORM_SRGB)) || ((format >= BC4_TYPELESS) && (format <= BC4_SNORM))) ? 8 : 16;
+	size_t blocks_x    = (width + 3) / 4;
+
+	uint8_t block[64];
+	for (size_t by = y / 4; by * 4 < y + rows; by++) {
+		uint8_t const* src = data + by * blocks_x * block_bytes;
+		for (size_t bx = 0; bx < blocks_x; bx++, src += block_bytes) {
+			if (format <= BC1_UNORM_SRGB) {
+				decode_color(src, block, true);
+			} else if (format <= BC2_UNORM_SRGB) {
+				decode_color(src + 8, block, false);
+				for (size_t idx = 0; idx < 16; idx++) {
+					uint8_t a          = (src[idx / 2] >> ((idx & 1) * 4)) & 0xF;
+					block[idx * 4 + 3] = static_cast<uint8_t>(a | (a << 4));
+				}
+			} else if (format <= BC3_UNORM_SRGB) {
+				decode_color(src + 8, block, false);
+				decode_alpha(src, block, 3, false);
+			} else if (format <= BC4_SNORM) {
+				decode_alpha(src, block, 0, format == BC4_SNORM);
+				for (size_t idx = 0; idx < 16; idx++) {
+					block[idx * 4 + 1] = block[idx * 4 + 2] = block[idx * 4];
+					block[idx * 4 + 3]                      = 255;
+				}
+			} else if (format <= BC5_SNORM) {
+				decode_alpha(src, block, 0, format == BC5_SNORM);
+				decode_alpha(src + 8, block, 1, format == BC5_SNORM);
+				for (size_t idx = 0; idx < 16; idx++) {
+					block[idx * 4 + 2] = 0;
+					block[idx * 4 + 3] = 255;
+				}
+			} else if (format <= BC6H_SF16) {
+				decode_bc6h(src, block, format == BC6H_SF16);
+			} else {
+				decode_bc7(src, block);
+			}
+
+			// Copy the part of the block that is inside the image and the requested rows.
+			size_t columns = std::min<size_t>(4, width - bx * 4);
+			for (size_t row = 0; row < 4; row++) {
+				size_t py = by * 4 + row;
+				if ((py < y) || (py >= y + rows)) {
+					continue;
+				}
+				memcpy(pixels + (py - y) * stride + bx * 16, block + row * 16, columns * 4);
+			}
+		}
+	}
+}
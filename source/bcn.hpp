@@ -0,0 +1,29 @@
+// Copyright 2024 Michael Fabian 'Xaymar' Dirks <info@xaymar.com>
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#pragma once
+#include <cinttypes>
+#include <cstddef>
+
+namespace hellextractor::bcn {
+	/** Check if pixel data in the given DXGI format can be decoded. */
+	bool supported(uint32_t format);
+
+	/** Decode the pixel rows [y, y + rows) of an image into 8-bit RGBA.
+	 *
+	 * Block compressed formats (BC1 to BC7) are decoded a full row of blocks at a time, so y must be a multiple of 4.
+	 * BC4 and BC5 are expanded to grayscale and red/green, and BC6H is clamped to [0, 1] without any tone mapping.
+	 *
+	 * @param data Pixel data of the whole mip level.
+	 * @param pixels Output for the first decoded row, with stride bytes between rows.
+	 */
+	void decode(uint32_t format, uint8_t const* data, uint32_t width, uint32_t height, size_t y, size_t rows, uint8_t* pixels, size_t stride);
+} // namespace hellextractor::bcn
@@ -0,0 +1,122 @@
+// Copyright 2024 Michael Fabian 'Xaymar' Dirks <info@xaymar.com>
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "content_store.hpp"
+#include <stdexcept>
+#include "string_printf.hpp"
+
+hellextractor::content_store::~content_store() {}
+
+hellextractor::content_store::content_store(std::filesystem::path root, link mode, std::filesystem::path manifest_path) : _root(root), _mode(mode), _known(), _stored(0), _reused(0)
+{
+	_hasher = hellextractor::hash::instance::create(hellextractor::hash::type::SHA256);
+	if (!_hasher) {
+		throw std::runtime_error("SHA-256 is not available on this platform.");
+	}
+
+	std::filesystem::create_directories(_root);
+
+	if (_mode == link::MANIFEST) {
+		std::filesystem::create_directories(manifest_path.parent_path());
+		_manifest = std::ofstream{manifest_path, std::ios::trunc | std::ios::out};
+		if (!_manifest.is_open()) {
+			throw std::runtime_error(string_printf("Failed to open manifest '%s' for writing.", manifest_path.generic_string().c_str()));
+		}
+	}
+}
+
+std::string hellextractor::content_store::add(std::filesystem::path const& path, std::string const& name, std::vector<std::pair<void const*, size_t>> const& sections)
+{
+	// Hash the payload one section at a time, so that it never has to be copied.
+	std::vector<char> digest = _hasher->hash_sections(sections);
+	size_t            size   = 0;
+	for (auto const& section : sections) {
+		size += section.second;
+	}
+
+	std::string hash;
+	hash.reserve(digest.size() * 2);
+	for (auto c : digest) {
+		hash.append(string_printf("%02x", static_cast<uint8_t>(c)));
+	}
+
+	// Store the blob if we haven't seen it yet. Blobs are written to a temporary name first, so that an interrupted
+	// run never leaves a truncated blob behind under its final name.
+	auto blob_path = _root / hash.substr(0, 2) / hash;
+	if (_known.insert(hash).second && !std::filesystem::exists(blob_path)) {
+		std::filesystem::create_directories(blob_path.parent_path());
+
+		auto temp_path = std::filesystem::path(blob_path).concat(".tmp");
+		{
+			std::ofstream stream{temp_path, std::ios::trunc | std::ios::binary | std::ios::out};
+			if (!stream || stream.bad() || !stream.is_open()) {
+				throw std::runtime_error(string_printf("Failed to write blob '%s'.", temp_path.generic_string().c_str()));
+			}
+			for (auto const& section : sections) {
+				stream.write(reinterpret_cast<char const*>(section.first), section.second);
+			}
+			stream.close();
+		}
+		std::filesystem::rename(temp_path, blob_path);
+		_stored++;
+	} else {
+		_reused++;
+	}
+
+	// Materialize the output.
+	switch (_mode) {
+	case link::HARDLINK: {
+		std::filesystem::remove(path);
+		std::error_code ec;
+		std::filesystem::create_hard_link(blob_path, path, ec);
+		if (ec) {
+			// Hard links can't cross file systems, so fall back to a plain copy.
+			std::filesystem::copy_file(blob_path, path, std::filesystem::copy_options::overwrite_existing);
+		}
+		break;
+	}
+	case link::SYMLINK:
+		std::filesystem::remove(path);
+		std::filesystem::create_symlink(std::filesystem::relative(blob_path, path.parent_path()), path);
+		break;
+	case link::MANIFEST:
+		_manifest << hash << "," << size << "," << name << std::endl;
+		break;
+	}
+
+	return hash;
+}
+
+hellextractor::content_store::link hellextractor::content_store::mode() const
+{
+	return _mode;
+}
+
+size_t hellextractor::content_store::stored() const
+{
+	return _stored;
+}
+
+size_t hellextractor::content_store::reused() const
+{
+	return _reused;
+}
+
+hellextractor::content_store::link hellextractor::content_store::parse(std::string_view mode)
+{
+	if (mode == "hardlink") {
+		return link::HARDLINK;
+	} else if (mode == "symlink") {
+		return link::SYMLINK;
+	} else if (mode == "manifest") {
+		return link::MANIFEST;
+	}
+	throw std::invalid_argument(string_printf("Unknown link mode '%.*s'.", static_cast<int>(mode.size()), mode.data()));
+}
@@ -0,0 +1,67 @@
+// Copyright 2024 Michael Fabian 'Xaymar' Dirks <info@xaymar.com>
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+#include <cinttypes>
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+#include "hasher.hpp"
+
+namespace hellextractor {
+	/** Content-addressed output store.
+	 *
+	 * Every payload is hashed with SHA-256 and stored once as <root>/<aa>/<hash>. The named output file is then
+	 * materialized as a hard link or symbolic link to that blob, or only recorded in a manifest.
+	 */
+	class content_store {
+		public:
+		enum class link {
+			HARDLINK,
+			SYMLINK,
+			MANIFEST,
+		};
+
+		private:
+		std::filesystem::path                          _root;
+		link                                           _mode;
+		std::shared_ptr<hellextractor::hash::instance> _hasher;
+		std::unordered_set<std::string>                _known;
+		std::ofstream                                  _manifest;
+
+		size_t _stored;
+		size_t _reused;
+
+		public:
+		~content_store();
+		content_store(std::filesystem::path root, link mode, std::filesystem::path manifest_path);
+
+		/** Store the payload made up of the given sections, then materialize it as the output file.
+		 *
+		 * @param path Absolute path of the output file. Unused with link::MANIFEST.
+		 * @param name Name of the output file relative to the output directory, as written to the manifest.
+		 * @return Hex encoded hash of the payload.
+		 */
+		std::string add(std::filesystem::path const& path, std::string const& name, std::vector<std::pair<void const*, size_t>> const& sections);
+
+		link mode() const;
+
+		size_t stored() const;
+
+		size_t reused() const;
+
+		static link parse(std::string_view mode);
+	};
+} // namespace hellextractor
@@ -9,35 +9,122 @@
 // THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "converter.hpp"
-#include <map>
+#include <algorithm>
+#include "converter_bik.hpp"
+#include "converter_texture.hpp"
+#include "converter_unit.hpp"
+#include "converter_wwise_bank.hpp"
+#include "converter_wwise_stream.hpp"
 #include "endian.h"
 
-typedef std::map<uint64_t, hellextractor::converter::registry::function_t> registry_t;
-
-static registry_t& get_registry()
+template<typename T>
+static std::unique_ptr<hellextractor::converter::base> construct(hellextractor::converter::options_t const& options)
 {
-	static registry_t list;
-	return list;
+	return std::make_unique<T>(options);
 }
 
-std::shared_ptr<hellextractor::converter::base> hellextractor::converter::registry::find(stingray::data_110000F0::meta_t meta)
+namespace {
+	struct entry_t {
+		uint64_t         type;
+		std::string_view name;
+		std::unique_ptr<hellextractor::converter::base> (*create)(hellextractor::converter::options_t const&);
+	};
+} // namespace
+
+static constexpr entry_t registry[] = {
+	{0x0e44215d23554b50ull, "wwise_stream", &construct<hellextractor::converter::wwise_stream>},
+	{0x18fa2930f06559aaull, "bik", &construct<hellextractor::converter::bik>},
+	{0x329ec6a0c63842cdull, "texture", &construct<hellextractor::converter::texture>},
+	{0x3f45a7e90b8da4e0ull, "unit", &construct<hellextractor::converter::unit>},
+	{0x99d750e6d37b5a53ull, "wwise_bank", &construct<hellextractor::converter::wwise_bank>},
+};
+static_assert(std::is_sorted(std::begin(registry), std::end(registry), [](entry_t const& a, entry_t const& b) { return a.type < b.type; }), "The registry must be sorted by type.");
+
+std::shared_ptr<hellextractor::converter::base> hellextractor::converter::registry::find(stingray::data_110000F0::meta_t meta, hellextractor::converter::options_t const& options)
 {
-	if (auto kv = get_registry().find(meta.file.type); kv != get_registry().end()) {
-		return kv->second(meta);
+	if (size_t idx = index(meta.file.type); idx < size()) {
+		std::shared_ptr<base> converter = create(idx, options);
+		converter->load(meta);
+		return converter;
 	}
 	return nullptr;
 }
 
-hellextractor::converter::registry::do_register::do_register(std::list<stingray::hash_t> types, function_t fn)
+size_t hellextractor::converter::registry::index(stingray::hash_t type)
+{
+	auto kv = std::lower_bound(std::begin(::registry), std::end(::registry), static_cast<uint64_t>(type), [](entry_t const& entry, uint64_t type) { return entry.type < type; });
+	if ((kv != std::end(::registry)) && (kv->type == static_cast<uint64_t>(type))) {
+		return static_cast<size_t>(kv - std::begin(::registry));
+	}
+	return size();
+}
+
+size_t hellextractor::converter::registry::size()
+{
+	return std::size(::registry);
+}
+
+std::string_view hellextractor::converter::registry::name(size_t index)
+{
+	if (index >= size()) {
+		throw std::out_of_range("idx >= edx");
+	}
+	return ::registry[index].name;
+}
+
+std::unique_ptr<hellextractor::converter::base> hellextractor::converter::registry::create(size_t index, hellextractor::converter::options_t const& options)
+{
+	if (index >= size()) {
+		throw std::out_of_range("idx >= edx");
+	}
+	return ::registry[index].create(options);
+}
+
+hellextractor::converter::pool::~pool() {}
+
+hellextractor::converter::pool::pool(hellextractor::converter::options_t options) : _options(std::move(options)), _instances(registry::size()) {}
+
+hellextractor::converter::base* hellextractor::converter::pool::find(stingray::data_110000F0::meta_t meta)
 {
-	for (auto& type : types) {
-		get_registry().try_emplace(type, fn);
+	size_t idx = registry::index(meta.file.type);
+	if (idx >= _instances.size()) {
+		return nullptr;
+	}
+
+	if (!_instances[idx]) {
+		_instances[idx] = registry::create(idx, _options);
 	}
+	_instances[idx]->load(meta);
+	return _instances[idx].get();
 }
 
 hellextractor::converter::base::~base() {}
 
-hellextractor::converter::base::base(stingray::data_110000F0::meta_t meta) : _meta(meta) {}
+hellextractor::converter::base::base(hellextractor::converter::options_t const& options) : _options(options), _outputs() {}
+
+void hellextractor::converter::base::load(stingray::data_110000F0::meta_t)
+{
+	_outputs.clear();
+}
+
+std::vector<hellextractor::converter::output_t> const& hellextractor::converter::base::outputs() const
+{
+	return _outputs;
+}
+
+void hellextractor::converter::base::extract(std::string_view section, std::filesystem::path path) const
+{
+	hellextractor::file_sink sink{path};
+	extract(section, sink);
+	sink.close();
+}
+
+void hellextractor::converter::base::extract(std::string_view section, std::ostream& stream) const
+{
+	hellextractor::stream_sink sink{stream};
+	extract(section, sink);
+	sink.close();
+}
 
 //
 //auto filter = [](std::filesystem::path const& path) {
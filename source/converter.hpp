@@ -9,46 +9,95 @@
 // THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #pragma once
-#include <functional>
-#include <list>
-#include <map>
+#include <cinttypes>
 #include <memory>
 #include <ostream>
-#include <string>
+#include <string_view>
+#include <vector>
+#include "sink.hpp"
 #include "stingray.hpp"
 #include "stingray_data.hpp"
 
+namespace hellextractor {
+	class vorbis_codebooks;
+} // namespace hellextractor
+
 namespace hellextractor::converter {
 	class base;
 
+	/** Settings for all converters of a run. The defaults only export files the way they are stored. */
+	struct options_t {
+		int32_t                                                mip_limit   = 0; // See stingray::texture::texture.
+		size_t                                                 png_threads = 0; // Threads per PNG, 0 disables them.
+		bool                                                   glb         = false; // Also export units as binary glTF.
+		std::shared_ptr<hellextractor::vorbis_codebooks const> codebooks; // Also export Wwise Vorbis streams as Ogg.
+	};
+
+	/** Description of a single output of a converter. */
+	struct output_t {
+		std::string_view section; // Passed back to extract().
+		std::string_view extension; // Replaces the extension of the file name.
+		size_t           size; // Exact size in bytes, or 0 if unknown.
+	};
+
+	/** Compile-time table of all converters, sorted by the type they handle. */
 	class registry {
 		public:
-		static std::shared_ptr<hellextractor::converter::base> find(stingray::data_110000F0::meta_t meta);
+		/** Create a new converter loaded with the file, or nullptr if there is none for its type. */
+		static std::shared_ptr<hellextractor::converter::base> find(stingray::data_110000F0::meta_t meta, hellextractor::converter::options_t const& options = {});
+
+		/** Index of the converter for a type, or size() if there is none. */
+		static size_t index(stingray::hash_t type);
+
+		static size_t size();
+
+		static std::string_view name(size_t index);
+
+		static std::unique_ptr<hellextractor::converter::base> create(size_t index, hellextractor::converter::options_t const& options = {});
+	};
+
+	/** Keeps one converter of every kind around, so that they can be reused from one file to the next.
+	 *
+	 * Not thread-safe, every worker needs its own pool.
+	 */
+	class pool {
+		hellextractor::converter::options_t                          _options;
+		std::vector<std::unique_ptr<hellextractor::converter::base>> _instances;
 
 		public:
-		typedef std::function<std::shared_ptr<hellextractor::converter::base>(stingray::data_110000F0::meta_t meta)> function_t;
+		~pool();
+		pool(hellextractor::converter::options_t options = {});
 
-		struct do_register {
-			public:
-			do_register(std::list<stingray::hash_t> types, function_t fn);
-		};
+		/** Converter loaded with the file, or nullptr if there is none for its type. Valid until the next call. */
+		hellextractor::converter::base* find(stingray::data_110000F0::meta_t meta);
 	};
 
 	class base {
 		protected:
-		stingray::data_110000F0::meta_t _meta;
+		hellextractor::converter::options_t _options;
+		std::vector<output_t>               _outputs;
 
 		public:
 		virtual ~base();
-		base(stingray::data_110000F0::meta_t meta);
+		base(hellextractor::converter::options_t const& options);
 
-		/** Retrieve a list of outputs
-		 * 
-		 * Key is the section that is exported.
-		 * Value is a pair of size and the suffix to the file name.
-		 */
-		virtual std::map<std::string, std::pair<size_t, std::string>> outputs() = 0;
+		/** Load another file, replacing everything from the previous one, and describe its outputs. */
+		virtual void load(stingray::data_110000F0::meta_t meta);
 
-		virtual void extract(std::string section, std::filesystem::path path) = 0;
+		/** Outputs of the loaded file. The views stay valid until the next call to load(). */
+		std::vector<output_t> const& outputs() const;
+
+		/** Extract a section into a file at the given path. */
+		void extract(std::string_view section, std::filesystem::path path) const;
+
+		/** Extract a section into an already open stream. */
+		void extract(std::string_view section, std::ostream& stream) const;
+
+		/** Extract a section into a sink. The caller closes the sink afterwards.
+		 *
+		 * May be called for several sections at once from different threads, as long as nothing loads another file in
+		 * the meantime. Implementations must therefore not change any state.
+		 */
+		virtual void extract(std::string_view section, hellextractor::sink& sink) const = 0;
 	};
 } // namespace hellextractor::converter
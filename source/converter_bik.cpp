@@ -9,46 +9,28 @@
 // THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "converter_bik.hpp"
-#include <fstream>
 #include <string_view>
 #include "converter.hpp"
 #include "endian.h"
 
 static constexpr std::string_view section_default = "bik";
 
-static auto instance = hellextractor::converter::registry::do_register(
-	std::list<stingray::hash_t>{
-		0x18fa2930f06559aaull,
-	},
-	[](stingray::data_110000F0::meta_t meta) { return std::make_shared<hellextractor::converter::bik>(meta); });
-
 hellextractor::converter::bik::~bik() {}
 
-hellextractor::converter::bik::bik(stingray::data_110000F0::meta_t meta) : base(meta), _bik(meta) {}
+hellextractor::converter::bik::bik(hellextractor::converter::options_t const& options) : base(options), _bik() {}
 
-std::map<std::string, std::pair<size_t, std::string>> hellextractor::converter::bik::outputs()
+void hellextractor::converter::bik::load(stingray::data_110000F0::meta_t meta)
 {
-	return {
-		{std::string{section_default},
-		 {
-			 _bik.size(),
-			 _bik.extension(),
-		 }},
-	};
+	base::load(meta);
+	_bik.emplace(meta);
+	_outputs.push_back({section_default, _bik->extension(), _bik->size()});
 }
 
-void hellextractor::converter::bik::extract(std::string section, std::filesystem::path path)
+void hellextractor::converter::bik::extract(std::string_view section, hellextractor::sink& sink) const
 {
 	if (section_default == section) { // Extract "texture" section.
-		std::ofstream stream{path, std::ios::trunc | std::ios::binary | std::ios::out};
-		if (!stream || stream.bad() || !stream.is_open()) {
-			throw std::runtime_error("Unable to open output file");
-		}
-
-		for (auto const& section : _bik.sections()) {
-			stream.write(reinterpret_cast<char const*>(section.first), section.second);
-		}
-
-		stream.close();
+		auto sections = _bik->sections();
+		sink.reserve(sections.total());
+		sink.write(sections);
 	}
 }
@@ -9,47 +9,48 @@
 // THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "converter_texture.hpp"
-#include <fstream>
 #include <string_view>
+#include "bcn.hpp"
 #include "converter.hpp"
 #include "endian.h"
+#include "png.hpp"
 #include "stingray_texture.hpp"
 
 static constexpr std::string_view section_default = "texture";
-
-static auto instance = hellextractor::converter::registry::do_register(
-	std::list<stingray::hash_t>{
-		0x329ec6a0c63842cdull,
-	},
-	[](stingray::data_110000F0::meta_t meta) { return std::make_shared<hellextractor::converter::texture>(meta); });
+static constexpr std::string_view section_png     = "png";
 
 hellextractor::converter::texture::~texture() {}
 
-hellextractor::converter::texture::texture(stingray::data_110000F0::meta_t meta) : base(meta), _texture(meta) {}
+hellextractor::converter::texture::texture(hellextractor::converter::options_t const& options) : base(options), _texture() {}
 
-std::map<std::string, std::pair<size_t, std::string>> hellextractor::converter::texture::outputs()
+void hellextractor::converter::texture::load(stingray::data_110000F0::meta_t meta)
 {
-	return {
-		{std::string{section_default},
-		 {
-			 _texture.size(),
-			 _texture.extension(),
-		 }},
-	};
+	base::load(meta);
+	_texture.emplace(meta, _options.mip_limit);
+	_outputs.push_back({section_default, _texture->extension(), _texture->size()});
+
+	// The size of the PNG isn't known until it has been encoded.
+	if (_options.png_threads && (_texture->extension() == "dds") && hellextractor::bcn::supported(_texture->format())) {
+		_outputs.push_back({section_png, "png", 0});
+	}
 }
 
-void hellextractor::converter::texture::extract(std::string section, std::filesystem::path path)
+void hellextractor::converter::texture::extract(std::string_view section, hellextractor::sink& sink) const
 {
 	if (section_default == section) { // Extract "texture" section.
-		std::ofstream stream{path, std::ios::trunc | std::ios::binary | std::ios::out};
-		if (!stream || stream.bad() || !stream.is_open()) {
-			throw std::runtime_error("Unable to open output file");
-		}
-
-		for (auto const& section : _texture.sections()) {
-			stream.write(reinterpret_cast<char const*>(section.first), section.second);
-		}
-
-		stream.close();
+		auto sections = _texture->sections();
+		sink.reserve(sections.total());
+		sink.write(sections);
+	} else if (section_png == section) { // Decode the largest exported mip level straight from the mapped data.
+		auto format = _texture->format();
+		auto pixels = _texture->pixels();
+		auto width  = _texture->width();
+		auto height = _texture->height();
+		hellextractor::png::encode(
+			sink.stream(), width, height,
+			[format, pixels, width, height](size_t y, size_t rows, uint8_t* out, size_t stride) {
+				hellextractor::bcn::decode(format, pixels, width, height, y, rows, out, stride);
+			},
+			_options.png_threads);
 	}
 }
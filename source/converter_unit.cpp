@@ -9,46 +9,41 @@
 // THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "converter_unit.hpp"
-#include <fstream>
 #include <string_view>
 #include "converter.hpp"
 #include "endian.h"
 
 static constexpr std::string_view section_default = "unit";
-
-static auto instance = hellextractor::converter::registry::do_register(
-	std::list<stingray::hash_t>{
-		0x3f45a7e90b8da4e0ull,
-	},
-	[](stingray::data_110000F0::meta_t meta) { return std::make_shared<hellextractor::converter::unit>(meta); });
+static constexpr std::string_view section_glb     = "glb";
 
 hellextractor::converter::unit::~unit() {}
 
-hellextractor::converter::unit::unit(stingray::data_110000F0::meta_t meta) : base(meta), _meta(meta) {}
+hellextractor::converter::unit::unit(hellextractor::converter::options_t const& options) : base(options), _unit(), _glb() {}
 
-std::map<std::string, std::pair<size_t, std::string>> hellextractor::converter::unit::outputs()
+void hellextractor::converter::unit::load(stingray::data_110000F0::meta_t meta)
 {
-	return {
-		{std::string{section_default},
-		 {
-			 _meta.size(),
-			 "unit",
-		 }},
-	};
+	base::load(meta);
+	_glb.reset();
+	_unit.emplace(meta);
+	_outputs.push_back({section_default, "unit", _unit->size()});
+
+	// Planning the glb scans all vertices for their bounds, so only do it when it was asked for.
+	if (_options.glb) {
+		_glb.emplace(*_unit);
+		if (!_glb->empty()) {
+			_outputs.push_back({section_glb, "glb", _glb->size()});
+		}
+	}
 }
 
-void hellextractor::converter::unit::extract(std::string section, std::filesystem::path path)
+void hellextractor::converter::unit::extract(std::string_view section, hellextractor::sink& sink) const
 {
 	if (section_default == section) {
-		std::ofstream stream{path, std::ios::trunc | std::ios::binary | std::ios::out};
-		if (!stream || stream.bad() || !stream.is_open()) {
-			throw std::runtime_error("Unable to open output file");
-		}
-
-		for (auto const& section : _meta.sections()) {
-			stream.write(reinterpret_cast<char const*>(section.first), section.second);
-		}
-
-		stream.close();
+		auto sections = _unit->sections();
+		sink.reserve(sections.total());
+		sink.write(sections);
+	} else if (section_glb == section) {
+		sink.reserve(_glb->size());
+		_glb->write(sink.stream());
 	}
 }
@@ -9,46 +9,76 @@
 // THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "converter_wwise_bank.hpp"
-#include <fstream>
+#include <charconv>
+#include <cstdio>
 #include <string_view>
 #include "converter.hpp"
 #include "endian.h"
+#include "string_printf.hpp"
 
 static constexpr std::string_view section_default = "bnk";
+static constexpr std::string_view section_hirc    = "hirc";
+static constexpr std::string_view section_media   = "media.";
 
-static auto instance = hellextractor::converter::registry::do_register(
-	std::list<stingray::hash_t>{
-		0x99d750e6d37b5a53ull,
-	},
-	[](stingray::data_110000F0::meta_t meta) { return std::make_shared<hellextractor::converter::wwise_bank>(meta); });
+/** Id of the embedded WEM a section refers to, if it is one. */
+static bool media_id(std::string_view section, uint32_t& id)
+{
+	if (section.substr(0, section_media.size()) != section_media) {
+		return false;
+	}
+	section.remove_prefix(section_media.size());
+	return std::from_chars(section.data(), section.data() + section.size(), id).ec == std::errc{};
+}
 
 hellextractor::converter::wwise_bank::~wwise_bank() {}
 
-hellextractor::converter::wwise_bank::wwise_bank(stingray::data_110000F0::meta_t meta) : base(meta), _data(meta) {}
+hellextractor::converter::wwise_bank::wwise_bank(hellextractor::converter::options_t const& options) : base(options), _data(), _hirc(), _names() {}
 
-std::map<std::string, std::pair<size_t, std::string>> hellextractor::converter::wwise_bank::outputs()
+void hellextractor::converter::wwise_bank::load(stingray::data_110000F0::meta_t meta)
 {
-	return {
-		{std::string{section_default},
-		 {
-			 _data.size(),
-			 _data.extension(),
-		 }},
-	};
+	base::load(meta);
+	_data.emplace(meta);
+	_hirc.clear();
+	_names.clear();
+	_outputs.push_back({section_default, _data->extension(), _data->size()});
+
+	// Every embedded WEM is written as its own file, straight from the bank. Each "media.<id>.wem" name holds both the
+	// section ("media.<id>") and the extension ("<id>.wem"), and all of them share one buffer.
+	auto const& media = _data->media();
+	for (auto const& entry : media) {
+		char buffer[32];
+		int  length = snprintf(buffer, sizeof(buffer), "%s%" PRIu32 ".wem", section_media.data(), entry.id);
+		_names.append(buffer, static_cast<size_t>(length));
+	}
+	std::string_view names = _names;
+	for (auto const& entry : media) {
+		size_t length = names.find(".wem") + 4;
+		auto   name   = names.substr(0, length);
+		_outputs.push_back({name.substr(0, length - 4), name.substr(section_media.size()), entry.size});
+		names.remove_prefix(length);
+	}
+
+	// A compact index of the HIRC objects, one "id,type,size" line per object.
+	for (auto const& object : _data->objects()) {
+		_hirc += string_printf("%" PRIu32 ",%" PRIu8 ",%" PRIu32 "\n", object.id, object.type, object.size);
+	}
+	if (!_hirc.empty()) {
+		_outputs.push_back({section_hirc, "hirc.csv", _hirc.size()});
+	}
 }
 
-void hellextractor::converter::wwise_bank::extract(std::string section, std::filesystem::path path)
+void hellextractor::converter::wwise_bank::extract(std::string_view section, hellextractor::sink& sink) const
 {
 	if (section_default == section) {
-		std::ofstream stream{path, std::ios::trunc | std::ios::binary | std::ios::out};
-		if (!stream || stream.bad() || !stream.is_open()) {
-			throw std::runtime_error("Unable to open output file");
+		auto sections = _data->sections();
+		sink.reserve(sections.total());
+		sink.write(sections);
+	} else if (section_hirc == section) {
+		sink.write(_hirc.data(), _hirc.size());
+	} else if (uint32_t id; media_id(section, id)) {
+		if (auto media = _data->find_media(id); media) {
+			sink.reserve(media->size);
+			sink.write({{media->data, media->size}});
 		}
-
-		for (auto const& section : _data.sections()) {
-			stream.write(reinterpret_cast<char const*>(section.first), section.second);
-		}
-
-		stream.close();
 	}
 }
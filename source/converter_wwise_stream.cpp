@@ -9,46 +9,44 @@
 // THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "converter_wwise_stream.hpp"
-#include <fstream>
 #include <string_view>
 #include "converter.hpp"
 #include "endian.h"
 
 static constexpr std::string_view section_default = "wem";
-
-static auto instance = hellextractor::converter::registry::do_register(
-	std::list<stingray::hash_t>{
-		0x0e44215d23554b50ull,
-	},
-	[](stingray::data_110000F0::meta_t meta) { return std::make_shared<hellextractor::converter::wwise_stream>(meta); });
+static constexpr std::string_view section_ogg     = "ogg";
 
 hellextractor::converter::wwise_stream::~wwise_stream() {}
 
-hellextractor::converter::wwise_stream::wwise_stream(stingray::data_110000F0::meta_t meta) : base(meta), _data(meta) {}
+hellextractor::converter::wwise_stream::wwise_stream(hellextractor::converter::options_t const& options) : base(options), _data(), _vorbis() {}
 
-std::map<std::string, std::pair<size_t, std::string>> hellextractor::converter::wwise_stream::outputs()
+void hellextractor::converter::wwise_stream::load(stingray::data_110000F0::meta_t meta)
 {
-	return {
-		{std::string{section_default},
-		 {
-			 _data.size(),
-			 _data.extension(),
-		 }},
-	};
+	base::load(meta);
+	_vorbis.reset();
+	_data.emplace(meta);
+	_outputs.push_back({section_default, _data->extension(), _data->size()});
+
+	// Streams which aren't Vorbis, or use a layout that isn't supported, are only exported as they are.
+	if (_options.codebooks) {
+		try {
+			auto sections = _data->sections();
+			_vorbis       = std::make_shared<hellextractor::wem_vorbis>(reinterpret_cast<uint8_t const*>(sections[0].first), sections[0].second, *_options.codebooks);
+			_outputs.push_back({section_ogg, "ogg", _vorbis->size()});
+		} catch (std::exception const&) {
+			_vorbis.reset();
+		}
+	}
 }
 
-void hellextractor::converter::wwise_stream::extract(std::string section, std::filesystem::path path)
+void hellextractor::converter::wwise_stream::extract(std::string_view section, hellextractor::sink& sink) const
 {
 	if (section_default == section) { // Extract "texture" section.
-		std::ofstream stream{path, std::ios::trunc | std::ios::binary | std::ios::out};
-		if (!stream || stream.bad() || !stream.is_open()) {
-			throw std::runtime_error("Unable to open output file");
-		}
-
-		for (auto const& section : _data.sections()) {
-			stream.write(reinterpret_cast<char const*>(section.first), section.second);
-		}
-
-		stream.close();
+		auto sections = _data->sections();
+		sink.reserve(sections.total());
+		sink.write(sections);
+	} else if ((section_ogg == section) && _vorbis) { // Transcode straight from the mapped stream data.
+		sink.reserve(_vorbis->size());
+		_vorbis->write(sink.stream());
 	}
 }
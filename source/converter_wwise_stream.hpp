@@ -9,20 +9,24 @@
 // THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #pragma once
+#include <memory>
+#include <optional>
 #include "converter.hpp"
 #include "stingray_data.hpp"
 #include "stingray_wwise_stream.hpp"
+#include "wem_vorbis.hpp"
 
 namespace hellextractor::converter {
 	class wwise_stream : public base {
-		stingray::wwise_stream _data;
+		std::optional<stingray::wwise_stream>      _data;
+		std::shared_ptr<hellextractor::wem_vorbis> _vorbis;
 
 		public:
 		virtual ~wwise_stream();
-		wwise_stream(stingray::data_110000F0::meta_t meta);
+		wwise_stream(hellextractor::converter::options_t const& options);
 
-		std::map<std::string, std::pair<size_t, std::string>> outputs() override;
+		void load(stingray::data_110000F0::meta_t meta) override;
 
-		void extract(std::string section, std::filesystem::path path) override;
+		void extract(std::string_view section, hellextractor::sink& sink) const override;
 	};
 } // namespace hellextractor::converter
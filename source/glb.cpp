@@ -0,0 +1,337 @@
+// Copyright 2024 Michael Fabian 'Xaymar' Dirks <info@xaymar.com>
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "glb.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <map>
+#include "endian.h"
+#include "hierarchy.hpp"
+#include "string_printf.hpp"
+#include "vertex.hpp"
+
+static constexpr uint32_t glb_magic      = 0x46546C67; // "glTF"
+static constexpr uint32_t glb_version    = 2;
+static constexpr uint32_t glb_chunk_json = 0x4E4F534A; // "JSON"
+static constexpr uint32_t glb_chunk_bin  = 0x004E4942; // "BIN\0"
+
+static constexpr uint32_t gltf_unsigned_byte  = 5121;
+static constexpr uint32_t gltf_unsigned_short = 5123;
+static constexpr uint32_t gltf_unsigned_int   = 5125;
+static constexpr uint32_t gltf_float          = 5126;
+
+static constexpr uint32_t gltf_array_buffer         = 34962;
+static constexpr uint32_t gltf_element_array_buffer = 34963;
+
+// Vertices converted per block while streaming or scanning, which keeps the scratch buffer small.
+static constexpr size_t convert_block = 4096;
+
+struct layout_t {
+	bool                                   valid;
+	size_t                                 vertex_bin;
+	size_t                                 index_bin;
+	size_t                                 index_stride;
+	hellextractor::vertex::layout_t const* vertex;
+};
+
+static size_t align4(size_t v)
+{
+	return (v + 3) & ~size_t(3);
+}
+
+static void put32(std::ostream& stream, uint32_t v)
+{
+	v = htole32(v);
+	stream.write(reinterpret_cast<char const*>(&v), sizeof(v));
+}
+
+/** Validate a datatype against the mapped GPU data and look up how its vertices are decoded. */
+static bool plan_layout(stingray::unit::datatype_t const* datatype, size_t gpu_size, layout_t& layout)
+{
+	layout.valid  = false;
+	layout.vertex = &hellextractor::vertex::layout(*datatype);
+	size_t stride = layout.vertex->stride;
+	if (!layout.vertex->valid) {
+		return false;
+	}
+
+	// glTF requires 4-byte aligned strides of at most 252 bytes for vertex buffers.
+	if ((stride != datatype->__unk2.vertex_stride) || (stride % 4) || (stride > 252)) {
+		return false;
+	}
+
+	uint64_t vertices = datatype->__unk2.vertices;
+	uint64_t indices  = datatype->__unk3.indices;
+	if ((vertices == 0) || (indices == 0)) {
+		return false;
+	}
+	if ((uint64_t(datatype->__unk3.vertex_offset) + vertices * stride) > gpu_size) {
+		return false;
+	}
+
+	layout.index_stride = datatype->__unk3.index_size / indices;
+	if ((layout.index_stride != 2) && (layout.index_stride != 4)) {
+		return false;
+	}
+	if ((uint64_t(datatype->__unk3.index_offset) + indices * layout.index_stride) > gpu_size) {
+		return false;
+	}
+
+	layout.valid = true;
+	return true;
+}
+
+hellextractor::glb::~glb() {}
+
+hellextractor::glb::glb(stingray::unit::unit& unit) : _json(), _pieces(), _bin_size(0)
+{
+	auto const& meta      = unit.meta();
+	auto        gpu       = reinterpret_cast<uint8_t const*>(meta.gpu);
+	auto&       datatypes = unit.datatypes();
+	auto&       meshes    = unit.meshes();
+	auto&       nodes     = unit.nodes();
+	if (!gpu || (meta.gpu_size == 0) || (meshes.size() == 0)) {
+		return;
+	}
+
+	std::map<size_t, layout_t> layouts;
+	std::string                views;
+	std::string                accessors;
+	std::string                gltf_meshes;
+	std::string                gltf_nodes;
+	std::string                scene;
+	size_t                     view_count     = 0;
+	size_t                     accessor_count = 0;
+	size_t                     mesh_count     = 0;
+	std::vector<float>         block(convert_block * 3);
+
+	// Meshes are placed with the world transform of the node they are attached to, if that isn't the identity.
+	hellextractor::hierarchy hierarchy{nodes};
+	auto                     node_matrix = [&](stingray::thin_hash_t name) {
+		size_t idx = nodes.find(name);
+		if (idx >= nodes.size()) {
+			return std::string{};
+		}
+		float matrix[16];
+		hierarchy.world(idx, matrix);
+		bool identity = true;
+		for (size_t e = 0; e < 16; e++) {
+			if (!std::isfinite(matrix[e])) {
+				return std::string{};
+			}
+			identity &= (matrix[e] == (((e % 5) == 0) ? 1.f : 0.f));
+		}
+		if (identity) {
+			return std::string{};
+		}
+		std::string result = ",\"matrix\":[";
+		for (size_t e = 0; e < 16; e++) {
+			result += string_printf("%s%.9g", e ? "," : "", matrix[e]);
+		}
+		return result + "]";
+	};
+
+	auto add_view = [&](size_t offset, size_t length, size_t stride, uint32_t target) {
+		views += string_printf("%s{\"buffer\":0,\"byteOffset\":%zu,\"byteLength\":%zu", view_count ? "," : "", offset, length);
+		if (stride) {
+			views += string_printf(",\"byteStride\":%zu", stride);
+		}
+		views += string_printf(",\"target\":%" PRIu32 "}", target);
+		return view_count++;
+	};
+	auto add_accessor = [&](size_t view, size_t offset, uint32_t component, size_t count, char const* type, std::string const& extra) {
+		accessors += string_printf("%s{\"bufferView\":%zu,\"byteOffset\":%zu,\"componentType\":%" PRIu32 ",\"count\":%zu,\"type\":\"%s\"%s}", accessor_count ? "," : "", view, offset, component, count, type, extra.c_str());
+		return accessor_count++;
+	};
+
+	for (size_t mdx = 0; mdx < meshes.size(); mdx++) {
+		auto mesh  = meshes.at(mdx);
+		auto index = mesh.data()->datatype_index;
+		if (index >= datatypes.size()) {
+			continue;
+		}
+		auto datatype = datatypes.at(index);
+
+		// Each datatype's vertex and index buffers are referenced as a whole, at most once.
+		auto kv = layouts.find(index);
+		if (kv == layouts.end()) {
+			layout_t layout = {};
+			if (plan_layout(datatype, meta.gpu_size, layout)) {
+				layout.vertex_bin = _bin_size;
+				push(piece::RAW, gpu + datatype->__unk3.vertex_offset, size_t(datatype->__unk2.vertices) * datatype->__unk2.vertex_stride);
+				layout.index_bin = _bin_size;
+				push(piece::RAW, gpu + datatype->__unk3.index_offset, size_t(datatype->__unk3.indices) * layout.index_stride);
+			}
+			kv = layouts.emplace(index, layout).first;
+		}
+		auto const& layout = kv->second;
+		if (!layout.valid) {
+			continue;
+		}
+
+		size_t      stride     = datatype->__unk2.vertex_stride;
+		std::string primitives;
+		for (size_t gdx = 0; gdx < mesh.groups(); gdx++) {
+			auto const& group = mesh.group(gdx);
+			if ((group.vertices == 0) || (group.indices == 0) || ((uint64_t(group.vertex_offset) + group.vertices) > datatype->__unk2.vertices) || ((uint64_t(group.index_offset) + group.indices) > datatype->__unk3.indices)) {
+				continue;
+			}
+
+			// glTF requires exact bounds for positions, so scan them before anything else is emitted.
+			auto const&    position = layout.vertex->attributes[layout.vertex->position];
+			uint8_t const* vertices = gpu + datatype->__unk3.vertex_offset + size_t(group.vertex_offset) * stride;
+			float          min[3]   = {std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max()};
+			float          max[3]   = {std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest()};
+			bool           finite   = true;
+			for (size_t vdx = 0; vdx < group.vertices; vdx += convert_block) {
+				size_t count = std::min<size_t>(convert_block, group.vertices - vdx);
+				position.kernel(block.data(), vertices + vdx * stride + position.offset, stride, count);
+				for (size_t idx = 0; idx < count * 3; idx++) {
+					finite &= std::isfinite(block[idx]);
+					min[idx % 3] = std::min(min[idx % 3], block[idx]);
+					max[idx % 3] = std::max(max[idx % 3], block[idx]);
+				}
+			}
+			if (!finite) {
+				continue;
+			}
+
+			std::string attributes;
+			auto        add_attribute = [&](std::string const& name, size_t accessor) {
+				attributes += string_printf("%s\"%s\":%zu", attributes.empty() ? "" : ",", name.c_str(), accessor);
+			};
+
+			// The strided view into the source data is only created once a native attribute needs it.
+			size_t vertex_view = std::numeric_limits<size_t>::max();
+
+			for (size_t adx = 0; adx < layout.vertex->attributes.size(); adx++) {
+				auto const& attribute = layout.vertex->attributes[adx];
+				std::string extra;
+				if (adx == layout.vertex->position) {
+					extra = string_printf(",\"min\":[%.9g,%.9g,%.9g],\"max\":[%.9g,%.9g,%.9g]", min[0], min[1], min[2], max[0], max[1], max[2]);
+				}
+
+				if (attribute.native) {
+					if (vertex_view == std::numeric_limits<size_t>::max()) {
+						vertex_view = add_view(layout.vertex_bin + size_t(group.vertex_offset) * stride, size_t(group.vertices) * stride, stride, gltf_array_buffer);
+					}
+					add_attribute(attribute.name, add_accessor(vertex_view, attribute.offset, attribute.component_type, group.vertices, attribute.type, extra));
+				} else { // Converted while streaming into a tightly packed view of its own.
+					size_t offset = _bin_size;
+					size_t length = size_t(group.vertices) * attribute.size;
+					push(piece::CONVERT, vertices + attribute.offset, length, stride, group.vertices, attribute.kernel);
+					add_attribute(attribute.name, add_accessor(add_view(offset, length, 0, gltf_array_buffer), 0, attribute.component_type, group.vertices, attribute.type, extra));
+				}
+			}
+
+			size_t index_view     = add_view(layout.index_bin + size_t(group.index_offset) * layout.index_stride, size_t(group.indices) * layout.index_stride, 0, gltf_element_array_buffer);
+			size_t index_accessor = add_accessor(index_view, 0, (layout.index_stride == 2) ? gltf_unsigned_short : gltf_unsigned_int, group.indices, "SCALAR", "");
+
+			primitives += string_printf("%s{\"attributes\":{%s},\"indices\":%zu,\"mode\":4}", primitives.empty() ? "" : ",", attributes.c_str(), index_accessor);
+		}
+		if (primitives.empty()) {
+			continue;
+		}
+
+		uint32_t name = meshes.name(mdx);
+		gltf_meshes += string_printf("%s{\"name\":\"%08" PRIx32 "\",\"primitives\":[%s]}", mesh_count ? "," : "", name, primitives.c_str());
+		gltf_nodes += string_printf("%s{\"name\":\"%08" PRIx32 "\",\"mesh\":%zu%s}", mesh_count ? "," : "", name, mesh_count, node_matrix(mesh.data()->node).c_str());
+		scene += string_printf("%s%zu", mesh_count ? "," : "", mesh_count);
+		mesh_count++;
+	}
+
+	if (mesh_count == 0) {
+		_pieces.clear();
+		_bin_size = 0;
+		return;
+	}
+
+	_json = string_printf("{\"asset\":{\"version\":\"2.0\",\"generator\":\"Hellextractor\"},\"scene\":0,\"scenes\":[{\"nodes\":[%s]}],\"nodes\":[%s],\"meshes\":[%s],\"accessors\":[%s],\"bufferViews\":[%s],\"buffers\":[{\"byteLength\":%zu}]}", scene.c_str(), gltf_nodes.c_str(), gltf_meshes.c_str(), accessors.c_str(), views.c_str(), _bin_size);
+
+	// The container stores its total length in 32 bits.
+	if (size() > std::numeric_limits<uint32_t>::max()) {
+		_json.clear();
+		_pieces.clear();
+		_bin_size = 0;
+	}
+}
+
+bool hellextractor::glb::empty() const
+{
+	return _json.empty();
+}
+
+size_t hellextractor::glb::size() const
+{
+	if (_json.empty()) {
+		return 0;
+	}
+	return 12 + 8 + align4(_json.size()) + (_bin_size ? 8 + _bin_size : 0);
+}
+
+void hellextractor::glb::write(std::ostream& stream) const
+{
+	if (_json.empty()) {
+		return;
+	}
+
+	put32(stream, glb_magic);
+	put32(stream, glb_version);
+	put32(stream, static_cast<uint32_t>(size()));
+
+	// The JSON chunk is padded with spaces, the binary chunk with zeros.
+	static constexpr char spaces[4] = {' ', ' ', ' ', ' '};
+	static constexpr char zeros[4]  = {0, 0, 0, 0};
+	put32(stream, static_cast<uint32_t>(align4(_json.size())));
+	put32(stream, glb_chunk_json);
+	stream.write(_json.data(), _json.size());
+	stream.write(spaces, align4(_json.size()) - _json.size());
+
+	if (_bin_size == 0) {
+		return;
+	}
+	put32(stream, static_cast<uint32_t>(_bin_size));
+	put32(stream, glb_chunk_bin);
+
+	std::vector<uint8_t> block;
+	for (auto const& entry : _pieces) {
+		switch (entry.kind) {
+		case piece::RAW:
+			stream.write(reinterpret_cast<char const*>(entry.data), entry.size);
+			break;
+		case piece::PAD:
+			stream.write(zeros, entry.size);
+			break;
+		case piece::CONVERT: {
+			size_t size = entry.size / entry.count;
+			block.resize(convert_block * size);
+			for (size_t idx = 0; idx < entry.count; idx += convert_block) {
+				size_t count = std::min(convert_block, entry.count - idx);
+				entry.kernel(block.data(), entry.data + idx * entry.stride, entry.stride, count);
+				stream.write(reinterpret_cast<char const*>(block.data()), count * size);
+			}
+			break;
+		}
+		}
+	}
+}
+
+void hellextractor::glb::push(piece kind, uint8_t const* data, size_t size, size_t stride, size_t count, hellextractor::vertex::kernel_t kernel)
+{
+	_pieces.push_back({kind, data, size, stride, count, kernel});
+	_bin_size += size;
+	if (size_t pad = align4(_bin_size) - _bin_size; pad) {
+		_pieces.push_back({piece::PAD, nullptr, pad, 0, 0, nullptr});
+		_bin_size += pad;
+	}
+}
@@ -0,0 +1,65 @@
+// Copyright 2024 Michael Fabian 'Xaymar' Dirks <info@xaymar.com>
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#pragma once
+#include <cinttypes>
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "stingray_unit.hpp"
+#include "vertex.hpp"
+
+namespace hellextractor {
+	/** Binary glTF 2.0 writer for unit geometry.
+	 *
+	 * The whole file is laid out up front from the unit's tables, so its exact size is known before anything is written.
+	 * Vertex and index buffers are then streamed straight out of the mapped .gpu_resources data, and only attributes that
+	 * glTF can't describe natively are converted, a block at a time.
+	 */
+	class glb {
+		enum class piece : uint8_t {
+			RAW,
+			PAD,
+			CONVERT,
+		};
+
+		struct piece_t {
+			piece          kind;
+			uint8_t const* data;
+			size_t         size;
+
+			// Only used by piece::CONVERT, which runs the kernel over 'count' vertices found every 'stride' bytes.
+			size_t                          stride;
+			size_t                          count;
+			hellextractor::vertex::kernel_t kernel;
+		};
+
+		std::string          _json;
+		std::vector<piece_t> _pieces;
+		size_t               _bin_size;
+
+		public:
+		~glb();
+		glb(stingray::unit::unit& unit);
+
+		/** True if the unit has no geometry that can be exported. */
+		bool empty() const;
+
+		/** Exact size of the file written by write(). */
+		size_t size() const;
+
+		void write(std::ostream& stream) const;
+
+		private:
+		void push(piece kind, uint8_t const* data, size_t size, size_t stride = 0, size_t count = 0, hellextractor::vertex::kernel_t kernel = nullptr);
+	};
+} // namespace hellextractor
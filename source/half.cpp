@@ -0,0 +1,156 @@
+// Copyright 2024 Michael Fabian 'Xaymar' Dirks <info@xaymar.com>
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "half.hpp"
+#include <utility>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define HALF_X86
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define HALF_TARGET(x)
+#else
+#include <cpuid.h>
+#define HALF_TARGET(x) __attribute__((target(x)))
+#endif
+#endif
+
+typedef void (*to_float_t)(float* out, uint16_t const* in, size_t count);
+typedef void (*to_half_t)(uint16_t* out, float const* in, size_t count);
+
+static void to_float_scalar(float* out, uint16_t const* in, size_t count)
+{
+	for (size_t idx = 0; idx < count; idx++) {
+		out[idx] = half_to_float(in[idx]);
+	}
+}
+
+static void to_half_scalar(uint16_t* out, float const* in, size_t count)
+{
+	for (size_t idx = 0; idx < count; idx++) {
+		out[idx] = float_to_half(in[idx]);
+	}
+}
+
+#ifdef HALF_X86
+HALF_TARGET("avx,f16c")
+static void to_float_f16c(float* out, uint16_t const* in, size_t count)
+{
+	size_t idx = 0;
+	for (; idx + 8 <= count; idx += 8) {
+		_mm256_storeu_ps(out + idx, _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<__m128i const*>(in + idx))));
+	}
+	to_float_scalar(out + idx, in + idx, count - idx);
+}
+
+HALF_TARGET("avx,f16c")
+static void to_half_f16c(uint16_t* out, float const* in, size_t count)
+{
+	size_t idx = 0;
+	for (; idx + 8 <= count; idx += 8) {
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out + idx), _mm256_cvtps_ph(_mm256_loadu_ps(in + idx), _MM_FROUND_TO_NEAREST_INT));
+	}
+	to_half_scalar(out + idx, in + idx, count - idx);
+}
+
+// The zero-masked forms are used because some compilers warn about the undefined pass-through of the plain ones.
+HALF_TARGET("avx512f")
+static void to_float_avx512(float* out, uint16_t const* in, size_t count)
+{
+	size_t idx = 0;
+	for (; idx + 16 <= count; idx += 16) {
+		_mm512_storeu_ps(out + idx, _mm512_maskz_cvtph_ps(0xFFFF, _mm256_loadu_si256(reinterpret_cast<__m256i const*>(in + idx))));
+	}
+	to_float_scalar(out + idx, in + idx, count - idx);
+}
+
+HALF_TARGET("avx512f")
+static void to_half_avx512(uint16_t* out, float const* in, size_t count)
+{
+	size_t idx = 0;
+	for (; idx + 16 <= count; idx += 16) {
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(out + idx), _mm512_maskz_cvtps_ph(0xFFFF, _mm512_loadu_ps(in + idx), _MM_FROUND_TO_NEAREST_INT));
+	}
+	to_half_scalar(out + idx, in + idx, count - idx);
+}
+
+static void cpuid(uint32_t leaf, uint32_t regs[4])
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+	__cpuidex(reinterpret_cast<int*>(regs), leaf, 0);
+#else
+	__cpuid_count(leaf, 0, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+static uint64_t xgetbv()
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+	return _xgetbv(0);
+#else
+	uint32_t lo, hi;
+	__asm__ volatile("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+	return (uint64_t(hi) << 32) | lo;
+#endif
+}
+#endif
+
+/** Pick the conversion functions once, based on what the CPU and operating system support. */
+static std::pair<to_float_t, to_half_t> detect()
+{
+#ifdef HALF_X86
+	uint32_t regs[4];
+	cpuid(0, regs);
+	uint32_t leaves = regs[0];
+
+	cpuid(1, regs);
+	bool f16c    = (regs[2] >> 29) & 1;
+	bool avx     = (regs[2] >> 28) & 1;
+	bool osxsave = (regs[2] >> 27) & 1;
+	if (!osxsave || !avx) {
+		return {to_float_scalar, to_half_scalar};
+	}
+
+	// The operating system has to preserve the YMM (and for AVX-512 the ZMM and mask) registers.
+	uint64_t xcr0 = xgetbv();
+	if ((xcr0 & 0x06) != 0x06) {
+		return {to_float_scalar, to_half_scalar};
+	}
+	if (leaves >= 7) {
+		cpuid(7, regs);
+		bool avx512f = (regs[1] >> 16) & 1;
+		if (avx512f && ((xcr0 & 0xE6) == 0xE6)) {
+			return {to_float_avx512, to_half_avx512};
+		}
+	}
+	if (f16c) {
+		return {to_float_f16c, to_half_f16c};
+	}
+#endif
+	return {to_float_scalar, to_half_scalar};
+}
+
+static std::pair<to_float_t, to_half_t> const& dispatch()
+{
+	static std::pair<to_float_t, to_half_t> const functions = detect();
+	return functions;
+}
+
+void half_to_float(float* out, uint16_t const* in, size_t count)
+{
+	dispatch().first(out, in, count);
+}
+
+void float_to_half(uint16_t* out, float const* in, size_t count)
+{
+	dispatch().second(out, in, count);
+}
@@ -1,6 +1,70 @@
 #pragma once
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
+
+/** Convert a single IEEE-754 half float to a float, including denormals, infinities and NaNs. */
+inline float half_to_float(uint16_t value)
+{
+	uint32_t sign = uint32_t(value & 0x8000) << 16;
+	uint32_t e    = (value >> 10) & 0x1F; // exponent
+	uint32_t m    = value & 0x03FF; // mantissa
+	uint32_t bits;
+	if (e == 0x1F) { // infinity : NaN, which is always quieted like F16C does
+		bits = sign | 0x7F800000 | (m << 13) | ((m != 0) << 22);
+	} else if (e != 0) { // normalized
+		bits = sign | ((e + 112) << 23) | (m << 13);
+	} else if (m != 0) { // denormalized, renormalize the mantissa
+		e = 1;
+		while (!(m & 0x0400)) {
+			m <<= 1;
+			e--;
+		}
+		bits = sign | ((e + 112) << 23) | ((m & 0x03FF) << 13);
+	} else { // zero
+		bits = sign;
+	}
+	float result;
+	memcpy(&result, &bits, sizeof(result));
+	return result;
+}
+
+/** Convert a single float to an IEEE-754 half float, rounding to nearest even like F16C does. */
+inline uint16_t float_to_half(float value)
+{
+	static constexpr uint32_t f32_infinity = 255u << 23;
+	static constexpr uint32_t f16_limit    = (127u + 16u) << 23;
+	static constexpr uint32_t denorm_magic = ((127u - 15u) + (23u - 10u) + 1u) << 23;
+
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	uint32_t sign = bits & 0x80000000;
+	bits ^= sign;
+
+	uint16_t result;
+	if (bits >= f16_limit) { // overflow to infinity : quiet NaN
+		result = (bits > f32_infinity) ? uint16_t(0x7E00 | ((bits >> 13) & 0x03FF)) : uint16_t(0x7C00);
+	} else if (bits < (113u << 23)) { // denormalized, let the FPU do the rounding
+		float magic;
+		float tmp;
+		memcpy(&magic, &denorm_magic, sizeof(magic));
+		memcpy(&tmp, &bits, sizeof(tmp));
+		tmp += magic;
+		memcpy(&bits, &tmp, sizeof(bits));
+		result = uint16_t(bits - denorm_magic);
+	} else { // normalized
+		uint32_t odd = (bits >> 13) & 1;
+		bits += (uint32_t(15 - 127) << 23) + 0x0FFF + odd;
+		result = uint16_t(bits >> 13);
+	}
+	return result | uint16_t(sign >> 16);
+}
+
+/** Convert count half floats to floats, using the widest conversion instructions the CPU supports. */
+void half_to_float(float* out, uint16_t const* in, size_t count);
+
+/** Convert count floats to half floats, using the widest conversion instructions the CPU supports. */
+void float_to_half(uint16_t* out, float const* in, size_t count);
 
 struct half {
 	uint16_t value;
@@ -20,30 +84,19 @@ struct half {
 
 	half& operator=(float v)
 	{
-		auto as_uint = [](const float x) { return *(uint32_t*)&x; };
-
-		// IEEE-754 16-bit floating-point format (without infinity): 1-5-10, exp-15, +-131008.0, +-6.1035156E-5, +-5.9604645E-8, 3.311 digits
-		const uint32_t b = as_uint(v) + 0x00001000; // round-to-nearest-even: add last bit after truncated mantissa
-		const uint32_t e = (b & 0x7F800000) >> 23; // exponent
-		const uint32_t m = b & 0x007FFFFF; // mantissa; in line below: 0x007FF000 = 0x00800000-0x00001000 = decimal indicator flag - initial rounding
-		value            = (b & 0x80000000) >> 16 | (e > 112) * ((((e - 112) << 10) & 0x7C00) | m >> 13) | ((e < 113) & (e > 101)) * ((((0x007FF000 + m) >> (125 - e)) + 1) >> 1) | (e > 143) * 0x7FFF; // sign : normalized : denormalized : saturate
+		value = float_to_half(v);
+		return *this;
 	}
 
 	half& operator=(uint16_t v)
 	{
 		value = v;
+		return *this;
 	}
 
 	operator float() const
 	{
-		auto as_float = [](const uint32_t x) { return *(float*)&x; };
-		auto as_uint  = [](const float x) { return *(uint32_t*)&x; };
-
-		// IEEE-754 16-bit floating-point format (without infinity): 1-5-10, exp-15, +-131008.0, +-6.1035156E-5, +-5.9604645E-8, 3.311 digits
-		const uint32_t e = (value & 0x7C00) >> 10; // exponent
-		const uint32_t m = (value & 0x03FF) << 13; // mantissa
-		const uint32_t v = as_uint((float)m) >> 23; // evil log2 bit hack to count leading zeros in denormalized format
-		return as_float((value & 0x8000) << 16 | (e != 0) * ((e + 112) << 23 | m) | ((e == 0) & (m != 0)) * ((v - 37) << 23 | ((m << (150 - v)) & 0x007FE000))); // sign : normalized : denormalized
+		return half_to_float(value);
 	}
 
 	operator uint16_t() const
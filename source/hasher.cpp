@@ -9,6 +9,7 @@
 // THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "hasher.hpp"
+#include <algorithm>
 #include <cstring>
 #include <functional>
 #include <map>
@@ -36,6 +37,31 @@ hellextractor::hash::instance::instance() {}
 
 hellextractor::hash::instance::~instance() {}
 
+std::vector<char> hellextractor::hash::instance::hash_sections(std::vector<std::pair<void const*, size_t>> const& sections)
+{
+	// Hashes that can't be fed in pieces only need a copy if there is more than one section with data.
+	std::pair<void const*, size_t> single = {nullptr, 0};
+	size_t                         count  = 0;
+	size_t                         size   = 0;
+	for (auto const& section : sections) {
+		if (section.second > 0) {
+			single = section;
+			count++;
+			size += section.second;
+		}
+	}
+	if (count <= 1) {
+		return hash(single.first, single.second);
+	}
+
+	std::vector<char> buffer;
+	buffer.reserve(size);
+	for (auto const& section : sections) {
+		buffer.insert(buffer.end(), reinterpret_cast<char const*>(section.first), reinterpret_cast<char const*>(section.first) + section.second);
+	}
+	return hash(buffer.data(), buffer.size());
+}
+
 std::shared_ptr<hellextractor::hash::instance> hellextractor::hash::instance::create(hellextractor::hash::type type)
 {
 	if (auto kv = hash_list::get().find(type); kv != hash_list::get().end()) {
@@ -111,7 +137,7 @@ class hash_bcrypt : public hellextractor::hash::instance {
 		}
 
 		BCRYPT_ALG_HANDLE alghandle;
-		if (auto status = BCryptOpenAlgorithmProvider(&alghandle, BCRYPT_MD5_ALGORITHM, NULL, 0); status) {
+		if (auto status = BCryptOpenAlgorithmProvider(&alghandle, algorithm, NULL, 0); status) {
 			throw std::runtime_error("BCryptOpenAlgorithmProvider");
 		}
 		_alg.reset(alghandle, [](void* p) { BCryptCloseAlgorithmProvider(p, 0); });
@@ -147,6 +173,26 @@ class hash_bcrypt : public hellextractor::hash::instance {
 
 		return _buf;
 	}
+
+	std::vector<char> hash_sections(std::vector<std::pair<void const*, size_t>> const& sections) override
+	{
+		BCRYPT_HASH_HANDLE hashhandle;
+		if (auto status = BCryptCreateHash(_alg.get(), &hashhandle, (PUCHAR)_objbuf.data(), _objbuf.size(), NULL, 0, 0); status) {
+			throw std::runtime_error("BCryptCreateHash");
+		}
+		std::shared_ptr<void> hasher(hashhandle, [](void* p) { BCryptDestroyHash(p); });
+
+		for (auto const& section : sections) {
+			if (auto status = BCryptHashData(hasher.get(), (PBYTE)section.first, section.second, 0); status) {
+				throw std::runtime_error("BCryptHashData");
+			}
+		}
+		if (auto status = BCryptFinishHash(hasher.get(), (PBYTE)_buf.data(), _buf.size(), 0); status) {
+			throw std::runtime_error("BCryptFinishHash");
+		}
+
+		return _buf;
+	}
 };
 
 class hash_sha128 : public hash_bcrypt {
@@ -184,6 +230,132 @@ class hash_md5 : public hash_bcrypt {
 	hash_md5() : hash_bcrypt(hellextractor::hash::type::MD5){};
 };
 static auto hash_md5_factory = hash_list(hellextractor::hash::type::MD5, []() { return std::make_shared<hash_md5>(); });
+#else
+// Portable SHA-256 (FIPS 180-4) for platforms without BCrypt.
+class hash_sha256 : public hellextractor::hash::instance {
+	static constexpr uint32_t k[64] = {
+		0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, //
+		0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da, 0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967, //
+		0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070, //
+		0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2, //
+	};
+
+	std::vector<char> _buf;
+
+	static inline uint32_t rotr(uint32_t v, uint32_t n)
+	{
+		return (v >> n) | (v << (32 - n));
+	}
+
+	static void block(uint32_t state[8], uint8_t const* data)
+	{
+		uint32_t w[64];
+		for (size_t idx = 0; idx < 16; idx++) {
+			w[idx] = (static_cast<uint32_t>(data[idx * 4]) << 24) | (static_cast<uint32_t>(data[idx * 4 + 1]) << 16) | (static_cast<uint32_t>(data[idx * 4 + 2]) << 8) | static_cast<uint32_t>(data[idx * 4 + 3]);
+		}
+		for (size_t idx = 16; idx < 64; idx++) {
+			uint32_t s0 = rotr(w[idx - 15], 7) ^ rotr(w[idx - 15], 18) ^ (w[idx - 15] >> 3);
+			uint32_t s1 = rotr(w[idx - 2], 17) ^ rotr(w[idx - 2], 19) ^ (w[idx - 2] >> 10);
+			w[idx]      = w[idx - 16] + s0 + w[idx - 7] + s1;
+		}
+
+		uint32_t a = state[0], b = state[1], c = state[2], d = state[3], e = state[4], f = state[5], g = state[6], h = state[7];
+		for (size_t idx = 0; idx < 64; idx++) {
+			uint32_t t1 = h + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) + k[idx] + w[idx];
+			uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+			h           = g;
+			g           = f;
+			f           = e;
+			e           = d + t1;
+			d           = c;
+			c           = b;
+			b           = a;
+			a           = t1 + t2;
+		}
+
+		state[0] += a;
+		state[1] += b;
+		state[2] += c;
+		state[3] += d;
+		state[4] += e;
+		state[5] += f;
+		state[6] += g;
+		state[7] += h;
+	}
+
+	public:
+	hash_sha256() : hellextractor::hash::instance()
+	{
+		_buf.resize(32, 0);
+	}
+
+	std::vector<char> hash(void const* ptr, size_t length) override
+	{
+		return hash_sections({{ptr, length}});
+	}
+
+	std::vector<char> hash_sections(std::vector<std::pair<void const*, size_t>> const& sections) override
+	{
+		uint32_t state[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+
+		// Blocks may span sections, so whatever doesn't fill a block waits in pending.
+		uint8_t  pending[64];
+		size_t   used   = 0;
+		uint64_t length = 0;
+		for (auto const& section : sections) {
+			auto   data = reinterpret_cast<uint8_t const*>(section.first);
+			size_t left = section.second;
+			if (left == 0) {
+				continue;
+			}
+			length += left;
+
+			if (used > 0) {
+				size_t take = std::min(left, sizeof(pending) - used);
+				memcpy(pending + used, data, take);
+				used += take;
+				data += take;
+				left -= take;
+				if (used < sizeof(pending)) {
+					continue;
+				}
+				block(state, pending);
+				used = 0;
+			}
+			for (; left >= sizeof(pending); data += sizeof(pending), left -= sizeof(pending)) {
+				block(state, data);
+			}
+			if (left > 0) {
+				memcpy(pending, data, left);
+				used = left;
+			}
+		}
+
+		// Pad the remainder with 0x80, zeroes and the big endian bit length.
+		uint8_t tail[128] = {};
+		if (used > 0) {
+			memcpy(tail, pending, used);
+		}
+		tail[used]       = 0x80;
+		size_t   tail_sz = (used < 56) ? 64 : 128;
+		uint64_t bits    = length * 8;
+		for (size_t idx = 0; idx < 8; idx++) {
+			tail[tail_sz - 1 - idx] = static_cast<uint8_t>(bits >> (idx * 8));
+		}
+		for (size_t idx = 0; idx < tail_sz; idx += 64) {
+			block(state, tail + idx);
+		}
+
+		for (size_t idx = 0; idx < 8; idx++) {
+			_buf[idx * 4]     = static_cast<char>(state[idx] >> 24);
+			_buf[idx * 4 + 1] = static_cast<char>(state[idx] >> 16);
+			_buf[idx * 4 + 2] = static_cast<char>(state[idx] >> 8);
+			_buf[idx * 4 + 3] = static_cast<char>(state[idx]);
+		}
+		return _buf;
+	}
+};
+static auto hash_sha256_factory = hash_list(hellextractor::hash::type::SHA256, []() { return std::make_shared<hash_sha256>(); });
 #endif
 
 class hash_murmur_64a : public hellextractor::hash::instance {
@@ -0,0 +1,201 @@
+// Copyright 2024 Michael Fabian 'Xaymar' Dirks <info@xaymar.com>
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "hierarchy.hpp"
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define HIERARCHY_SSE2
+#include <emmintrin.h>
+#endif
+
+// Elements 0 to 8 are the 3x3 rotation and scale in row-major order, 9 to 11 are the translation.
+static constexpr float identity[12] = {1, 0, 0, 0, 1, 0, 0, 0, 1, 0, 0, 0};
+
+hellextractor::hierarchy::~hierarchy() {}
+
+hellextractor::hierarchy::hierarchy() : _count(0), _order(), _position(), _parent(), _levels(), _local(), _world() {}
+
+hellextractor::hierarchy::hierarchy(stingray::unit::node_list const& nodes) : hierarchy()
+{
+	_count     = nodes.size();
+	auto links = nodes.links();
+	auto trss  = nodes.trss();
+
+	_parent.resize(_count);
+	for (size_t idx = 0; idx < _count; idx++) {
+		size_t parent = links[idx].parent;
+		_parent[idx]  = static_cast<uint32_t>(((parent >= _count) || (parent == idx)) ? _count : parent);
+	}
+
+	// Children of every node, packed into a single array.
+	std::vector<uint32_t> offsets(_count + 2, 0);
+	for (size_t idx = 0; idx < _count; idx++) {
+		offsets[_parent[idx] + 1]++;
+	}
+	for (size_t idx = 1; idx < offsets.size(); idx++) {
+		offsets[idx] += offsets[idx - 1];
+	}
+	std::vector<uint32_t> children(_count);
+	{
+		std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+		for (size_t idx = 0; idx < _count; idx++) {
+			children[fill[_parent[idx]]++] = static_cast<uint32_t>(idx);
+		}
+	}
+
+	// Breadth first from all roots, which yields one level per depth. Nodes that are never reached are part of a cycle,
+	// which is broken up by turning the first one into another root.
+	std::vector<bool> visited(_count, false);
+	_order.reserve(_count);
+	_levels.push_back(0);
+	std::vector<uint32_t> frontier(children.begin() + offsets[_count], children.begin() + offsets[_count + 1]);
+	size_t                next_root = 0;
+	while (_order.size() < _count) {
+		if (frontier.empty()) {
+			while (visited[next_root]) {
+				next_root++;
+			}
+			_parent[next_root] = static_cast<uint32_t>(_count);
+			frontier.push_back(static_cast<uint32_t>(next_root));
+		}
+
+		std::vector<uint32_t> next;
+		for (auto idx : frontier) {
+			if (visited[idx]) {
+				continue;
+			}
+			visited[idx] = true;
+			_order.push_back(idx);
+			next.insert(next.end(), children.begin() + offsets[idx], children.begin() + offsets[idx + 1]);
+		}
+		if (_order.size() != _levels.back()) {
+			_levels.push_back(static_cast<uint32_t>(_order.size()));
+		}
+		frontier = std::move(next);
+	}
+
+	_position.resize(_count);
+	for (size_t pos = 0; pos < _count; pos++) {
+		_position[_order[pos]] = static_cast<uint32_t>(pos);
+	}
+
+	// Local transforms, with each rotation row scaled by its axis. The skew is not understood yet and is ignored.
+	_local.resize(elements * _count);
+	_world.resize(elements * _count);
+	for (size_t pos = 0; pos < _count; pos++) {
+		auto const& node = trss[_order[pos]];
+		for (size_t row = 0; row < 3; row++) {
+			for (size_t col = 0; col < 3; col++) {
+				_local[(row * 3 + col) * _count + pos] = node.rotation[row * 3 + col] * node.scale[row];
+			}
+			_local[(9 + row) * _count + pos] = node.translation[row];
+		}
+	}
+
+	evaluate();
+}
+
+size_t hellextractor::hierarchy::size() const
+{
+	return _count;
+}
+
+size_t hellextractor::hierarchy::parent(size_t idx) const
+{
+	return _parent.at(idx);
+}
+
+std::span<uint32_t const> hellextractor::hierarchy::order() const
+{
+	return _order;
+}
+
+void hellextractor::hierarchy::local(size_t idx, float matrix[16]) const
+{
+	get(_local, idx, matrix);
+}
+
+void hellextractor::hierarchy::world(size_t idx, float matrix[16]) const
+{
+	get(_world, idx, matrix);
+}
+
+void hellextractor::hierarchy::evaluate()
+{
+	size_t       count = _count;
+	float const* L     = _local.data();
+	float*       W     = _world.data();
+
+	// Element e of the parent's world transform for the node at a position, or of the identity for roots.
+	auto parent_element = [this, W, count](size_t pos, size_t e) {
+		uint32_t parent = _parent[_order[pos]];
+		return (parent == count) ? identity[e] : W[e * count + _position[parent]];
+	};
+
+	for (size_t level = 0; level + 1 < _levels.size(); level++) {
+		size_t pos = _levels[level];
+		size_t end = _levels[level + 1];
+
+#ifdef HIERARCHY_SSE2
+		// Four nodes at a time. Their parents are all in earlier levels, so they are gathered into lanes once.
+		for (; pos + 4 <= end; pos += 4) {
+			__m128 p[elements];
+			for (size_t e = 0; e < elements; e++) {
+				p[e] = _mm_setr_ps(parent_element(pos, e), parent_element(pos + 1, e), parent_element(pos + 2, e), parent_element(pos + 3, e));
+			}
+			__m128 l[elements];
+			for (size_t e = 0; e < elements; e++) {
+				l[e] = _mm_loadu_ps(L + e * count + pos);
+			}
+
+			for (size_t row = 0; row < 4; row++) {
+				__m128 const* lr = l + row * 3;
+				for (size_t col = 0; col < 3; col++) {
+					__m128 v = _mm_add_ps(_mm_add_ps(_mm_mul_ps(lr[0], p[col]), _mm_mul_ps(lr[1], p[3 + col])), _mm_mul_ps(lr[2], p[6 + col]));
+					if (row == 3) {
+						v = _mm_add_ps(v, p[9 + col]);
+					}
+					_mm_storeu_ps(W + (row * 3 + col) * count + pos, v);
+				}
+			}
+		}
+#endif
+
+		for (; pos < end; pos++) {
+			float p[elements];
+			for (size_t e = 0; e < elements; e++) {
+				p[e] = parent_element(pos, e);
+			}
+			for (size_t row = 0; row < 4; row++) {
+				float const* lr = L + row * 3 * count + pos;
+				for (size_t col = 0; col < 3; col++) {
+					float v = lr[0] * p[col] + lr[count] * p[3 + col] + lr[2 * count] * p[6 + col];
+					if (row == 3) {
+						v += p[9 + col];
+					}
+					W[(row * 3 + col) * count + pos] = v;
+				}
+			}
+		}
+	}
+}
+
+void hellextractor::hierarchy::get(std::vector<float> const& from, size_t idx, float matrix[16]) const
+{
+	size_t pos = _position.at(idx);
+	for (size_t row = 0; row < 4; row++) {
+		for (size_t col = 0; col < 3; col++) {
+			matrix[row * 4 + col] = from[(row * 3 + col) * _count + pos];
+		}
+		matrix[row * 4 + 3] = (row == 3) ? 1.f : 0.f;
+	}
+}
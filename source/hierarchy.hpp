@@ -0,0 +1,61 @@
+// Copyright 2024 Michael Fabian 'Xaymar' Dirks <info@xaymar.com>
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#pragma once
+#include <cinttypes>
+#include <cstddef>
+#include <span>
+#include <vector>
+#include "stingray_unit.hpp"
+
+namespace hellextractor {
+	/** World space transforms for the node hierarchy of a unit.
+	 *
+	 * Nodes are ordered breadth first into levels, where every level only depends on the levels before it. Local and
+	 * world transforms are kept as a structure of arrays in that order, so each level is composed several nodes at a time.
+	 *
+	 * Matrices use the Stingray convention of row vectors, with the translation in the last row. Stored row-major, this
+	 * is the same memory layout as a column-major glTF matrix.
+	 */
+	class hierarchy {
+		static constexpr size_t elements = 12;
+
+		size_t                _count;
+		std::vector<uint32_t> _order;
+		std::vector<uint32_t> _position;
+		std::vector<uint32_t> _parent;
+		std::vector<uint32_t> _levels;
+		std::vector<float>    _local;
+		std::vector<float>    _world;
+
+		public:
+		~hierarchy();
+		hierarchy();
+		hierarchy(stingray::unit::node_list const& nodes);
+
+		size_t size() const;
+
+		/** Parent of a node, or size() for root nodes. Cycles in the source data are broken up into roots. */
+		size_t parent(size_t idx) const;
+
+		/** Node indices in evaluation order, where each node comes after its parent. */
+		std::span<uint32_t const> order() const;
+
+		void local(size_t idx, float matrix[16]) const;
+
+		void world(size_t idx, float matrix[16]) const;
+
+		private:
+		void evaluate();
+
+		void get(std::vector<float> const& from, size_t idx, float matrix[16]) const;
+	};
+} // namespace hellextractor
@@ -9,6 +9,8 @@
 // THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "mapped_file.hpp"
+#include <algorithm>
+#include <vector>
 
 #ifdef WIN32
 #define WIN32_LEAN_AND_MEAN
@@ -17,12 +19,13 @@
 #else
 #include <fcntl.h>
 #include <sys/mman.h>
+#include <sys/stat.h>
 #include <unistd.h>
 #endif
 
-mapped_file::mapped_file() : _path(), _file(), _map(), _ptr() {}
+mapped_file::mapped_file() : _path(), _file(), _map(), _ptr(), _size() {}
 
-mapped_file::mapped_file(std::filesystem::path path) : _path(path)
+mapped_file::mapped_file(std::filesystem::path path) : _path(path), _ptr(), _size()
 {
 #ifdef WIN32
 	_file.reset(CreateFileA(reinterpret_cast<LPCSTR>(path.generic_string().c_str()), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, NULL), [](void* p) { CloseHandle(p); });
@@ -30,6 +33,17 @@ mapped_file::mapped_file(std::filesystem::path path) : _path(path)
 		throw std::runtime_error("CreateFileA failed.");
 	}
 
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(_file.get(), &size)) {
+		throw std::runtime_error("GetFileSizeEx failed.");
+	}
+	_size = static_cast<size_t>(size.QuadPart);
+
+	// Empty files can't be mapped, and there is nothing to read from them anyway.
+	if (_size == 0) {
+		return;
+	}
+
 	_map.reset(CreateFileMapping(_file.get(), NULL, PAGE_READONLY, 0, 0, NULL), [](void* p) { CloseHandle(p); });
 	if (_map.get() == INVALID_HANDLE_VALUE) {
 		throw std::runtime_error("CreateFileMapping failed.");
@@ -45,11 +59,24 @@ mapped_file::mapped_file(std::filesystem::path path) : _path(path)
 		throw std::runtime_error("open failed.");
 	}
 
-	size_t size = std::filesystem::file_size(path);
-	_map.reset(reinterpret_cast<void*>(mmap(nullptr, size, PROT_READ, MAP_NORESERVE, reinterpret_cast<size_t>(_file.get()), 0)), [&size](void* p) { munmap(p, size); });
-	if (!_map) {
+	// The size comes from the open file, which saves another lookup by path.
+	struct stat info;
+	if (fstat(static_cast<int>(reinterpret_cast<size_t>(_file.get())), &info) != 0) {
+		throw std::runtime_error("fstat failed.");
+	}
+	_size = static_cast<size_t>(info.st_size);
+
+	// Empty files can't be mapped, and there is nothing to read from them anyway.
+	if (_size == 0) {
+		return;
+	}
+
+	size_t size = _size;
+	void*  ptr  = mmap(nullptr, size, PROT_READ, MAP_PRIVATE | MAP_NORESERVE, reinterpret_cast<size_t>(_file.get()), 0);
+	if (ptr == MAP_FAILED) {
 		throw std::runtime_error("mmap failed.");
 	}
+	_map.reset(ptr, [size](void* p) { munmap(p, size); });
 
 	_ptr = reinterpret_cast<decltype(_ptr)>(_map.get());
 #endif
@@ -80,3 +107,50 @@ mapped_file::operator uint8_t const*() const
 {
 	return _ptr;
 }
+
+size_t mapped_file::size() const
+{
+	return _size;
+}
+
+size_t mapped_file::resident() const
+{
+#ifdef WIN32
+	return 0;
+#else
+	// Query in slices, so that huge containers don't need a huge page vector.
+	size_t const               page  = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+	size_t const               slice = page * 0x40000;
+	std::vector<unsigned char> pages(slice / page);
+	size_t                     resident = 0;
+	for (size_t offset = 0; offset < _size; offset += slice) {
+		size_t length = std::min(slice, _size - offset);
+		if (mincore(const_cast<uint8_t*>(_ptr) + offset, length, pages.data()) != 0) {
+			return 0;
+		}
+		for (size_t idx = 0, edx = (length + page - 1) / page; idx < edx; idx++) {
+			if (pages[idx] & 1) {
+				resident += std::min(page, length - idx * page);
+			}
+		}
+	}
+	return resident;
+#endif
+}
+
+void mapped_file::release(size_t offset, size_t size) const
+{
+#ifndef WIN32
+	if (offset >= _size) {
+		return;
+	}
+	size = std::min(size, _size - offset);
+
+	// Both only work on whole pages, so round outwards. Neighbouring data is simply read again if it is needed.
+	size_t const page  = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+	size_t       begin = offset & ~(page - 1);
+	size_t       end   = std::min((offset + size + page - 1) & ~(page - 1), _size);
+	madvise(const_cast<uint8_t*>(_ptr) + begin, end - begin, MADV_DONTNEED);
+	posix_fadvise(static_cast<int>(reinterpret_cast<size_t>(_file.get())), static_cast<off_t>(begin), static_cast<off_t>(end - begin), POSIX_FADV_DONTNEED);
+#endif
+}
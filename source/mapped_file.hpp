@@ -17,6 +17,7 @@ class mapped_file {
 	std::shared_ptr<void> _file;
 	std::shared_ptr<void> _map;
 	uint8_t const*        _ptr;
+	size_t                _size;
 
 	public:
 	mapped_file();
@@ -29,4 +30,12 @@ class mapped_file {
 
 	operator void const*() const;
 	operator uint8_t const*() const;
+
+	size_t size() const;
+
+	/** Bytes of the mapping that are currently in the page cache. Always 0 on Windows, which has no equivalent. */
+	size_t resident() const;
+
+	/** Drop a range from this process and from the page cache. It stays readable, but is read from disk again. Does nothing on Windows. */
+	void release(size_t offset, size_t size) const;
 };
@@ -0,0 +1,128 @@
+// Copyright 2024 Michael Fabian 'Xaymar' Dirks <info@xaymar.com>
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "memory_budget.hpp"
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include "string_printf.hpp"
+
+// Known information
+// - The page cache keeps large folios, which are only dropped once all of their pages are released at once. Ranges are
+//   merged across small gaps for this, and a container is dropped as a whole once it is finished.
+
+static constexpr size_t merge_gap = 0x10000;
+
+hellextractor::memory_budget::~memory_budget()
+{
+	finish();
+}
+
+hellextractor::memory_budget::memory_budget(size_t budget) : _budget(budget), _window(0), _released(0), _container(nullptr), _mappings(), _ranges() {}
+
+void hellextractor::memory_budget::use(stingray::data_110000F0 const& container, stingray::data_110000F0::meta_t const& meta)
+{
+	if (_container != &container) {
+		finish();
+		_container = &container;
+		_mappings  = container.mappings();
+	}
+
+	std::vector<range_t> ranges;
+	add(ranges, meta.main, meta.main_size);
+	add(ranges, meta.stream, meta.stream_size);
+	add(ranges, meta.gpu, meta.gpu_size);
+
+	size_t size = 0;
+	for (auto const& range : ranges) {
+		size += range.size;
+	}
+	if ((_window + size) > _budget) {
+		release();
+	}
+	_ranges.insert(_ranges.end(), ranges.begin(), ranges.end());
+	_window += size;
+}
+
+void hellextractor::memory_budget::release()
+{
+	std::sort(_ranges.begin(), _ranges.end(), [](range_t const& a, range_t const& b) { return (a.file != b.file) ? (a.file < b.file) : (a.offset < b.offset); });
+	for (size_t idx = 0; idx < _ranges.size();) {
+		auto   file  = _ranges[idx].file;
+		size_t begin = _ranges[idx].offset;
+		size_t end   = begin + _ranges[idx].size;
+		for (idx++; (idx < _ranges.size()) && (_ranges[idx].file == file) && (_ranges[idx].offset <= (end + merge_gap)); idx++) {
+			end = std::max(end, _ranges[idx].offset + _ranges[idx].size);
+		}
+		file->release(begin, end - begin);
+	}
+	_released += _window;
+	_window = 0;
+	_ranges.clear();
+}
+
+void hellextractor::memory_budget::finish()
+{
+	release();
+	for (auto const& mapping : _mappings) {
+		mapping.second->release(0, mapping.second->size());
+	}
+	_container = nullptr;
+	_mappings.clear();
+}
+
+size_t hellextractor::memory_budget::released() const
+{
+	return _released;
+}
+
+size_t hellextractor::memory_budget::parse(std::string_view text)
+{
+	size_t      length = 0;
+	std::string value{text};
+	size_t      size   = 0;
+	try {
+		size = std::stoull(value, &length);
+	} catch (std::exception const&) {
+		throw std::runtime_error(string_printf("Expected size, got '%s' instead.", value.c_str()));
+	}
+
+	auto suffix = value.substr(length);
+	if (suffix.empty()) {
+		return size;
+	} else if ((suffix == "K") || (suffix == "k")) {
+		return size << 10;
+	} else if ((suffix == "M") || (suffix == "m")) {
+		return size << 20;
+	} else if ((suffix == "G") || (suffix == "g")) {
+		return size << 30;
+	} else if ((suffix == "T") || (suffix == "t")) {
+		return size << 40;
+	}
+	throw std::runtime_error(string_printf("Expected size, got '%s' instead.", value.c_str()));
+}
+
+void hellextractor::memory_budget::add(std::vector<range_t>& ranges, void const* data, size_t size)
+{
+	if (!data || !size) {
+		return;
+	}
+
+	// Ranges inflated from chunked .stream files are freed with their meta_t and the chunk cache, not from a mapping.
+	auto ptr = reinterpret_cast<uint8_t const*>(data);
+	for (auto const& mapping : _mappings) {
+		auto base = **mapping.second;
+		if ((ptr >= base) && ((ptr + size) <= (base + mapping.second->size()))) {
+			ranges.push_back({mapping.second, static_cast<size_t>(ptr - base), size});
+			return;
+		}
+	}
+}
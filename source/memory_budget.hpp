@@ -0,0 +1,66 @@
+// Copyright 2024 Michael Fabian 'Xaymar' Dirks <info@xaymar.com>
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#pragma once
+#include <cinttypes>
+#include <cstddef>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "mapped_file.hpp"
+#include "stingray_data.hpp"
+
+namespace hellextractor {
+	/** Caps how much of the mapped containers may be resident at once.
+	 *
+	 * Every file adds its ranges to the current window before it is processed. If a file doesn't fit, the window is
+	 * dropped from this process and from the page cache first, so that extracting a large install doesn't push everything
+	 * else out of memory. Containers are expected one after another, and each one is dropped as a whole once the next one
+	 * is used. Dropped ranges stay readable, they are simply read from disk again.
+	 */
+	class memory_budget {
+		struct range_t {
+			mapped_file const* file;
+			size_t             offset;
+			size_t             size;
+		};
+
+		size_t _budget;
+		size_t _window;
+		size_t _released;
+
+		stingray::data_110000F0 const*                               _container;
+		std::vector<std::pair<std::string_view, mapped_file const*>> _mappings;
+		std::vector<range_t>                                         _ranges;
+
+		public:
+		~memory_budget();
+		memory_budget(size_t budget);
+
+		/** Add a file from the given container that is about to be processed, releasing the window first if it doesn't fit. */
+		void use(stingray::data_110000F0 const& container, stingray::data_110000F0::meta_t const& meta);
+
+		/** Release everything in the window. */
+		void release();
+
+		/** Release the window and all of the current container. */
+		void finish();
+
+		/** Total bytes released so far. */
+		size_t released() const;
+
+		/** Parse a size in bytes, with an optional K, M, G or T suffix. */
+		static size_t parse(std::string_view text);
+
+		private:
+		void add(std::vector<range_t>& ranges, void const* data, size_t size);
+	};
+} // namespace hellextractor
@@ -0,0 +1,282 @@
+// Copyright 2024 Michael Fabian 'Xaymar' Dirks <info@xaymar.com>
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "metrics.hpp"
+#include <algorithm>
+#include <bit>
+#include <stdexcept>
+#include "string_printf.hpp"
+#include "trace.hpp"
+
+static constexpr std::string_view phase_names[] = {
+	"dictionary_load", "input_enumeration", "container_load", "merge", "translation", "conversion", "write", "rename",
+};
+static_assert(std::size(phase_names) == static_cast<size_t>(hellextractor::metrics::phase::_COUNT));
+
+static double seconds(uint64_t nanoseconds)
+{
+	return static_cast<double>(nanoseconds) / 1e9;
+}
+
+static nlohmann::ordered_json report(hellextractor::metrics::counters_t const& counters)
+{
+	auto value = nlohmann::ordered_json::object();
+	value["files"] = counters.files.load();
+	value["outputs"] = counters.outputs.load();
+	value["bytes"] = counters.bytes.load();
+	value["latency"] = counters.latency.report();
+	return value;
+}
+
+hellextractor::metrics::histogram::~histogram() {}
+
+hellextractor::metrics::histogram::histogram() : _buckets(), _count(0), _sum(0), _max(0) {}
+
+void hellextractor::metrics::histogram::add(clock_t::duration latency)
+{
+	auto   ns     = static_cast<uint64_t>(std::max<int64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(latency).count(), 0));
+	size_t bucket = std::min<size_t>(std::bit_width(ns / 1000), _buckets.size() - 1);
+	_buckets[bucket]++;
+	_count++;
+	_sum += ns;
+	for (uint64_t max = _max.load(); (ns > max) && !_max.compare_exchange_weak(max, ns);) {
+	}
+}
+
+nlohmann::ordered_json hellextractor::metrics::histogram::report() const
+{
+	// Bucket n holds everything below 2^n µs, the last one everything else.
+	auto buckets = nlohmann::ordered_json::array();
+	for (size_t idx = 0; idx < _buckets.size(); idx++) {
+		if (uint64_t count = _buckets[idx].load(); count > 0) {
+			auto bucket = nlohmann::ordered_json::object();
+			bucket["le"] = ((idx + 1) < _buckets.size()) ? nlohmann::ordered_json(static_cast<double>(uint64_t(1) << idx) / 1e6) : nlohmann::ordered_json();
+			bucket["count"] = count;
+			buckets.push_back(std::move(bucket));
+		}
+	}
+
+	auto value = nlohmann::ordered_json::object();
+	value["count"] = _count.load();
+	value["sum"] = seconds(_sum.load());
+	value["max"] = seconds(_max.load());
+	value["buckets"] = std::move(buckets);
+	return value;
+}
+
+hellextractor::metrics::timer::~timer()
+{
+	next(_phase);
+}
+
+hellextractor::metrics::timer::timer(metrics* owner, phase which) : _metrics(owner), _phase(which), _start(), _usage(), _traced(hellextractor::trace::enabled())
+{
+	if (_metrics) {
+		_usage = hellextractor::residency::usage();
+	}
+	if (_metrics || _traced) {
+		_start = clock_t::now();
+	}
+}
+
+void hellextractor::metrics::timer::next(phase which)
+{
+	if (_metrics || _traced) {
+		auto now = clock_t::now();
+		if (_metrics) {
+			auto usage = hellextractor::residency::usage();
+			_metrics->add(_phase, now - _start);
+			_metrics->add(_phase, usage.major_faults - _usage.major_faults, usage.minor_faults - _usage.minor_faults);
+			_usage = usage;
+		}
+		if (_traced) {
+			hellextractor::trace::complete(name(_phase), _start, now);
+		}
+		_start = now;
+	}
+	_phase = which;
+}
+
+hellextractor::metrics::~metrics()
+{
+	stop();
+}
+
+hellextractor::metrics::metrics(bool enabled) : _enabled(enabled), _start(clock_t::now()), _phases(), _major_faults(), _minor_faults(), _files(0), _bytes(0), _lock(), _types(), _converters(), _timeline(), _stop_cv(), _stop(!enabled), _sampler()
+{
+	if (_enabled) {
+		_sampler = std::thread{[this]() { sample(); }};
+	}
+}
+
+bool hellextractor::metrics::enabled() const
+{
+	return _enabled;
+}
+
+hellextractor::metrics::clock_t::time_point hellextractor::metrics::now() const
+{
+	return _enabled ? clock_t::now() : clock_t::time_point{};
+}
+
+hellextractor::metrics::timer hellextractor::metrics::time(phase phase)
+{
+	return {_enabled ? this : nullptr, phase};
+}
+
+void hellextractor::metrics::add(phase phase, clock_t::duration duration)
+{
+	if (_enabled) {
+		_phases[static_cast<size_t>(phase)] += static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count());
+	}
+}
+
+void hellextractor::metrics::add(phase phase, uint64_t major_faults, uint64_t minor_faults)
+{
+	if (_enabled) {
+		_major_faults[static_cast<size_t>(phase)] += major_faults;
+		_minor_faults[static_cast<size_t>(phase)] += minor_faults;
+	}
+}
+
+hellextractor::metrics::counters_t* hellextractor::metrics::type(std::string_view name)
+{
+	if (!_enabled) {
+		return nullptr;
+	}
+	std::unique_lock<std::mutex> ul(_lock);
+	return &_types.try_emplace(std::string{name}).first->second;
+}
+
+hellextractor::metrics::counters_t* hellextractor::metrics::converter(std::string_view name)
+{
+	if (!_enabled) {
+		return nullptr;
+	}
+	std::unique_lock<std::mutex> ul(_lock);
+	return &_converters.try_emplace(std::string{name}).first->second;
+}
+
+void hellextractor::metrics::file(counters_t* type, counters_t* converter)
+{
+	if (!_enabled) {
+		return;
+	}
+	_files++;
+	for (auto counters : {type, converter}) {
+		if (counters) {
+			counters->files++;
+		}
+	}
+}
+
+void hellextractor::metrics::output(counters_t* type, counters_t* converter, uint64_t bytes, clock_t::duration latency)
+{
+	if (!_enabled) {
+		return;
+	}
+	_bytes += bytes;
+	for (auto counters : {type, converter}) {
+		if (counters) {
+			counters->outputs++;
+			counters->bytes += bytes;
+			counters->latency.add(latency);
+		}
+	}
+}
+
+nlohmann::ordered_json hellextractor::metrics::report(nlohmann::ordered_json totals)
+{
+	stop();
+
+	double wall = std::chrono::duration<double>(clock_t::now() - _start).count();
+
+	auto phases = nlohmann::ordered_json::object();
+	for (size_t idx = 0; idx < _phases.size(); idx++) {
+		phases[std::string{phase_names[idx]}] = seconds(_phases[idx].load());
+	}
+
+	auto faults = nlohmann::ordered_json::object();
+	for (size_t idx = 0; idx < _phases.size(); idx++) {
+		auto entry = nlohmann::ordered_json::object();
+		entry["major"] = _major_faults[idx].load();
+		entry["minor"] = _minor_faults[idx].load();
+		faults[std::string{phase_names[idx]}] = std::move(entry);
+	}
+
+	auto rates = nlohmann::ordered_json::object();
+	rates["files_per_second"] = (wall > 0) ? static_cast<double>(_files.load()) / wall : 0.;
+	rates["bytes_per_second"] = (wall > 0) ? static_cast<double>(_bytes.load()) / wall : 0.;
+
+	auto timeline = nlohmann::ordered_json::array();
+	for (auto const& sample : _timeline) {
+		auto entry = nlohmann::ordered_json::object();
+		entry["time"] = sample.time;
+		entry["files"] = sample.files;
+		entry["bytes"] = sample.bytes;
+		timeline.push_back(std::move(entry));
+	}
+
+	auto types      = nlohmann::ordered_json::object();
+	auto converters = nlohmann::ordered_json::object();
+	{
+		std::unique_lock<std::mutex> ul(_lock);
+		for (auto const& kv : _types) {
+			types[kv.first] = ::report(kv.second);
+		}
+		for (auto const& kv : _converters) {
+			converters[kv.first] = ::report(kv.second);
+		}
+	}
+
+	auto value = nlohmann::ordered_json::object();
+	value["wall_time"] = wall;
+	value["files"] = _files.load();
+	value["bytes"] = _bytes.load();
+	value["phases"] = std::move(phases);
+	value["faults"] = std::move(faults);
+	value["peak_rss"] = hellextractor::residency::usage().peak_rss;
+	value["rates"] = std::move(rates);
+	value["totals"] = std::move(totals);
+	value["timeline"] = std::move(timeline);
+	value["types"] = std::move(types);
+	value["converters"] = std::move(converters);
+	return value;
+}
+
+std::string_view hellextractor::metrics::name(phase phase)
+{
+	if (phase >= phase::_COUNT) {
+		throw std::out_of_range("idx >= edx");
+	}
+	return phase_names[static_cast<size_t>(phase)];
+}
+
+void hellextractor::metrics::stop()
+{
+	{
+		std::unique_lock<std::mutex> ul(_lock);
+		_stop = true;
+	}
+	_stop_cv.notify_all();
+	if (_sampler.joinable()) {
+		_sampler.join();
+	}
+}
+
+void hellextractor::metrics::sample()
+{
+	// One sample per second, so files/s and bytes/s can be plotted over the run.
+	std::unique_lock<std::mutex> ul(_lock);
+	for (auto next = _start + std::chrono::seconds(1); !_stop_cv.wait_until(ul, next, [this]() { return _stop; }); next += std::chrono::seconds(1)) {
+		_timeline.push_back({std::chrono::duration<double>(clock_t::now() - _start).count(), _files.load(), _bytes.load()});
+	}
+}
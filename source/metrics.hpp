@@ -0,0 +1,154 @@
+// Copyright 2024 Michael Fabian 'Xaymar' Dirks <info@xaymar.com>
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cinttypes>
+#include <condition_variable>
+#include <cstddef>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "residency.hpp"
+
+#include <nlohmann/json.hpp>
+
+namespace hellextractor {
+	/** Run metrics: time spent in each phase, throughput over time, and per-type and per-converter counters.
+	 *
+	 * Counters are atomic, so outputs can be recorded from any thread. A disabled instance records nothing, and its
+	 * timers don't even read the clock unless tracing is enabled.
+	 */
+	class metrics {
+		public:
+		typedef std::chrono::steady_clock clock_t;
+
+		enum class phase : size_t {
+			DICTIONARY_LOAD,
+			INPUT_ENUMERATION,
+			CONTAINER_LOAD,
+			MERGE,
+			TRANSLATION,
+			CONVERSION,
+			WRITE,
+			RENAME,
+
+			_COUNT,
+		};
+
+		/** Latency histogram with power of two buckets, starting at 1µs. */
+		class histogram {
+			std::array<std::atomic<uint64_t>, 28> _buckets;
+			std::atomic<uint64_t>                 _count;
+			std::atomic<uint64_t>                 _sum; // Nanoseconds.
+			std::atomic<uint64_t>                 _max; // Nanoseconds.
+
+			public:
+			~histogram();
+			histogram();
+
+			void add(clock_t::duration latency);
+
+			nlohmann::ordered_json report() const;
+		};
+
+		struct counters_t {
+			std::atomic<uint64_t> files   = 0;
+			std::atomic<uint64_t> outputs = 0;
+			std::atomic<uint64_t> bytes   = 0;
+			histogram             latency;
+		};
+
+		/** Adds the time and page faults from construction to destruction to a phase, and records it as a trace span if tracing. */
+		class timer {
+			metrics*                          _metrics;
+			phase                             _phase;
+			clock_t::time_point               _start;
+			hellextractor::residency::usage_t _usage;
+			bool                              _traced;
+
+			public:
+			~timer();
+			timer(metrics* owner, phase which);
+			timer(timer const&) = delete;
+
+			/** Add the time so far to the current phase, and continue timing another one. */
+			void next(phase which);
+		};
+
+		private:
+		bool                _enabled;
+		clock_t::time_point _start;
+
+		std::array<std::atomic<uint64_t>, static_cast<size_t>(phase::_COUNT)> _phases; // Nanoseconds.
+		std::array<std::atomic<uint64_t>, static_cast<size_t>(phase::_COUNT)> _major_faults;
+		std::array<std::atomic<uint64_t>, static_cast<size_t>(phase::_COUNT)> _minor_faults;
+		std::atomic<uint64_t>                                                 _files;
+		std::atomic<uint64_t>                                                 _bytes;
+
+		std::mutex                        _lock;
+		std::map<std::string, counters_t> _types;
+		std::map<std::string, counters_t> _converters;
+
+		struct sample_t {
+			double   time;
+			uint64_t files;
+			uint64_t bytes;
+		};
+		std::vector<sample_t>   _timeline;
+		std::condition_variable _stop_cv;
+		bool                    _stop;
+		std::thread             _sampler;
+
+		public:
+		~metrics();
+		metrics(bool enabled);
+
+		bool enabled() const;
+
+		/** Current time, or the epoch if disabled. */
+		clock_t::time_point now() const;
+
+		timer time(phase phase);
+
+		void add(phase phase, clock_t::duration duration);
+
+		/** Add page faults to a phase. Faults are counted for the whole process, so other threads are included. */
+		void add(phase phase, uint64_t major_faults, uint64_t minor_faults);
+
+		/** Counters for a type or converter. The pointer stays valid for the lifetime of this instance. */
+		counters_t* type(std::string_view name);
+
+		counters_t* converter(std::string_view name);
+
+		/** Count a file of the given type and converter, which are nullptr if disabled. */
+		void file(counters_t* type, counters_t* converter);
+
+		/** Count a finished output, and how long it took to produce. */
+		void output(counters_t* type, counters_t* converter, uint64_t bytes, clock_t::duration latency);
+
+		/** Stop sampling and build the report. Totals are included as they are. */
+		nlohmann::ordered_json report(nlohmann::ordered_json totals);
+
+		static std::string_view name(phase phase);
+
+		private:
+		void stop();
+
+		void sample();
+	};
+} // namespace hellextractor
@@ -0,0 +1,484 @@
+// Copyright 2024 Michael Fabian 'Xaymar' Dirks <info@xaymar.com>
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cinttypes>
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <optional>
+#include <set>
+#include <sstream>
+#include <thread>
+#include <utility>
+#include "main.hpp"
+#include "stingray_data.hpp"
+#include "string_printf.hpp"
+#include "synthetic.hpp"
+
+#include <nlohmann/json.hpp>
+
+#ifdef WIN32
+#else
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+static std::string_view constexpr name = "benchmark";
+static std::string_view constexpr help = "Benchmark full extraction runs over synthetic data, and compare them against a baseline";
+
+struct scenario_t {
+	std::string                           name;
+	std::string                           description;
+	std::vector<std::vector<std::string>> setup; // Not measured.
+	std::vector<std::string>              measured;
+	std::filesystem::path                 archive; // Tar written by the measured run, which has to match the loose output of the setup next to it.
+};
+
+struct measurement_t {
+	double   wall;
+	double   user;
+	double   system;
+	uint64_t peak_rss;
+	uint64_t syscalls; // Read and write calls, as counted by task I/O accounting. Zero if not available.
+	int32_t  status;
+};
+
+/** Scenarios all write to their own directory below the work directory, which is emptied before every run. */
+static std::vector<scenario_t> scenarios(std::filesystem::path const& data, std::filesystem::path const& names, std::filesystem::path const& work, size_t threads)
+{
+	auto extract = [&data, &work, threads](std::string_view directory, std::vector<std::string> options) {
+		std::vector<std::string> args = {"extract", "-q", "-j", std::to_string(threads), "-o", (work / directory).string()};
+		args.insert(args.end(), options.begin(), options.end());
+		args.push_back(data.string());
+		return args;
+	};
+
+	auto archive = work / "archive" / "archive.tar";
+	return {
+		{"raw", "Dump every file as it is stored into an empty directory", {}, extract("raw", {"-R"}), {}},
+		{"raw-warm", "Dump again over the output of an earlier dump", {extract("raw-warm", {"-R"})}, extract("raw-warm", {"-R"}), {}},
+		{"converted", "Convert every file into an empty directory, with names", {}, extract("converted", {"-n", names.string()}), {}},
+		{"converted-warm", "Convert again over the output of an earlier conversion", {extract("converted-warm", {"-n", names.string()})}, extract("converted-warm", {"-n", names.string()}), {}},
+		{"rename", "Rename the output of a run without names after the names were added", {extract("rename", {})}, extract("rename", {"-r", "-n", names.string()}), {}},
+		{"dry-run", "Pretend to convert every file", {}, extract("dry-run", {"-d", "-n", names.string()}), {}},
+		{"archive", "Convert every file into a tar archive, and check it against a conversion into a directory", {extract("archive/loose", {"-n", names.string()})}, extract("archive", {"-a", archive.string(), "-n", names.string()}), archive},
+	};
+}
+
+/** Compare every file in a tar archive with the file of the same name in the directory.
+ *
+ * @return Number of files which differ, are missing from the directory, or are missing from the archive.
+ */
+static size_t compare_archive(std::filesystem::path const& archive, std::filesystem::path const& directory)
+{
+	std::ifstream stream{archive, std::ios::binary};
+	if (!stream.is_open()) {
+		throw std::runtime_error(string_printf("Failed to open file '%s'", archive.generic_u8string().c_str()));
+	}
+
+	size_t            differences = 0;
+	size_t            files       = 0;
+	std::string       long_name;
+	std::vector<char> header(512);
+	while (stream.read(header.data(), header.size()) && (header[0] != '\0')) {
+		auto field = [&header](size_t offset, size_t length) {
+			std::string value{header.data() + offset, length};
+			return value.substr(0, value.find('\0'));
+		};
+
+		uint64_t size = 0;
+		if ((static_cast<uint8_t>(header[124]) & 0x80) != 0) {
+			// GNU base-256 encoding, as written for files of 8 GiB and larger.
+			for (size_t idx = 4; idx < 12; idx++) {
+				size = (size << 8) | static_cast<uint8_t>(header[124 + idx]);
+			}
+		} else {
+			size = std::stoull(field(124, 12), nullptr, 8);
+		}
+		std::string data(size, '\0');
+		stream.read(data.data(), static_cast<std::streamsize>(size));
+		stream.ignore(static_cast<std::streamsize>((512 - (size % 512)) % 512));
+
+		// GNU long names apply to the next header.
+		char type = header[156];
+		if (type == 'L') {
+			long_name = data.substr(0, data.find('\0'));
+			continue;
+		}
+		std::string name = std::exchange(long_name, {});
+		if (name.empty()) {
+			name = field(345, 155).empty() ? field(0, 100) : (field(345, 155) + "/" + field(0, 100));
+		}
+		if ((type != '0') && (type != '\0')) {
+			continue;
+		}
+
+		files++;
+		std::ifstream file{directory / name, std::ios::binary};
+		std::string   expected{std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+		differences += (!file.is_open() || (expected != data)) ? 1 : 0;
+	}
+
+	size_t loose = 0;
+	for (auto const& entry : std::filesystem::recursive_directory_iterator(directory)) {
+		loose += entry.is_regular_file() ? 1 : 0;
+	}
+	return differences + ((loose > files) ? (loose - files) : 0);
+}
+
+/** Run this executable with the given arguments, sending its output to the log. */
+static measurement_t run(std::filesystem::path const& self, std::vector<std::string> const& args, std::filesystem::path const& log)
+{
+#ifdef WIN32
+	throw std::runtime_error("Benchmarks are not supported on Windows yet");
+#else
+	std::string              program = self.string();
+	std::vector<std::string> storage = args;
+	std::vector<char*>       argv;
+	argv.push_back(program.data());
+	for (auto& arg : storage) {
+		argv.push_back(arg.data());
+	}
+	argv.push_back(nullptr);
+
+	int fd = open(log.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+	if (fd < 0) {
+		throw std::runtime_error(string_printf("Failed to open file '%s'", log.generic_u8string().c_str()));
+	}
+
+	auto  start = std::chrono::steady_clock::now();
+	pid_t pid   = fork();
+	if (pid == 0) {
+		dup2(fd, STDOUT_FILENO);
+		dup2(fd, STDERR_FILENO);
+		execv(program.c_str(), argv.data());
+		_exit(127);
+	}
+	close(fd);
+	if (pid < 0) {
+		throw std::runtime_error("Failed to start process");
+	}
+
+	// Wait without reaping, so that the I/O accounting of the finished process can still be read.
+	siginfo_t info = {};
+	while ((waitid(P_PID, static_cast<id_t>(pid), &info, WEXITED | WNOWAIT) != 0) && (errno == EINTR)) {
+	}
+	measurement_t result = {};
+	result.wall          = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	std::ifstream io{string_printf("/proc/%d/io", static_cast<int>(pid))};
+	for (std::string line; std::getline(io, line);) {
+		if ((line.rfind("syscr:", 0) == 0) || (line.rfind("syscw:", 0) == 0)) {
+			result.syscalls += std::stoull(line.substr(6));
+		}
+	}
+
+	int           status = 0;
+	struct rusage usage  = {};
+	while ((wait4(pid, &status, 0, &usage) < 0) && (errno == EINTR)) {
+	}
+	result.user     = static_cast<double>(usage.ru_utime.tv_sec) + static_cast<double>(usage.ru_utime.tv_usec) / 1e6;
+	result.system   = static_cast<double>(usage.ru_stime.tv_sec) + static_cast<double>(usage.ru_stime.tv_usec) / 1e6;
+#ifdef __APPLE__
+	result.peak_rss = static_cast<uint64_t>(usage.ru_maxrss);
+#else
+	result.peak_rss = static_cast<uint64_t>(usage.ru_maxrss) * 1024;
+#endif
+	result.status   = WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+	return result;
+#endif
+}
+
+template<typename T>
+static T median(std::vector<T> values)
+{
+	std::sort(values.begin(), values.end());
+	return values[values.size() / 2];
+}
+
+/** Compare the results with a baseline. Only metrics where higher is worse are compared.
+ *
+ * @return Number of regressions.
+ */
+static size_t compare(nlohmann::ordered_json const& results, nlohmann::ordered_json const& baseline, double threshold)
+{
+	static constexpr std::string_view metrics[] = {"wall_time", "cpu_time", "peak_rss", "syscalls"};
+
+	size_t regressions = 0;
+	auto   scenarios   = baseline.find("scenarios");
+	if ((scenarios == baseline.end()) || !scenarios->is_object()) {
+		throw std::runtime_error("Baseline has no scenarios");
+	}
+
+	// Anything that is missing or isn't a positive number can't be compared.
+	auto number = [](nlohmann::ordered_json const& object, std::string_view key) {
+		auto value = object.find(key);
+		return ((value != object.end()) && value->is_number()) ? value->get<double>() : 0.;
+	};
+
+	std::cout << string_printf("%-16s %-10s %16s %16s %9s", "Scenario", "Metric", "Baseline", "Current", "Change") << std::endl;
+	for (auto const& kv : results["scenarios"].items()) {
+		auto old = scenarios->find(kv.key());
+		if (old == scenarios->end()) {
+			std::cout << string_printf("%-16s (not in baseline)", kv.key().c_str()) << std::endl;
+			continue;
+		}
+
+		for (auto metric : metrics) {
+			double current  = number(kv.value(), metric);
+			double previous = number(*old, metric);
+			if ((current <= 0) || (previous <= 0)) {
+				continue;
+			}
+
+			double change     = (current / previous) - 1.;
+			bool   regression = change > threshold;
+			regressions += regression ? 1 : 0;
+			std::cout << string_printf("%-16s %-10s %16.6g %16.6g %+8.1f%%%s", kv.key().c_str(), std::string{metric}.c_str(), previous, current, change * 100., regression ? "  REGRESSION" : "") << std::endl;
+		}
+	}
+	return regressions;
+}
+
+int32_t mode_benchmark(std::vector<std::string> const& args)
+{
+	std::optional<std::filesystem::path> data_path;
+	std::optional<std::filesystem::path> work_path;
+	std::optional<std::filesystem::path> results_path;
+	std::optional<std::filesystem::path> baseline_path;
+	std::set<std::string>                selected;
+	hellextractor::synthetic::options_t  options;
+	size_t                               repeat    = 3;
+	size_t                               threads   = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+	double                               threshold = 10.;
+	bool                                 show_help = false;
+	bool                                 list      = false;
+
+	for (size_t edx = args.size(), idx = 1; idx < edx; ++idx) {
+		auto arg   = args[idx];
+		bool value = (idx + 1) < edx;
+		try {
+			if ((arg == "-h") || (arg == "--help")) {
+				show_help = true;
+			} else if ((arg == "-l") || (arg == "--list")) {
+				list = true;
+			} else if (((arg == "-d") || (arg == "--data")) && value) {
+				data_path = std::filesystem::absolute(args[++idx]);
+			} else if (((arg == "-w") || (arg == "--work")) && value) {
+				work_path = std::filesystem::absolute(args[++idx]);
+			} else if (((arg == "-s") || (arg == "--scenario")) && value) {
+				selected.insert(args[++idx]);
+			} else if (((arg == "-r") || (arg == "--repeat")) && value) {
+				repeat = std::max<size_t>(std::stoull(args[++idx]), 1);
+			} else if (((arg == "-j") || (arg == "--threads")) && value) {
+				threads = std::max<size_t>(std::stoull(args[++idx]), 1);
+			} else if (((arg == "-o") || (arg == "--output")) && value) {
+				results_path = std::filesystem::absolute(args[++idx]);
+			} else if (((arg == "-b") || (arg == "--baseline")) && value) {
+				baseline_path = std::filesystem::absolute(args[++idx]);
+			} else if (((arg == "-t") || (arg == "--threshold")) && value) {
+				threshold = std::stod(args[++idx]);
+			} else if ((arg == "--seed") && value) {
+				options.seed = std::stoull(args[++idx]);
+			} else if (((arg == "-c") || (arg == "--containers")) && value) {
+				options.containers = std::stoull(args[++idx]);
+			} else if (((arg == "-n") || (arg == "--files")) && value) {
+				options.files = std::stoull(args[++idx]);
+			} else if (((arg == "-m") || (arg == "--mix")) && value) {
+				hellextractor::synthetic::parse_mix(args[++idx], options);
+			} else {
+				std::cerr << "Unrecognized argument: " << arg << std::endl;
+				return 1;
+			}
+		} catch (std::exception const& ex) {
+			std::cerr << "Invalid value for " << arg << ": " << ex.what() << std::endl;
+			return 1;
+		}
+	}
+
+	if (show_help) {
+		auto self = std::filesystem::path(args[0]).filename();
+		std::cout << self.generic_string() << " " << name << " [options]" << std::endl;
+		std::cout << "Runs extract over a synthetic install in several scenarios, and measures wall time, CPU time, peak RSS and read/write syscalls of every run. Every scenario is repeated, and the median is reported." << std::endl;
+		std::cout << std::endl;
+		std::cout << "Options" << std::endl;
+		std::cout << "  -h, --help            Show this help" << std::endl;
+		std::cout << "  -l, --list            List all scenarios and exit." << std::endl;
+		std::cout << "  -s, --scenario <name> Only run this scenario. Can be used multiple times." << std::endl;
+		std::cout << "  -r, --repeat <count>  Number of runs per scenario. Default is 3." << std::endl;
+		std::cout << "  -j, --threads <count> Number of threads passed to extract. Default is the number of hardware threads." << std::endl;
+		std::cout << "  -d, --data <path>     Directory of the synthetic install, which is generated if it doesn't exist yet. Default is a directory in the temporary directory named after the generator options." << std::endl;
+		std::cout << "  -w, --work <path>     Directory for the output of the runs. Default is the data directory with '.work' appended." << std::endl;
+		std::cout << "  -o, --output <path>   Write the results to a JSON file, which can be used as a baseline later." << std::endl;
+		std::cout << "  -b, --baseline <path> Compare the results with an earlier JSON file, and fail if any of them regressed." << std::endl;
+		std::cout << "  -t, --threshold <percent>  How much worse than the baseline a result may be before it counts as a regression. Default is 10." << std::endl;
+		std::cout << "      --seed <seed>     Seed for the synthetic install. Default is 1." << std::endl;
+		std::cout << "  -c, --containers <count>  Number of containers. Default is 4." << std::endl;
+		std::cout << "  -n, --files <count>   Number of files in each container. Default is 1000." << std::endl;
+		std::cout << "  -m, --mix <kind>=<weight>[,...]  Relative weight of each kind of file, see the generate mode." << std::endl;
+		std::cout << std::endl;
+		return 1;
+	}
+
+	if (!data_path.has_value()) {
+		data_path = std::filesystem::temp_directory_path() / string_printf("hellextractor-macro-%" PRIu64 "-%zux%zu", options.seed, options.containers, options.files);
+	}
+	if (!work_path.has_value()) {
+		work_path = std::filesystem::path{data_path.value()}.concat(".work");
+	}
+	auto names_path = data_path.value() / "names.txt";
+
+	auto all = scenarios(data_path.value(), names_path, work_path.value(), threads);
+	if (list) {
+		for (auto const& scenario : all) {
+			std::cout << string_printf("%-16s %s", scenario.name.c_str(), scenario.description.c_str()) << std::endl;
+		}
+		return 0;
+	}
+	for (auto const& name : selected) {
+		if (std::none_of(all.begin(), all.end(), [&name](scenario_t const& scenario) { return scenario.name == name; })) {
+			std::cerr << "Unknown scenario: " << name << std::endl;
+			return 1;
+		}
+	}
+
+	// Generate the install if needed, then measure it so that rates can be calculated.
+	if (!std::filesystem::exists(names_path)) {
+		std::cout << "Generating synthetic data in: " << data_path.value().generic_string() << std::endl;
+		hellextractor::synthetic::generator{options}.generate(data_path.value());
+	}
+	uint64_t                                                data_bytes      = 0;
+	size_t                                                  data_containers = 0;
+	std::set<std::pair<stingray::hash_t, stingray::hash_t>> data_files;
+	for (auto const& entry : std::filesystem::directory_iterator(data_path.value())) {
+		if (!entry.is_regular_file() || (entry.path().filename() == "names.txt")) {
+			continue;
+		}
+		data_bytes += entry.file_size();
+		if (!entry.path().has_extension()) {
+			stingray::data_110000F0 container{entry.path()};
+			for (size_t idx = 0; idx < container.files(); idx++) {
+				data_files.emplace(container.file_unchecked(idx).id, container.file_unchecked(idx).type);
+			}
+			data_containers++;
+		}
+	}
+
+	std::filesystem::path self = args[0];
+#ifndef WIN32
+	if (std::error_code ec; std::filesystem::exists("/proc/self/exe", ec)) {
+		self = std::filesystem::read_symlink("/proc/self/exe");
+	}
+#endif
+
+	auto results = nlohmann::ordered_json::object();
+	{
+		auto data = nlohmann::ordered_json::object();
+		data["path"] = data_path.value().generic_string();
+		data["containers"] = static_cast<uint64_t>(data_containers);
+		data["files"] = static_cast<uint64_t>(data_files.size());
+		data["bytes"] = data_bytes;
+		results["data"] = std::move(data);
+		results["threads"] = static_cast<uint64_t>(threads);
+		results["repeat"] = static_cast<uint64_t>(repeat);
+	}
+	auto results_scenarios = nlohmann::ordered_json::object();
+
+	std::filesystem::create_directories(work_path.value());
+	auto log_path = work_path.value() / "benchmark.log";
+	std::filesystem::remove(log_path);
+
+	std::cout << string_printf("%-16s %10s %10s %10s %12s %12s %14s %14s", "Scenario", "Wall", "User", "System", "Peak RSS", "Syscalls", "Files", "Bytes") << std::endl;
+	for (auto const& scenario : all) {
+		if (!selected.empty() && !selected.count(scenario.name)) {
+			continue;
+		}
+
+		std::vector<double>   wall, cpu, user, system;
+		std::vector<uint64_t> syscalls;
+		uint64_t              peak_rss = 0;
+		for (size_t run_idx = 0; run_idx < repeat; run_idx++) {
+			std::filesystem::remove_all(work_path.value() / scenario.name);
+			for (auto const& setup : scenario.setup) {
+				if (auto result = run(self, setup, log_path); result.status != 0) {
+					throw std::runtime_error(string_printf("Setup of scenario '%s' failed, see '%s'", scenario.name.c_str(), log_path.generic_u8string().c_str()));
+				}
+			}
+
+			auto result = run(self, scenario.measured, log_path);
+			if (result.status != 0) {
+				throw std::runtime_error(string_printf("Scenario '%s' failed, see '%s'", scenario.name.c_str(), log_path.generic_u8string().c_str()));
+			}
+			if (!scenario.archive.empty()) {
+				if (auto differences = compare_archive(scenario.archive, scenario.archive.parent_path() / "loose"); differences > 0) {
+					throw std::runtime_error(string_printf("Scenario '%s' wrote %zu files into the archive that don't match the loose output", scenario.name.c_str(), differences));
+				}
+			}
+			wall.push_back(result.wall);
+			cpu.push_back(result.user + result.system);
+			user.push_back(result.user);
+			system.push_back(result.system);
+			syscalls.push_back(result.syscalls);
+			peak_rss = std::max(peak_rss, result.peak_rss);
+		}
+		std::filesystem::remove_all(work_path.value() / scenario.name);
+
+		double wall_time = median(wall);
+		auto   entry     = nlohmann::ordered_json::object();
+		entry["wall_time"] = wall_time;
+		entry["cpu_time"] = median(cpu);
+		entry["user_time"] = median(user);
+		entry["system_time"] = median(system);
+		entry["peak_rss"] = peak_rss;
+		entry["syscalls"] = median(syscalls);
+		entry["files_per_second"] = static_cast<double>(data_files.size()) / wall_time;
+		entry["bytes_per_second"] = static_cast<double>(data_bytes) / wall_time;
+		results_scenarios[scenario.name] = std::move(entry);
+
+		std::cout << string_printf("%-16s %9.3fs %9.3fs %9.3fs %9.1f MiB %12" PRIu64 " %12.0f/s %10.1f MiB/s", scenario.name.c_str(), wall_time, median(user), median(system), static_cast<double>(peak_rss) / 1048576., median(syscalls), static_cast<double>(data_files.size()) / wall_time, static_cast<double>(data_bytes) / 1048576. / wall_time) << std::endl;
+	}
+
+	results["scenarios"] = std::move(results_scenarios);
+
+	if (results_path.has_value()) {
+		std::ofstream stream{results_path.value(), std::ios::trunc | std::ios::out};
+		if (!stream.is_open()) {
+			throw std::runtime_error(string_printf("Failed to open file '%s'", results_path.value().generic_u8string().c_str()));
+		}
+		stream << results.dump(1, '\t', false, nlohmann::ordered_json::error_handler_t::replace) << std::endl;
+	}
+
+	if (baseline_path.has_value()) {
+		std::ifstream      stream{baseline_path.value()};
+		std::ostringstream text;
+		if (!stream.is_open()) {
+			throw std::runtime_error(string_printf("Failed to open file '%s'", baseline_path.value().generic_u8string().c_str()));
+		}
+		text << stream.rdbuf();
+
+		std::cout << std::endl;
+		size_t regressions = compare(results, nlohmann::ordered_json::parse(text.str()), threshold / 100.);
+		if (regressions > 0) {
+			std::cout << std::endl << regressions << " regression(s) beyond " << threshold << "%." << std::endl;
+			return 1;
+		}
+	}
+
+	return 0;
+}
+static auto instance = hellextractor::mode(std::string(name), std::string(help), mode_benchmark);
@@ -8,19 +8,43 @@
 //
 // THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
 #include <filesystem>
 #include <fstream>
+#include <functional>
 #include <iostream>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <numeric>
 #include <optional>
 #include <regex>
 #include <set>
+#include <thread>
 #include <unordered_set>
+#include <utility>
+#include "archive.hpp"
+#include "content_store.hpp"
 #include "converter.hpp"
 #include "endian.h"
+#include "gather_write.hpp"
 #include "hash_db.hpp"
+#include "hasher.hpp"
 #include "main.hpp"
+#include "memory_budget.hpp"
+#include "metrics.hpp"
+#include "residency.hpp"
+#include "sink.hpp"
 #include "stingray_data.hpp"
+#include "stingray_file_table.hpp"
 #include "string_printf.hpp"
+#include "trace.hpp"
+#include "wem_vorbis.hpp"
 
 static std::string_view constexpr name = "extract";
 static std::string_view constexpr help = "Extract files from data, stream and gpu_resources files";
@@ -45,6 +69,200 @@ std::set<std::filesystem::path> enumerate_files(std::filesystem::path const& pat
 	return paths;
 };
 
+// Files with fewer outputs than this are written by a single worker, which loads them into a converter of its own.
+// Files with more share one converter between all of their outputs, so that those can be spread over all workers.
+static constexpr size_t parallel_outputs = 4;
+
+namespace {
+	struct pending_t {
+		std::string           section; // A copy, as the views of a converter are only valid until it loads another file.
+		std::filesystem::path path;
+		size_t                size; // 0 if unknown.
+	};
+
+	void extract_output(hellextractor::converter::base const& converter, pending_t const& output, hellextractor::metrics& metrics, hellextractor::metrics::counters_t* type, hellextractor::metrics::counters_t* kind)
+	{
+		hellextractor::trace::span span{"extract"};
+		if (span) {
+			span.detail(output.path.generic_string());
+		}
+		auto start = metrics.now();
+		converter.extract(output.section, output.path);
+		if (metrics.enabled()) {
+			metrics.output(type, kind, output.size ? output.size : std::filesystem::file_size(output.path), metrics.now() - start);
+		}
+	}
+
+	/** Threads that write the outputs of converted files, started once and reused for every file.
+	 *
+	 * Each worker has its own converter pool, which it loads a job's file into unless the job brings a converter along.
+	 * Jobs that do share it with the other outputs of the same file, and rely on extract() being safe to call from
+	 * several threads at once. The queue is bounded, so that the main loop can't run far ahead of the workers. The first
+	 * error drops all queued jobs, and is rethrown by the next call to submit() or finish().
+	 */
+	class extract_workers {
+		public:
+		struct job_t {
+			stingray::data_110000F0::meta_t                       meta;
+			std::shared_ptr<hellextractor::converter::base const> converter; // Loaded from meta by the worker if empty.
+			std::vector<pending_t>                                outputs;
+			hellextractor::metrics::counters_t*                   type;
+			hellextractor::metrics::counters_t*                   kind;
+		};
+
+		private:
+		hellextractor::metrics&  _metrics;
+		size_t                   _limit;
+		std::mutex               _lock;
+		std::condition_variable  _queued;
+		std::condition_variable  _done;
+		std::deque<job_t>        _jobs;
+		size_t                   _busy;
+		bool                     _stop;
+		std::exception_ptr       _error;
+		std::vector<std::thread> _threads;
+
+		public:
+		~extract_workers()
+		{
+			{
+				std::unique_lock<std::mutex> ul(_lock);
+				_stop = true;
+			}
+			_queued.notify_all();
+			for (auto& thread : _threads) {
+				thread.join();
+			}
+		}
+
+		extract_workers(size_t threads, hellextractor::converter::options_t const& options, hellextractor::metrics& metrics) : _metrics(metrics), _limit(threads * 4), _busy(0), _stop(false)
+		{
+			for (size_t idx = 0; idx < threads; idx++) {
+				_threads.emplace_back([this, idx, options]() {
+					hellextractor::trace::name_thread(string_printf("extract worker %zu", idx));
+					hellextractor::converter::pool converters{options};
+					work(converters);
+				});
+			}
+		}
+
+		/** Queue a job, waiting for space in the queue first. */
+		void submit(job_t job)
+		{
+			std::unique_lock<std::mutex> ul(_lock);
+			_done.wait(ul, [this]() { return (_jobs.size() < _limit) || _error; });
+			rethrow();
+			_jobs.push_back(std::move(job));
+			_queued.notify_one();
+		}
+
+		/** Wait for all queued jobs to be written. */
+		void finish()
+		{
+			std::unique_lock<std::mutex> ul(_lock);
+			_done.wait(ul, [this]() { return (_jobs.empty() && (_busy == 0)) || _error; });
+			rethrow();
+		}
+
+		private:
+		void rethrow()
+		{
+			if (_error) {
+				std::rethrow_exception(std::exchange(_error, nullptr));
+			}
+		}
+
+		void work(hellextractor::converter::pool& converters)
+		{
+			std::unique_lock<std::mutex> ul(_lock);
+			while (true) {
+				_queued.wait(ul, [this]() { return !_jobs.empty() || _stop; });
+				if (_stop) {
+					return;
+				}
+
+				auto job = std::move(_jobs.front());
+				_jobs.pop_front();
+				_busy++;
+				ul.unlock();
+				_done.notify_all();
+
+				std::exception_ptr error;
+				try {
+					auto converter = job.converter ? job.converter.get() : converters.find(job.meta);
+					for (auto const& output : job.outputs) {
+						extract_output(*converter, output, _metrics, job.type, job.kind);
+					}
+				} catch (...) {
+					error = std::current_exception();
+				}
+
+				ul.lock();
+				_busy--;
+				if (error && !_error) {
+					_error = error;
+					_jobs.clear();
+				}
+				_done.notify_all();
+			}
+		}
+	};
+} // namespace
+
+/** Parse a type given as 16 hex digits, or as a name which is hashed. Both match what 'hx hash' prints. */
+static stingray::hash_t parse_type(std::string const& text)
+{
+	if ((text.length() == 16) && (text.find_first_not_of("0123456789abcdefABCDEF") == std::string::npos)) {
+		return std::stoull(text, nullptr, 16);
+	}
+
+	auto hasher = hellextractor::hash::instance::create(hellextractor::hash::type::MURMUR_64A);
+	auto hash   = hasher->hash(text.data(), text.length());
+	return htobe64(*reinterpret_cast<uint64_t const*>(hash.data()));
+}
+
+/** Load and validate containers on up to the given number of threads.
+ *
+ * Results are in the same order as the paths, each with either the container or the reason it failed to load.
+ */
+static std::vector<std::pair<std::optional<stingray::data_110000F0>, std::string>> load_parallel(std::vector<std::filesystem::path> const& paths, size_t threads)
+{
+	std::vector<std::pair<std::optional<stingray::data_110000F0>, std::string>> results(paths.size());
+
+	// Chunked zlib streams inflate ranges spanning several chunks in parallel as well, so split the threads between them.
+	size_t loaders   = std::max<size_t>(std::min(threads, paths.size()), 1);
+	size_t inflaters = std::max<size_t>(threads / loaders, 1);
+
+	std::atomic<size_t> next{0};
+
+	auto work = [&]() {
+		for (size_t idx; (idx = next++) < paths.size();) {
+			hellextractor::trace::span span{"container"};
+			if (span) {
+				span.detail(paths[idx].generic_string());
+			}
+			try {
+				results[idx].first.emplace(paths[idx], inflaters);
+			} catch (std::exception const& ex) {
+				results[idx].second = ex.what();
+			}
+		}
+	};
+
+	std::vector<std::thread> workers;
+	for (size_t idx = 1; idx < loaders; idx++) {
+		workers.emplace_back([&work, idx]() {
+			hellextractor::trace::name_thread(string_printf("loader %zu", idx));
+			work();
+		});
+	}
+	work();
+	for (auto& worker : workers) {
+		worker.join();
+	}
+	return results;
+}
+
 int32_t mode_extract(std::vector<std::string> const& args)
 {
 	bool show_help = false;
@@ -61,8 +279,25 @@ int32_t mode_extract(std::vector<std::string> const& args)
 	std::unordered_set<std::filesystem::path> string_paths;
 	bool                                      is_dry    = false;
 	bool                                      rename    = false;
+	bool                                      raw       = false;
 	int32_t                                   verbosity = 0;
 	std::optional<std::filesystem::path>      index_path;
+	std::optional<std::filesystem::path>      archive_path;
+	int32_t                                   archive_level  = 6;
+	std::map<std::string, int32_t>            archive_levels = {{"bik", 0}, {"wem", 0}};
+	size_t                                    threads        = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+	std::optional<std::filesystem::path>      content_path;
+	hellextractor::content_store::link        content_mode = hellextractor::content_store::link::HARDLINK;
+	int32_t                                   texture_mips = 0;
+	bool                                      texture_png  = false;
+	bool                                      unit_glb     = false;
+	std::optional<std::filesystem::path>      vorbis_path;
+	std::optional<std::filesystem::path>      metrics_path;
+	std::optional<std::filesystem::path>      trace_path;
+	bool                                      show_residency = false;
+	std::optional<size_t>                     memory_budget;
+	std::vector<stingray::hash_t>             type_filter;
+	bool                                      compare_duplicates = false;
 
 	// Figure out what is what.
 	for (size_t edx = args.size(), idx = 1; idx < edx; ++idx) {
@@ -122,6 +357,8 @@ int32_t mode_extract(std::vector<std::string> const& args)
 				is_dry = true;
 			} else if ((arg == "-r") || (arg == "--rename")) {
 				rename = true;
+			} else if ((arg == "-R") || (arg == "--raw")) {
+				raw = true;
 			} else if ((arg == "-v") || (arg == "--verbose")) {
 				verbosity++;
 			} else if ((arg == "-q") || (arg == "--quiet")) {
@@ -134,6 +371,133 @@ int32_t mode_extract(std::vector<std::string> const& args)
 					std::cerr << "Expected path, got end of line." << std::endl;
 					return 1;
 				}
+			} else if ((arg == "-a") || (arg == "--archive")) {
+				if ((idx + 1) < edx) {
+					archive_path = std::filesystem::absolute(args[idx + 1]);
+					++idx;
+				} else {
+					std::cerr << "Expected path, got end of line." << std::endl;
+					return 1;
+				}
+			} else if ((arg == "-l") || (arg == "--level")) {
+				if ((idx + 1) < edx) {
+					auto value = args[idx + 1];
+					auto pos   = value.find('=');
+					try {
+						if (pos == std::string::npos) {
+							archive_level = std::clamp(std::stoi(value), 0, 9);
+						} else {
+							archive_levels[value.substr(0, pos)] = std::clamp(std::stoi(value.substr(pos + 1)), 0, 9);
+						}
+					} catch (std::exception const&) {
+						std::cerr << "Expected level, got '" << value << "' instead." << std::endl;
+						return 1;
+					}
+					++idx;
+				} else {
+					std::cerr << "Expected level, got end of line." << std::endl;
+					return 1;
+				}
+			} else if ((arg == "-j") || (arg == "--threads")) {
+				if ((idx + 1) < edx) {
+					try {
+						threads = std::max(std::stoi(args[idx + 1]), 1);
+					} catch (std::exception const&) {
+						std::cerr << "Expected number, got '" << args[idx + 1] << "' instead." << std::endl;
+						return 1;
+					}
+					++idx;
+				} else {
+					std::cerr << "Expected number, got end of line." << std::endl;
+					return 1;
+				}
+			} else if ((arg == "-c") || (arg == "--content")) {
+				if ((idx + 1) < edx) {
+					content_path = std::filesystem::absolute(args[idx + 1]);
+					++idx;
+				} else {
+					std::cerr << "Expected path, got end of line." << std::endl;
+					return 1;
+				}
+			} else if ((arg == "-m") || (arg == "--materialize")) {
+				if ((idx + 1) < edx) {
+					try {
+						content_mode = hellextractor::content_store::parse(args[idx + 1]);
+					} catch (std::exception const& ex) {
+						std::cerr << ex.what() << std::endl;
+						return 1;
+					}
+					++idx;
+				} else {
+					std::cerr << "Expected mode, got end of line." << std::endl;
+					return 1;
+				}
+			} else if ((arg == "-M") || (arg == "--mips")) {
+				if ((idx + 1) < edx) {
+					try {
+						texture_mips = std::stoi(args[idx + 1]);
+					} catch (std::exception const&) {
+						std::cerr << "Expected number, got '" << args[idx + 1] << "' instead." << std::endl;
+						return 1;
+					}
+					++idx;
+				} else {
+					std::cerr << "Expected number, got end of line." << std::endl;
+					return 1;
+				}
+			} else if ((arg == "-P") || (arg == "--png")) {
+				texture_png = true;
+			} else if ((arg == "-G") || (arg == "--glb")) {
+				unit_glb = true;
+			} else if ((arg == "-V") || (arg == "--vorbis")) {
+				if ((idx + 1) < edx) {
+					vorbis_path = std::filesystem::absolute(args[idx + 1]);
+					++idx;
+				} else {
+					std::cerr << "Expected path, got end of line." << std::endl;
+					return 1;
+				}
+			} else if (arg == "--metrics") {
+				if ((idx + 1) < edx) {
+					metrics_path = std::filesystem::absolute(args[idx + 1]);
+					++idx;
+				} else {
+					std::cerr << "Expected path, got end of line." << std::endl;
+					return 1;
+				}
+			} else if ((arg == "-T") || (arg == "--type")) {
+				if ((idx + 1) < edx) {
+					type_filter.push_back(parse_type(args[idx + 1]));
+					++idx;
+				} else {
+					std::cerr << "Expected type, got end of line." << std::endl;
+					return 1;
+				}
+			} else if (arg == "--memory-budget") {
+				if ((idx + 1) < edx) {
+					try {
+						memory_budget = hellextractor::memory_budget::parse(args[idx + 1]);
+					} catch (std::exception const& ex) {
+						std::cerr << ex.what() << std::endl;
+						return 1;
+					}
+					++idx;
+				} else {
+					std::cerr << "Expected size, got end of line." << std::endl;
+					return 1;
+				}
+			} else if (arg == "--compare-duplicates") {
+				compare_duplicates = true;
+			} else if (arg == "--residency") {
+				show_residency = true;
+			} else if (arg == "--trace") {
+				if ((idx + 1) < edx) {
+					trace_path = std::filesystem::absolute(args[idx + 1]);
+					++idx;
+				} else {
+					std::cerr << "Expected path, got end of line." << std::endl;
+					return 1;
+				}
 				//} else if ((arg == "-") || (arg == "--")) {
 			} else {
 				std::cerr << "Unrecognized argument: " << arg << std::endl;
@@ -157,42 +521,85 @@ int32_t mode_extract(std::vector<std::string> const& args)
 		std::cout << "  -t, --types <path>    Add a database file to the Type Hash translation table. Will search the most recently added one first, then continue until there's none left, then search the Strings Hash translation tables." << std::endl;
 		std::cout << "  -n, --names <path>    Add a database file to the Name Hash translation table. Will search the most recently added one first, then continue until there's none left, then search the Strings Hash translation tables." << std::endl;
 		std::cout << "  -s, --strings <path>  Add a database file to the String Hash translation table." << std::endl;
+		std::cout << "  -T, --type <type>     Only include files of this type, given as a name (such as 'texture') or as 16 hex digits. Can be used more than once." << std::endl;
 		std::cout << "  -d, --dry-run         Don't actually do anything." << std::endl;
 		std::cout << "  -r, --rename          Rename/Delete files with older or untranslated names or types." << std::endl;
+		std::cout << "  -R, --raw             Don't convert anything, write every file as it is stored in the container." << std::endl;
 		std::cout << "  -q, --quiet           Decrease verbosity of output." << std::endl;
 		std::cout << "  -v, --verbose         Increase verbosity of output." << std::endl;
 		std::cout << "  -x, --index <path>    Generate an hash -> file index (csv) for use in external tools." << std::endl;
+		std::cout << "  -a, --archive <path>  Write all files into a single archive instead of the output directory. Archives ending in .tar are store-only tar, everything else is zip." << std::endl;
+		std::cout << "  -l, --level <level>   Set the zip compression level (0-9). Use <ext>=<level> to set it for a single extension instead. Default is 6, with 'bik' and 'wem' stored." << std::endl;
+		std::cout << "  -j, --threads <count> Number of threads to use for compression and for writing converted files. Default is the number of hardware threads." << std::endl;
+		std::cout << "  -c, --content <path>  Store every unique payload once in a content-addressed directory, and materialize output files from it." << std::endl;
+		std::cout << "  -m, --materialize <mode>  How output files are materialized from the content store: 'hardlink' (default), 'symlink' or 'manifest' (only writes manifest.csv to the output directory)." << std::endl;
+		std::cout << "  -M, --mips <count>    Only export the <count> largest mip levels of textures, or the smallest ones if <count> is negative. Default is to export all of them." << std::endl;
+		std::cout << "  -P, --png             Also export textures as PNG, decoded from the largest exported mip level." << std::endl;
+		std::cout << "  -G, --glb             Also export units with meshes as binary glTF (.glb)." << std::endl;
+		std::cout << "  -V, --vorbis <path>   Also export Wwise Vorbis streams as Ogg Vorbis, using the packed codebook library at <path> (such as packed_codebooks_aoTuV_603.bin)." << std::endl;
+		std::cout << "      --metrics <path>  Write phase timings, throughput over time and per-type and per-converter counters to <path> as JSON." << std::endl;
+		std::cout << "      --memory-budget <size>  Limit how much of the containers may be in memory at once, such as 512M or 4G. Files are processed in the order they are stored in, and finished ones are dropped from memory and the page cache." << std::endl;
+		std::cout << "      --compare-duplicates  Compare the contents of files that exist in more than one container, instead of only their sizes, and report the ones that differ." << std::endl;
+		std::cout << "      --residency       Show how much of each container was in the page cache when loaded and at the end, page faults and peak memory use." << std::endl;
+		std::cout << "      --trace <path>    Record what every thread is doing to <path> in the Chrome trace event format, for chrome://tracing or Perfetto." << std::endl;
 		std::cout << std::endl;
 		return 1;
 	}
 
+	if (trace_path.has_value()) {
+		hellextractor::trace::enable();
+	}
+	hellextractor::metrics metrics{metrics_path.has_value()};
+
 	// Load translation tables...
 	std::list<hellextractor::hash_db> typedbs;
 	std::list<hellextractor::hash_db> namedbs;
 	std::list<hellextractor::hash_db> strings;
 	{
+		auto timing = metrics.time(hellextractor::metrics::phase::DICTIONARY_LOAD);
 		if (verbosity >= 0)
 			std::cout << "Loading translation tables..." << std::endl;
 		for (auto const& path : type_paths) {
 			if (verbosity >= 1)
 				std::cout << "    " << path.generic_string() << std::endl;
+			hellextractor::trace::span span{"hash_db"};
+			if (span) {
+				span.detail(path.generic_string());
+			}
 			typedbs.emplace_back(path);
 		}
 		for (auto const& path : name_paths) {
 			if (verbosity >= 1)
 				std::cout << "    " << path.generic_string() << std::endl;
+			hellextractor::trace::span span{"hash_db"};
+			if (span) {
+				span.detail(path.generic_string());
+			}
 			namedbs.emplace_back(path);
 		}
 		for (auto const& path : string_paths) {
 			if (verbosity >= 1)
 				std::cout << "    " << path.generic_string() << std::endl;
+			hellextractor::trace::span span{"hash_db"};
+			if (span) {
+				span.detail(path.generic_string());
+			}
 			strings.emplace_back(path);
 		}
 	}
 
+	if (archive_path.has_value() && content_path.has_value()) {
+		std::cerr << "Archive and content store output can't be combined." << std::endl;
+		return 1;
+	}
+
 	// Log some information for the end user.
-	if (verbosity >= 0)
+	if ((verbosity >= 0) && !archive_path.has_value())
 		std::cout << "Writing files to: " << output_path.generic_string() << std::endl;
+	if ((verbosity >= 0) && archive_path.has_value())
+		std::cout << "Writing archive to: " << archive_path.value().generic_string() << std::endl;
+	if ((verbosity >= 0) && content_path.has_value())
+		std::cout << "Storing content in: " << content_path.value().generic_string() << std::endl;
 	if ((verbosity >= 0) && index_path.has_value())
 		std::cout << "Writing index to: " << index_path.value().generic_string() << std::endl;
 
@@ -212,7 +619,39 @@ int32_t mode_extract(std::vector<std::string> const& args)
 		}
 	}
 
+	hellextractor::converter::options_t converter_options;
+	converter_options.mip_limit   = texture_mips;
+	converter_options.png_threads = texture_png ? threads : 0;
+	converter_options.glb         = unit_glb;
+	if (vorbis_path.has_value()) {
+		converter_options.codebooks = std::make_shared<hellextractor::vorbis_codebooks>(vorbis_path.value());
+	}
+
+	std::optional<hellextractor::archive> archive;
+	if (archive_path.has_value() && !is_dry) {
+		archive.emplace(archive_path.value(), hellextractor::archive::detect(archive_path.value()), threads);
+	}
+	std::optional<hellextractor::content_store> content;
+	if (content_path.has_value() && !is_dry) {
+		content.emplace(content_path.value(), content_mode, output_path / "manifest.csv");
+	}
+
+	// Archives and manifests don't write any loose files, so none of the existing file checks apply to them.
+	bool writes_files = !archive_path.has_value() && !(content_path.has_value() && (content_mode == hellextractor::content_store::link::MANIFEST));
+
+	auto archive_level_for = [&archive_level, &archive_levels](std::filesystem::path const& file_name) {
+		auto extension = file_name.extension().generic_string();
+		if (!extension.empty()) {
+			extension = extension.substr(1);
+		}
+		if (auto kv = archive_levels.find(extension); kv != archive_levels.end()) {
+			return kv->second;
+		}
+		return archive_level;
+	};
+
 	{ // Filter input path either by default filter, or by user specified
+		auto timing = metrics.time(hellextractor::metrics::phase::INPUT_ENUMERATION);
 		std::set<std::filesystem::path> paths;
 		for (auto const& path : input_paths) {
 			paths.merge(enumerate_files(path, [&input_filter](std::filesystem::path const& path) {
@@ -232,30 +671,80 @@ int32_t mode_extract(std::vector<std::string> const& args)
 	if (verbosity >= 0)
 		std::cout << "Loading " << input_paths.size() << " containers..." << std::endl;
 	std::list<stingray::data_110000F0> containers;
-	for (auto const& path : input_paths) {
-		try {
-			containers.emplace_back(path);
+	hellextractor::residency           residency;
+	bool                               track_residency = show_residency || metrics.enabled();
+	{
+		auto timing = metrics.time(hellextractor::metrics::phase::CONTAINER_LOAD);
+		auto paths  = std::vector<std::filesystem::path>(input_paths.begin(), input_paths.end());
+		auto loaded = load_parallel(paths, threads);
+		for (size_t idx = 0; idx < paths.size(); idx++) {
+			if (!loaded[idx].first.has_value()) {
+				std::cerr << "Error loading '" << paths[idx].generic_string() << "': " << loaded[idx].second << std::endl;
+				continue;
+			}
+
+			auto& container = containers.emplace_back(std::move(loaded[idx].first.value()));
+			if (track_residency) {
+				residency.add(container);
+			}
 			if (verbosity >= 1)
-				std::cout << "    " << path.generic_string() << std::endl;
-		} catch (std::exception const& ex) {
-			std::cerr << "Error loading '" << path.generic_string() << "': " << ex.what() << std::endl;
-			continue;
+				std::cout << "    " << paths[idx].generic_string() << std::endl;
+		}
+	}
+
+	// Archive entries are compressed after the file is done, so they may only reference the mapped containers.
+	std::vector<std::pair<void const*, size_t>> persistent;
+	for (auto const& container : containers) {
+		for (auto const& [kind, mapping] : container.mappings()) {
+			persistent.emplace_back(&(*mapping), mapping->size());
 		}
 	}
+	std::sort(persistent.begin(), persistent.end(), [](auto const& a, auto const& b) { return reinterpret_cast<uintptr_t>(a.first) < reinterpret_cast<uintptr_t>(b.first); });
 
 	// Merge all containers to get a full view of what we really have.
-	typedef std::pair<stingray::hash_t, stingray::hash_t> key_t;
-	typedef stingray::data_110000F0::meta_t               data_t;
-	std::map<key_t, data_t>                               files;
-	for (auto const& cont : containers) {
-		for (size_t i = 0; i < cont.files(); i++) {
-			// In all testing, files that existed multiple times had zero differences. So this is safe to do.
-			auto file = cont.meta(i);
-			files.try_emplace(key_t{file.file.id, file.file.type}, file);
+	stingray::file_table           table;
+	stingray::file_table::merged_t merged;
+	{
+		auto timing = metrics.time(hellextractor::metrics::phase::MERGE);
+		for (auto const& cont : containers) {
+			table.add(cont);
 		}
+
+		// Rows stay in container order, which decides which copy of a file is kept.
+		std::vector<size_t> rows;
+		if (type_filter.empty()) {
+			rows.resize(table.size());
+			std::iota(rows.begin(), rows.end(), 0);
+		} else {
+			for (auto const& type : type_filter) {
+				auto selected = table.select(type);
+				rows.insert(rows.end(), selected.begin(), selected.end());
+			}
+			std::sort(rows.begin(), rows.end());
+			rows.erase(std::unique(rows.begin(), rows.end()), rows.end());
+		}
+
+		merged = table.merge(rows, threads, compare_duplicates);
 	}
 	if (verbosity >= 0)
-		std::cout << "Found " << files.size() << " files." << std::endl;
+		std::cout << "Found " << merged.rows.size() << " files." << std::endl;
+	for (auto const& conflict : merged.conflicts) {
+		auto const& kept      = table.container(table.container_indices()[conflict.kept]);
+		auto const& duplicate = table.container(table.container_indices()[conflict.duplicate]);
+		std::cerr << string_printf("Conflicting copies of %016" PRIx64 ".%016" PRIx64 ", keeping the one in '%s' over '%s'.", table.ids()[conflict.kept], table.types()[conflict.kept], kept.path().generic_string().c_str(), duplicate.path().generic_string().c_str()) << std::endl;
+	}
+
+	// Files are processed in key order, unless there is a memory budget. Then they are processed in the order they are
+	// stored in, one container after another, so that finished ranges can be dropped.
+	std::vector<uint32_t>                       order = std::move(merged.rows);
+	std::optional<hellextractor::memory_budget> budget;
+	if (memory_budget.has_value()) {
+		budget.emplace(memory_budget.value());
+
+		auto containers = table.container_indices();
+		auto offsets    = table.main_offsets();
+		std::stable_sort(order.begin(), order.end(), [&containers, &offsets](uint32_t a, uint32_t b) { return (containers[a] != containers[b]) ? (containers[a] < containers[b]) : (offsets[a] < offsets[b]); });
+	}
 
 	// Export files (if not in dry run mode)
 	size_t stats_total    = 0;
@@ -266,13 +755,30 @@ int32_t mode_extract(std::vector<std::string> const& args)
 	size_t stats_filtered = 0;
 	size_t stats_names    = 0;
 	size_t stats_types    = 0;
-	if (!is_dry) {
+	if (!is_dry && writes_files) {
 		std::filesystem::create_directories(output_path);
 	}
-	for (auto const& file : files) {
-		auto meta = file.second;
+	hellextractor::converter::pool converters{converter_options};
+
+	// Converted files are spread over all workers, so each PNG is encoded on a single thread. Otherwise every worker
+	// would start as many threads again.
+	hellextractor::converter::options_t worker_options = converter_options;
+	std::optional<extract_workers>      workers;
+	worker_options.png_threads = std::min<size_t>(worker_options.png_threads, 1);
+	if ((threads > 1) && !is_dry && writes_files) {
+		workers.emplace(threads, worker_options, metrics);
+	}
+	for (auto row : order) {
+		// The file span has to outlive the phase timer, so that the phases nest inside of it.
+		hellextractor::trace::span span{"file"};
+		auto                       meta   = table.meta(row);
+		auto                       timing = metrics.time(hellextractor::metrics::phase::TRANSLATION);
 		stats_total++;
 
+		if (budget) {
+			budget->use(table.container(table.container_indices()[row]), meta);
+		}
+
 		auto translations = [](stingray::hash_t hash, std::list<hellextractor::hash_db>& primary, std::list<hellextractor::hash_db>& secondary) {
 			std::vector<std::string> translations;
 
@@ -321,8 +827,11 @@ int32_t mode_extract(std::vector<std::string> const& args)
 		// Generate a proper file path.
 		auto base_file_name = std::filesystem::path(permutations[0].first).replace_extension(permutations[0].second);
 		auto base_file_path = output_path / base_file_name;
+		if (span) {
+			span.detail(base_file_name.generic_string());
+		}
 
-		if (!is_dry) {
+		if (!is_dry && writes_files) {
 			std::filesystem::create_directories(base_file_path.parent_path());
 		}
 
@@ -335,19 +844,34 @@ int32_t mode_extract(std::vector<std::string> const& args)
 		}
 
 		// Try to create a converter for the file type.
-		auto converter = hellextractor::converter::registry::find(meta);
+		timing.next(hellextractor::metrics::phase::CONVERSION);
+		auto converter = raw ? nullptr : converters.find(meta);
+
+		hellextractor::metrics::counters_t* type_counters      = nullptr;
+		hellextractor::metrics::counters_t* converter_counters = nullptr;
+		if (metrics.enabled()) {
+			type_counters      = metrics.type(permutations[0].second);
+			converter_counters = metrics.converter(converter ? hellextractor::converter::registry::name(hellextractor::converter::registry::index(meta.file.type)) : "none");
+			metrics.file(type_counters, converter_counters);
+		}
+
 		if (converter) {
-			auto outputs = converter->outputs();
+			auto const& outputs = converter->outputs();
+
+			// Plain files are written once all outputs have been looked at, so that converters with many outputs
+			// such as sound banks can be written in parallel.
+			std::vector<pending_t> pending;
 
 			stats_total--;
 			stats_total += outputs.size();
 
 			// Remove pre-conversion data.
-			if (std::filesystem::exists(base_file_path)) {
+			timing.next(hellextractor::metrics::phase::RENAME);
+			if (writes_files && std::filesystem::exists(base_file_path)) {
 				// Ensure that the default name is not a possible output.
 				bool is_output = false;
-				for (auto output : outputs) {
-					if (permutations[0].second == output.second.second)
+				for (auto const& output : outputs) {
+					if (permutations[0].second == output.extension)
 						is_output = true;
 				}
 
@@ -362,11 +886,12 @@ int32_t mode_extract(std::vector<std::string> const& args)
 			}
 
 			// Go through each output.
-			for (auto output : outputs) {
+			for (auto const& output : outputs) {
 				bool do_export = true;
+				timing.next(hellextractor::metrics::phase::RENAME);
 
 				// Figure out the file name and absolute path.
-				auto   file_name = std::filesystem::path(permutations[0].first).replace_extension(output.second.second);
+				auto   file_name = std::filesystem::path(permutations[0].first).replace_extension(output.extension);
 				auto   file_path = output_path / file_name;
 				size_t file_size = 0;
 
@@ -378,7 +903,7 @@ int32_t mode_extract(std::vector<std::string> const& args)
 						<< string_printf("%016" PRIx64, (uint64_t)meta.file.id) << "," //
 						<< string_printf("%016" PRIx64, (uint64_t)meta.file.type) << "," //
 						<< file_name.generic_string() << "," //
-						<< output.first //
+						<< output.section //
 						<< std::endl;
 				}
 
@@ -390,16 +915,18 @@ int32_t mode_extract(std::vector<std::string> const& args)
 					continue;
 				}
 
-				// Check if the existing file needs to be exported again.
-				bool file_exists = std::filesystem::exists(file_path);
+				// Check if the existing file needs to be exported again. Outputs are only ever renamed into place once complete,
+				// so if the size isn't known up front, any existing file that isn't empty is taken as it is.
+				auto is_complete = [&output](size_t size) { return output.size ? (size == output.size) : (size > 0); };
+				bool file_exists = writes_files && std::filesystem::exists(file_path);
 				if (file_exists) {
 					file_size = std::filesystem::file_size(file_path);
-					do_export = (file_size != output.second.first);
+					do_export = !is_complete(file_size);
 				}
 
 				// Rename or delete older files if the user requested it.
-				if (rename) {
-					auto renamedeleter = [&file_name, &file_path, &do_export, &stats_renamed, &stats_removed, &is_dry, &verbosity, &output_path, &output, &file_exists](std::filesystem::path path) {
+				if (rename && writes_files) {
+					auto renamedeleter = [&file_name, &file_path, &do_export, &stats_renamed, &stats_removed, &is_dry, &verbosity, &output_path, &is_complete, &file_exists](std::filesystem::path path) {
 						auto old_file_name = path;
 						auto old_file_path = output_path / old_file_name;
 
@@ -411,7 +938,7 @@ int32_t mode_extract(std::vector<std::string> const& args)
 						// If the old file exists...
 						if (std::filesystem::exists(old_file_path)) {
 							// Then attempt to rename the file if it is the correct size, and we need to export, and the target doesn't exist.
-							if ((std::filesystem::file_size(old_file_path) == output.second.first) && do_export && !file_exists) {
+							if (is_complete(std::filesystem::file_size(old_file_path)) && do_export && !file_exists) {
 								if (verbosity >= 0)
 									std::cout << "  r " << old_file_name.generic_string() << " -> " << file_name.generic_string() << " <- " << std::endl;
 								if (!is_dry) {
@@ -433,7 +960,7 @@ int32_t mode_extract(std::vector<std::string> const& args)
 
 					// Go through all permutations.
 					for (size_t idx = 1; idx < permutations.size(); idx++) {
-						renamedeleter(std::filesystem::path(permutations[idx].first).concat(".").concat(permutations[idx].second).concat(".").concat(output.second.second));
+						renamedeleter(std::filesystem::path(permutations[idx].first).concat(".").concat(permutations[idx].second).concat(".").concat(output.extension));
 					}
 				}
 
@@ -442,8 +969,23 @@ int32_t mode_extract(std::vector<std::string> const& args)
 					if (verbosity >= 0)
 						std::cout << "  e " << file_name.generic_string() << std::endl;
 
-					if (!is_dry) {
-						converter->extract(output.first, file_path);
+					if (archive) {
+						timing.next(hellextractor::metrics::phase::CONVERSION);
+						auto                        start = metrics.now();
+						hellextractor::archive_sink sink{*archive, file_name.generic_string(), archive_level_for(file_name), persistent};
+						converter->extract(output.section, sink);
+						sink.close();
+						metrics.output(type_counters, converter_counters, output.size, metrics.now() - start);
+					} else if (content) {
+						timing.next(hellextractor::metrics::phase::CONVERSION);
+						auto                       start = metrics.now();
+						hellextractor::memory_sink sink;
+						converter->extract(output.section, sink);
+						sink.close();
+						content->add(file_path, file_name.generic_string(), {{sink.data().data(), sink.data().size()}});
+						metrics.output(type_counters, converter_counters, sink.data().size(), metrics.now() - start);
+					} else if (!is_dry) {
+						pending.push_back({std::string(output.section), file_path, output.size});
 					}
 					stats_written++;
 				} else {
@@ -452,11 +994,27 @@ int32_t mode_extract(std::vector<std::string> const& args)
 					stats_skipped++;
 				}
 			}
+
+			timing.next(hellextractor::metrics::phase::WRITE);
+			if (workers && (pending.size() >= parallel_outputs)) {
+				// The workers share a converter of their own, as the pooled one is loaded with the next file right away.
+				std::shared_ptr<hellextractor::converter::base const> shared = hellextractor::converter::registry::find(meta, worker_options);
+				for (auto& output : pending) {
+					workers->submit({meta, shared, {std::move(output)}, type_counters, converter_counters});
+				}
+			} else if (workers && !pending.empty()) {
+				workers->submit({meta, nullptr, std::move(pending), type_counters, converter_counters});
+			} else {
+				for (auto const& output : pending) {
+					extract_output(*converter, output, metrics, type_counters, converter_counters);
+				}
+			}
 		} else {
 			bool   needs_export = true;
 			bool   had_rename   = false;
 			size_t data_size    = (meta.main_size + meta.gpu_size + meta.stream_size);
 
+			timing.next(hellextractor::metrics::phase::RENAME);
 			if (verbosity >= 1)
 				std::cout << "  " << base_file_name.generic_string() << std::endl;
 
@@ -471,13 +1029,13 @@ int32_t mode_extract(std::vector<std::string> const& args)
 			}
 
 			// Check if the target file is a different size.
-			bool file_exists = std::filesystem::exists(base_file_path);
+			bool file_exists = writes_files && std::filesystem::exists(base_file_path);
 			if (file_exists) {
 				needs_export = std::filesystem::file_size(base_file_path) != data_size;
 			}
 
 			// Rename any existing files.
-			if (rename) {
+			if (rename && writes_files) {
 				for (size_t idx = 1; idx < permutations.size(); idx++) {
 					auto lfile = std::filesystem::path(permutations[idx].first).replace_extension(permutations[idx].second);
 					auto lpath = output_path / lfile;
@@ -513,36 +1071,19 @@ int32_t mode_extract(std::vector<std::string> const& args)
 				if (verbosity >= 0)
 					std::cout << "  e " << base_file_name.generic_string() << std::endl;
 
-				if (!is_dry) {
-					std::ofstream stream{base_file_path, std::ios::trunc | std::ios::binary | std::ios::out};
-					if (!stream || stream.bad() || !stream.is_open()) {
-						throw std::runtime_error(string_printf("Failed to export '%s'.", base_file_name.generic_string().c_str()));
-					}
-					stream.flush();
-
-					if (meta.main_size) {
-						if (verbosity >= 1)
-							std::cout << "        Writing main section..." << std::endl;
-						stream.write(reinterpret_cast<char const*>(meta.main), meta.main_size);
-						stream.flush();
-					}
-
-					if (meta.stream_size) {
-						if (verbosity >= 1)
-							std::cout << "        Writing stream section..." << std::endl;
-						stream.write(reinterpret_cast<char const*>(meta.stream), meta.stream_size);
-						stream.flush();
-					}
-
-					if (meta.gpu_size) {
-						if (verbosity >= 1)
-							std::cout << "        Writing gpu section..." << std::endl;
-						stream.write(reinterpret_cast<char const*>(meta.gpu), meta.gpu_size);
-						stream.flush();
-					}
-
-					stream.close();
+				timing.next(hellextractor::metrics::phase::WRITE);
+				auto start = metrics.now();
+				if (archive && meta.stream_owner) {
+					// Inflated .stream data is freed with the meta, so the archive needs its own copy of it.
+					archive->add(base_file_name.generic_string(), std::string(static_cast<char const*>(meta.stream), meta.stream_size), {{meta.main, meta.main_size}, {nullptr, meta.stream_size}, {meta.gpu, meta.gpu_size}}, archive_level_for(base_file_name));
+				} else if (archive) {
+					archive->add(base_file_name.generic_string(), {{meta.main, meta.main_size}, {meta.stream, meta.stream_size}, {meta.gpu, meta.gpu_size}}, archive_level_for(base_file_name));
+				} else if (content) {
+					content->add(base_file_path, base_file_name.generic_string(), {{meta.main, meta.main_size}, {meta.stream, meta.stream_size}, {meta.gpu, meta.gpu_size}});
+				} else if (!is_dry) {
+					hellextractor::gather_write(base_file_path, {{meta.main, meta.main_size}, {meta.stream, meta.stream_size}, {meta.gpu, meta.gpu_size}});
 				}
+				metrics.output(type_counters, converter_counters, data_size, metrics.now() - start);
 				stats_written++;
 			} else {
 				if (verbosity >= 1)
@@ -551,6 +1092,21 @@ int32_t mode_extract(std::vector<std::string> const& args)
 			}
 		}
 	}
+	if (workers) {
+		workers->finish();
+	}
+
+	if (archive) {
+		if (verbosity >= 0)
+			std::cout << "Finishing archive..." << std::endl;
+		archive->close();
+	}
+	if (budget) {
+		budget->finish();
+	}
+	if (track_residency) {
+		residency.sample();
+	}
 
 	std::cout << std::endl;
 	if (verbosity >= 0) {
@@ -560,11 +1116,54 @@ int32_t mode_extract(std::vector<std::string> const& args)
 		std::cout << "    Filtered: " << stats_filtered << std::endl;
 		std::cout << "    Names Translated: " << stats_names << std::endl;
 		std::cout << "    Types Translated: " << stats_types << std::endl;
+		if (content) {
+			std::cout << "Content Store: " << std::endl;
+			std::cout << "    Stored:   " << content->stored() << std::endl;
+			std::cout << "    Deduplicated: " << content->reused() << std::endl;
+		}
 		if (rename) {
 			std::cout << "Filesystem changes: " << std::endl;
 			std::cout << "    Renamed:  " << stats_renamed << std::endl;
 			std::cout << "    Deleted:  " << stats_removed << std::endl;
 		}
+		if (budget) {
+			std::cout << "Memory Budget: " << std::endl;
+			std::cout << "    Released: " << string_printf("%.1f MiB", static_cast<double>(budget->released()) / 1048576.) << std::endl;
+		}
+		if (show_residency) {
+			std::cout << "Page Cache: " << std::endl;
+			residency.print(std::cout);
+		}
+	}
+
+	if (metrics_path.has_value()) {
+		nlohmann::ordered_json totals = nlohmann::ordered_json::object();
+		totals["total"] = stats_total;
+		totals["exported"] = stats_written;
+		totals["skipped"] = stats_skipped;
+		totals["filtered"] = stats_filtered;
+		totals["renamed"] = stats_renamed;
+		totals["removed"] = stats_removed;
+		totals["names_translated"] = stats_names;
+		totals["types_translated"] = stats_types;
+		totals["duplicates"] = merged.duplicates;
+		totals["conflicts"] = merged.conflicts.size();
+		if (content) {
+			totals["content_stored"] = content->stored();
+			totals["content_reused"] = content->reused();
+		}
+
+		std::ofstream stream{metrics_path.value(), std::ios::trunc | std::ios::out};
+		if (!stream.is_open()) {
+			throw std::runtime_error("Failed to open metrics file for writing");
+		}
+		auto report = metrics.report(std::move(totals));
+		report["residency"] = residency.report();
+		stream << report.dump(1, '\t', false, nlohmann::ordered_json::error_handler_t::replace) << std::endl;
+	}
+
+	if (trace_path.has_value()) {
+		hellextractor::trace::write(trace_path.value());
 	}
 
 	return 0;
@@ -0,0 +1,125 @@
+// Copyright 2024 Michael Fabian 'Xaymar' Dirks <info@xaymar.com>
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include <cinttypes>
+#include <cstddef>
+#include <filesystem>
+#include <iostream>
+#include <optional>
+#include <type_traits>
+#include "main.hpp"
+#include "synthetic.hpp"
+
+static std::string_view constexpr name = "generate";
+static std::string_view constexpr help = "Generate synthetic containers for testing and benchmarking";
+
+int32_t mode_generate(std::vector<std::string> const& args)
+{
+	bool show_help = false;
+	if (args.size() == 1) {
+		show_help = true;
+	}
+
+	std::optional<std::filesystem::path> output_path;
+	hellextractor::synthetic::options_t  options;
+
+	// Every option except the mix takes a number.
+	auto number = [&args](size_t idx, auto& value) {
+		if ((idx + 1) >= args.size()) {
+			std::cerr << "Expected number, got end of line." << std::endl;
+			return false;
+		}
+		try {
+			if constexpr (std::is_floating_point_v<std::remove_reference_t<decltype(value)>>) {
+				value = std::stod(args[idx + 1]);
+			} else {
+				value = static_cast<std::remove_reference_t<decltype(value)>>(std::stoull(args[idx + 1]));
+			}
+		} catch (std::exception const&) {
+			std::cerr << "Expected number, got '" << args[idx + 1] << "' instead." << std::endl;
+			return false;
+		}
+		return true;
+	};
+
+	for (size_t edx = args.size(), idx = 1; idx < edx; ++idx) {
+		auto arg = args[idx];
+		if (arg[0] == '-') {
+			bool valid = true;
+			if ((arg == "-h") || (arg == "--help")) {
+				show_help = true;
+				continue;
+			} else if (arg == "--seed") {
+				valid = number(idx, options.seed);
+			} else if ((arg == "-c") || (arg == "--containers")) {
+				valid = number(idx, options.containers);
+			} else if ((arg == "-n") || (arg == "--files")) {
+				valid = number(idx, options.files);
+			} else if ((arg == "-d") || (arg == "--duplicates")) {
+				valid = number(idx, options.duplicates);
+			} else if ((arg == "-N") || (arg == "--named")) {
+				valid = number(idx, options.named);
+			} else if (arg == "--min-size") {
+				valid = number(idx, options.min_size);
+			} else if (arg == "--max-size") {
+				valid = number(idx, options.max_size);
+			} else if ((arg == "-m") || (arg == "--mix")) {
+				if ((idx + 1) >= edx) {
+					std::cerr << "Expected mix, got end of line." << std::endl;
+					return 1;
+				}
+				try {
+					hellextractor::synthetic::parse_mix(args[idx + 1], options);
+				} catch (std::exception const& ex) {
+					std::cerr << ex.what() << std::endl;
+					return 1;
+				}
+			} else {
+				std::cerr << "Unrecognized argument: " << arg << std::endl;
+				return 1;
+			}
+			if (!valid) {
+				return 1;
+			}
+			++idx;
+		} else {
+			output_path = std::filesystem::absolute(arg);
+		}
+	}
+
+	if (show_help || !output_path.has_value()) {
+		auto self = std::filesystem::path(args[0]).filename();
+		std::cout << self.generic_string() << " " << name << " [options] output_path" << std::endl;
+		std::cout << "Generates synthetic data_110000F0 containers with .stream and .gpu_resources files, and a names.txt name database. The same options always generate the same data." << std::endl;
+		std::cout << std::endl;
+		std::cout << "Options" << std::endl;
+		std::cout << "  -h, --help            Show this help" << std::endl;
+		std::cout << "      --seed <seed>     Seed for the random number generator. Default is 1." << std::endl;
+		std::cout << "  -c, --containers <count>  Number of containers. Default is 4." << std::endl;
+		std::cout << "  -n, --files <count>   Number of files in each container. Default is 1000." << std::endl;
+		std::cout << "  -d, --duplicates <ratio>  Share of files that also appear in an earlier container. Default is 0.1." << std::endl;
+		std::cout << "  -N, --named <ratio>   Share of file names written to names.txt. Default is 0.9." << std::endl;
+		std::cout << "      --min-size <size> Smallest payload size in bytes. Default is 256." << std::endl;
+		std::cout << "      --max-size <size> Largest payload size in bytes, sizes are roughly log-uniform in between. Default is 262144." << std::endl;
+		std::cout << "  -m, --mix <kind>=<weight>[,...]  Relative weight of each kind of file: texture, bik, unit, wwise_stream, wwise_bank and other. Default is texture=4,bik=1,unit=2,wwise_stream=3,wwise_bank=1,other=6." << std::endl;
+		std::cout << std::endl;
+		return 1;
+	}
+
+	hellextractor::synthetic::generator generator{options};
+	auto                                paths = generator.generate(output_path.value());
+	for (auto const& path : paths) {
+		std::cout << path.generic_string() << std::endl;
+	}
+
+	return 0;
+}
+static auto instance = hellextractor::mode(std::string(name), std::string(help), mode_generate);
@@ -0,0 +1,197 @@
+// Copyright 2024 Michael Fabian 'Xaymar' Dirks <info@xaymar.com>
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "png.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include "zlib-ng.h"
+
+// Rows per strip. Must be a multiple of 4, so strips always start on a block row.
+static constexpr size_t strip_rows = 64;
+
+static constexpr int32_t compression_level = 3;
+
+static void put32be(std::string& out, uint32_t value)
+{
+	char bytes[4] = {static_cast<char>(value >> 24), static_cast<char>(value >> 16), static_cast<char>(value >> 8), static_cast<char>(value)};
+	out.append(bytes, sizeof(bytes));
+}
+
+static void write_chunk(std::ostream& stream, char const type[4], void const* data, size_t size)
+{
+	std::string header;
+	put32be(header, static_cast<uint32_t>(size));
+	header.append(type, 4);
+
+	uint32_t crc = zng_crc32(0, reinterpret_cast<uint8_t const*>(type), 4);
+	if (size > 0) {
+		crc = zng_crc32(crc, reinterpret_cast<uint8_t const*>(data), static_cast<uint32_t>(size));
+	}
+
+	std::string footer;
+	put32be(footer, crc);
+
+	stream.write(header.data(), header.size());
+	if (size > 0) {
+		stream.write(reinterpret_cast<char const*>(data), size);
+	}
+	stream.write(footer.data(), footer.size());
+}
+
+static uint8_t paeth(uint8_t a, uint8_t b, uint8_t c)
+{
+	int32_t p  = a + b - c;
+	int32_t pa = std::abs(p - a);
+	int32_t pb = std::abs(p - b);
+	int32_t pc = std::abs(p - c);
+	if ((pa <= pb) && (pa <= pc)) {
+		return a;
+	} else if (pb <= pc) {
+		return b;
+	}
+	return c;
+}
+
+struct strip_t {
+	std::vector<uint8_t> compressed;
+	uint32_t             adler;
+	size_t               size;
+};
+
+/** Fetch, filter and deflate a single strip. The first row of every strip uses the Sub filter, so strips don't depend
+ * on each other, and every other row uses Paeth.
+ */
+static void encode_strip(strip_t& strip, uint32_t width, uint32_t height, size_t y, bool last, hellextractor::png::source_t const& source)
+{
+	size_t rows   = std::min<size_t>(strip_rows, height - y);
+	size_t stride = width * 4ull;
+
+	std::vector<uint8_t> pixels(rows * stride);
+	source(y, rows, pixels.data(), stride);
+
+	std::vector<uint8_t> filtered(rows * (stride + 1));
+	for (size_t row = 0; row < rows; row++) {
+		uint8_t const* cur  = pixels.data() + row * stride;
+		uint8_t const* prev = row ? (cur - stride) : nullptr;
+		uint8_t*       out  = filtered.data() + row * (stride + 1);
+		if (!prev) {
+			*out++ = 1; // Sub
+			for (size_t idx = 0; idx < stride; idx++) {
+				out[idx] = static_cast<uint8_t>(cur[idx] - ((idx >= 4) ? cur[idx - 4] : 0));
+			}
+		} else {
+			*out++ = 4; // Paeth
+			for (size_t idx = 0; idx < stride; idx++) {
+				uint8_t a = (idx >= 4) ? cur[idx - 4] : 0;
+				uint8_t c = (idx >= 4) ? prev[idx - 4] : 0;
+				out[idx]  = static_cast<uint8_t>(cur[idx] - paeth(a, prev[idx], c));
+			}
+		}
+	}
+
+	strip.size  = filtered.size();
+	strip.adler = zng_adler32(1, filtered.data(), static_cast<uint32_t>(filtered.size()));
+
+	zng_stream strm = {};
+	if (zng_deflateInit2(&strm, compression_level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+		throw std::runtime_error("zng_deflateInit2 failed.");
+	}
+	std::shared_ptr<zng_stream> guard(&strm, [](zng_stream* p) { zng_deflateEnd(p); });
+
+	// Leave some room for the empty stored block that the flush adds.
+	size_t bound     = zng_deflateBound(&strm, static_cast<unsigned long>(filtered.size())) + 16;
+	strip.compressed = std::vector<uint8_t>(bound);
+	strm.next_in   = filtered.data();
+	strm.avail_in  = static_cast<uint32_t>(filtered.size());
+	strm.next_out  = strip.compressed.data();
+	strm.avail_out = static_cast<uint32_t>(strip.compressed.size());
+
+	// Only the last strip may finish the stream, all others end on an empty stored block.
+	int result = zng_deflate(&strm, last ? Z_FINISH : Z_SYNC_FLUSH);
+	if ((result != (last ? Z_STREAM_END : Z_OK)) || (strm.avail_in != 0)) {
+		throw std::runtime_error("zng_deflate failed.");
+	}
+	strip.compressed.erase(strip.compressed.end() - strm.avail_out, strip.compressed.end());
+}
+
+void hellextractor::png::encode(std::ostream& stream, uint32_t width, uint32_t height, source_t const& source, size_t threads)
+{
+	if ((width == 0) || (height == 0)) {
+		throw std::runtime_error("Can't encode an empty image.");
+	}
+
+	// Compress all strips in parallel.
+	std::vector<strip_t> strips((height + strip_rows - 1) / strip_rows);
+	{
+		std::atomic_size_t next = 0;
+		std::mutex         lock;
+		std::exception_ptr error;
+
+		auto work = [&]() {
+			try {
+				for (size_t idx = next++; idx < strips.size(); idx = next++) {
+					encode_strip(strips[idx], width, height, idx * strip_rows, (idx + 1) == strips.size(), source);
+				}
+			} catch (...) {
+				std::lock_guard<std::mutex> lg(lock);
+				if (!error) {
+					error = std::current_exception();
+				}
+				next = strips.size();
+			}
+		};
+
+		std::vector<std::thread> workers;
+		for (size_t idx = 1, edx = std::min(threads, strips.size()); idx < edx; idx++) {
+			workers.emplace_back(work);
+		}
+		work();
+		for (auto& worker : workers) {
+			worker.join();
+		}
+		if (error) {
+			std::rethrow_exception(error);
+		}
+	}
+
+	stream.write("\x89PNG\r\n\x1A\n", 8);
+
+	std::string ihdr;
+	put32be(ihdr, width);
+	put32be(ihdr, height);
+	ihdr.append("\x08\x06\x00\x00\x00", 5); // 8-bit RGBA, no interlacing.
+	write_chunk(stream, "IHDR", ihdr.data(), ihdr.size());
+
+	// One IDAT per strip. The zlib header goes in front of the first one, the combined checksum after the last one.
+	uint32_t adler = 1;
+	for (size_t idx = 0; idx < strips.size(); idx++) {
+		auto& strip = strips[idx];
+		adler       = zng_adler32_combine(adler, strip.adler, static_cast<z_off64_t>(strip.size));
+		if (idx == 0) {
+			strip.compressed.insert(strip.compressed.begin(), {0x78, 0x01});
+		}
+		if ((idx + 1) == strips.size()) {
+			uint8_t footer[4] = {static_cast<uint8_t>(adler >> 24), static_cast<uint8_t>(adler >> 16), static_cast<uint8_t>(adler >> 8), static_cast<uint8_t>(adler)};
+			strip.compressed.insert(strip.compressed.end(), footer, footer + sizeof(footer));
+		}
+		write_chunk(stream, "IDAT", strip.compressed.data(), strip.compressed.size());
+	}
+
+	write_chunk(stream, "IEND", nullptr, 0);
+}
@@ -0,0 +1,117 @@
+// Copyright 2024 Michael Fabian 'Xaymar' Dirks <info@xaymar.com>
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "residency.hpp"
+#include "string_printf.hpp"
+
+#ifdef WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#include <Psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+static std::string mebibytes(uint64_t bytes)
+{
+	return string_printf("%.1f MiB", static_cast<double>(bytes) / 1048576.);
+}
+
+hellextractor::residency::~residency() {}
+
+hellextractor::residency::residency() : _containers() {}
+
+void hellextractor::residency::add(stingray::data_110000F0 const& container)
+{
+	auto& entry = _containers.emplace_back(container_t{container.path(), {}});
+	for (auto const& mapping : container.mappings()) {
+		auto resident = mapping.second->resident();
+		entry.sections.push_back({mapping.first, mapping.second, mapping.second->size(), resident, resident});
+	}
+}
+
+void hellextractor::residency::sample()
+{
+	for (auto& container : _containers) {
+		for (auto& section : container.sections) {
+			section.resident = section.file->resident();
+		}
+	}
+}
+
+nlohmann::ordered_json hellextractor::residency::report() const
+{
+	auto usage = residency::usage();
+
+	auto containers = nlohmann::ordered_json::array();
+	for (auto const& container : _containers) {
+		auto sections = nlohmann::ordered_json::object();
+		for (auto const& section : container.sections) {
+			auto value = nlohmann::ordered_json::object();
+			value["mapped"] = section.mapped;
+			value["resident_at_load"] = section.resident_at_load;
+			value["resident"] = section.resident;
+			sections[std::string{section.name}] = std::move(value);
+		}
+
+		auto value = nlohmann::ordered_json::object();
+		value["path"] = container.path.generic_string();
+		value["sections"] = std::move(sections);
+		containers.push_back(std::move(value));
+	}
+
+	auto value = nlohmann::ordered_json::object();
+	value["major_faults"] = usage.major_faults;
+	value["minor_faults"] = usage.minor_faults;
+	value["peak_rss"] = usage.peak_rss;
+	value["containers"] = std::move(containers);
+	return value;
+}
+
+void hellextractor::residency::print(std::ostream& stream) const
+{
+	auto usage = residency::usage();
+
+	uint64_t mapped = 0, resident_at_load = 0, resident = 0;
+	for (auto const& container : _containers) {
+		stream << "    " << container.path.generic_string() << std::endl;
+		for (auto const& section : container.sections) {
+			stream << "        " << section.name << ": " << mebibytes(section.mapped) << " mapped, " << mebibytes(section.resident_at_load) << " resident at load, " << mebibytes(section.resident) << " resident now" << std::endl;
+			mapped += section.mapped;
+			resident_at_load += section.resident_at_load;
+			resident += section.resident;
+		}
+	}
+	stream << "    Mapped:   " << mebibytes(mapped) << std::endl;
+	stream << "    Resident: " << mebibytes(resident_at_load) << " at load, " << mebibytes(resident) << " now" << std::endl;
+	stream << "    Faults:   " << usage.major_faults << " major, " << usage.minor_faults << " minor" << std::endl;
+	stream << "    Peak RSS: " << mebibytes(usage.peak_rss) << std::endl;
+}
+
+hellextractor::residency::usage_t hellextractor::residency::usage()
+{
+#ifdef WIN32
+	PROCESS_MEMORY_COUNTERS counters = {};
+	counters.cb                      = sizeof(counters);
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+		return {};
+	}
+	return {0, counters.PageFaultCount, counters.PeakWorkingSetSize};
+#else
+	struct rusage usage = {};
+	if (getrusage(RUSAGE_SELF, &usage) != 0) {
+		return {};
+	}
+	// ru_maxrss is in kilobytes on Linux.
+	return {static_cast<uint64_t>(usage.ru_majflt), static_cast<uint64_t>(usage.ru_minflt), static_cast<uint64_t>(usage.ru_maxrss) * 1024};
+#endif
+}
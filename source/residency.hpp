@@ -0,0 +1,70 @@
+// Copyright 2024 Michael Fabian 'Xaymar' Dirks <info@xaymar.com>
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#pragma once
+#include <cinttypes>
+#include <cstddef>
+#include <filesystem>
+#include <ostream>
+#include <string_view>
+#include <vector>
+#include "stingray_data.hpp"
+
+#include <nlohmann/json.hpp>
+
+namespace hellextractor {
+	/** Page cache residency of mapped containers, and the faults and memory use of the process.
+	 *
+	 * Residency is sampled with mincore() once a container is loaded and again at the end, which shows how much of each
+	 * section was already cached and how much of it extraction pulled in.
+	 */
+	class residency {
+		public:
+		struct usage_t {
+			uint64_t major_faults;
+			uint64_t minor_faults; // On Windows, all page faults.
+			uint64_t peak_rss; // Bytes.
+		};
+
+		private:
+		struct section_t {
+			std::string_view   name;
+			mapped_file const* file;
+			uint64_t           mapped;
+			uint64_t           resident_at_load;
+			uint64_t           resident;
+		};
+
+		struct container_t {
+			std::filesystem::path  path;
+			std::vector<section_t> sections;
+		};
+
+		std::vector<container_t> _containers;
+
+		public:
+		~residency();
+		residency();
+
+		/** Track a container, which must stay loaded until the last sample. */
+		void add(stingray::data_110000F0 const& container);
+
+		/** Sample the residency of all tracked containers again. */
+		void sample();
+
+		nlohmann::ordered_json report() const;
+
+		void print(std::ostream& stream) const;
+
+		/** Faults and peak resident set size of the process so far. */
+		static usage_t usage();
+	};
+} // namespace hellextractor
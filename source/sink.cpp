@@ -0,0 +1,454 @@
+// Copyright 2024 Michael Fabian 'Xaymar' Dirks <info@xaymar.com>
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "sink.hpp"
+#include <algorithm>
+#include <functional>
+#include <iostream>
+#include <stdexcept>
+#include "archive.hpp"
+#include "string_printf.hpp"
+#include "zlib-ng.h"
+
+#ifdef WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+static constexpr size_t stream_buffer_size = 64 * 1024;
+
+/** Buffers small writes from std::ostream users and hands them to the sink in larger blocks. */
+class sink_buffer : public std::streambuf {
+	std::function<void(void const*, size_t)> _put;
+	std::vector<char>                        _buffer;
+
+	public:
+	sink_buffer(std::function<void(void const*, size_t)> put) : _put(put), _buffer(stream_buffer_size)
+	{
+		setp(_buffer.data(), _buffer.data() + _buffer.size());
+	}
+
+	protected:
+	int_type overflow(int_type ch) override
+	{
+		drain();
+		if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+			*pptr() = traits_type::to_char_type(ch);
+			pbump(1);
+		}
+		return traits_type::not_eof(ch);
+	}
+
+	std::streamsize xsputn(char_type const* data, std::streamsize size) override
+	{
+		// Large blocks skip the buffer entirely.
+		if (size >= static_cast<std::streamsize>(_buffer.size())) {
+			drain();
+			_put(data, static_cast<size_t>(size));
+			return size;
+		}
+		return std::streambuf::xsputn(data, size);
+	}
+
+	int sync() override
+	{
+		drain();
+		return 0;
+	}
+
+	private:
+	void drain()
+	{
+		if (pptr() > pbase()) {
+			_put(pbase(), static_cast<size_t>(pptr() - pbase()));
+		}
+		setp(_buffer.data(), _buffer.data() + _buffer.size());
+	}
+};
+
+#ifndef WIN32
+/** Write all of the given ranges to a descriptor, retrying partial writes. */
+static void write_all(int fd, struct iovec* iov, size_t count, char const* name)
+{
+	size_t first = 0;
+	while (first < count) {
+		ssize_t written = writev(fd, iov + first, static_cast<int>(std::min<size_t>(count - first, IOV_MAX)));
+		if (written < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			throw std::runtime_error(string_printf("Failed to write '%s'.", name));
+		}
+
+		// Skip over everything that was fully written, and adjust the partially written range.
+		size_t done = static_cast<size_t>(written);
+		while ((first < count) && (done >= iov[first].iov_len)) {
+			done -= iov[first].iov_len;
+			first++;
+		}
+		if (first < count) {
+			iov[first].iov_base = reinterpret_cast<uint8_t*>(iov[first].iov_base) + done;
+			iov[first].iov_len -= done;
+		}
+	}
+}
+
+static void write_all(int fd, stingray::sections_t const& sections, char const* name)
+{
+	struct iovec iov[stingray::sections_t::capacity];
+	size_t       count = 0;
+	for (auto const& section : sections) {
+		if (section.second > 0) {
+			iov[count].iov_base = const_cast<void*>(section.first);
+			iov[count].iov_len  = section.second;
+			count++;
+		}
+	}
+	write_all(fd, iov, count, name);
+}
+#endif
+
+hellextractor::sink::~sink() {}
+
+hellextractor::sink::sink() {}
+
+void hellextractor::sink::reserve(size_t size)
+{
+	allocate(size);
+}
+
+void hellextractor::sink::write(void const* data, size_t size)
+{
+	flush();
+	if (size > 0) {
+		put(data, size);
+	}
+}
+
+void hellextractor::sink::write(stingray::sections_t const& sections)
+{
+	flush();
+	put(sections);
+}
+
+std::ostream& hellextractor::sink::stream()
+{
+	if (!_stream) {
+		_buffer = std::make_unique<sink_buffer>([this](void const* data, size_t size) { put(data, size); });
+		_stream = std::make_unique<std::ostream>(_buffer.get());
+	}
+	return *_stream;
+}
+
+void hellextractor::sink::close()
+{
+	flush();
+	finish();
+}
+
+void hellextractor::sink::allocate(size_t /*size*/) {}
+
+void hellextractor::sink::put(stingray::sections_t const& sections)
+{
+	for (auto const& section : sections) {
+		if (section.second > 0) {
+			put(section.first, section.second);
+		}
+	}
+}
+
+void hellextractor::sink::finish() {}
+
+void hellextractor::sink::flush()
+{
+	if (_stream) {
+		_stream->flush();
+		if (_stream->bad()) {
+			throw std::runtime_error("Failed to write to sink.");
+		}
+	}
+}
+
+hellextractor::file_sink::~file_sink()
+{
+	if (_file) {
+		_file.reset();
+		std::error_code ec;
+		std::filesystem::remove(_temp_path, ec);
+	}
+}
+
+hellextractor::file_sink::file_sink(std::filesystem::path path) : _path(path), _temp_path(std::filesystem::path(path).concat(".tmp"))
+{
+#ifdef WIN32
+	_file = std::shared_ptr<void>(CreateFileW(_temp_path.c_str(), GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL), [](void* p) {
+		if (p != INVALID_HANDLE_VALUE) {
+			CloseHandle(p);
+		}
+	});
+	if (_file.get() == INVALID_HANDLE_VALUE) {
+		throw std::runtime_error(string_printf("Failed to open '%s' for writing.", path.generic_string().c_str()));
+	}
+#else
+	int fd = open(_temp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (fd == -1) {
+		throw std::runtime_error(string_printf("Failed to open '%s' for writing.", path.generic_string().c_str()));
+	}
+	_file = std::shared_ptr<void>(reinterpret_cast<void*>(static_cast<intptr_t>(fd)), [](void* p) { ::close(static_cast<int>(reinterpret_cast<intptr_t>(p))); });
+#endif
+}
+
+void hellextractor::file_sink::allocate(size_t size)
+{
+	if (size == 0) {
+		return;
+	}
+
+	// Best effort, not every file system supports it. The size is kept, so a file that is cut short never looks complete.
+#ifdef WIN32
+	FILE_ALLOCATION_INFO info    = {};
+	info.AllocationSize.QuadPart = static_cast<LONGLONG>(size);
+	SetFileInformationByHandle(_file.get(), FileAllocationInfo, &info, sizeof(info));
+#elif defined(__linux__)
+	fallocate(static_cast<int>(reinterpret_cast<intptr_t>(_file.get())), FALLOC_FL_KEEP_SIZE, 0, static_cast<off_t>(size));
+#endif
+}
+
+void hellextractor::file_sink::put(void const* data, size_t size)
+{
+#ifdef WIN32
+	auto ptr = reinterpret_cast<uint8_t const*>(data);
+	while (size > 0) {
+		DWORD chunk   = static_cast<DWORD>(std::min<size_t>(size, 1ull << 30));
+		DWORD written = 0;
+		if (!WriteFile(_file.get(), ptr, chunk, &written, NULL) || (written == 0)) {
+			throw std::runtime_error(string_printf("Failed to write '%s'.", _path.generic_string().c_str()));
+		}
+		ptr += written;
+		size -= written;
+	}
+#else
+	struct iovec iov = {const_cast<void*>(data), size};
+	write_all(static_cast<int>(reinterpret_cast<intptr_t>(_file.get())), &iov, 1, _path.generic_string().c_str());
+#endif
+}
+
+void hellextractor::file_sink::put(stingray::sections_t const& sections)
+{
+#ifdef WIN32
+	// WriteFileGather requires unbuffered, page aligned I/O, which the mapped containers can't provide. So this does
+	// one WriteFile per section, which still avoids the stream buffer copy.
+	sink::put(sections);
+#else
+	write_all(static_cast<int>(reinterpret_cast<intptr_t>(_file.get())), sections, _path.generic_string().c_str());
+#endif
+}
+
+void hellextractor::file_sink::finish()
+{
+	_file.reset();
+	std::filesystem::rename(_temp_path, _path);
+}
+
+hellextractor::fd_sink::~fd_sink()
+{
+	if (_owned && (_fd != -1)) {
+#ifdef WIN32
+		_close(_fd);
+#else
+		::close(_fd);
+#endif
+	}
+}
+
+hellextractor::fd_sink::fd_sink(int fd, bool owned) : _fd(fd), _owned(owned) {}
+
+void hellextractor::fd_sink::put(void const* data, size_t size)
+{
+#ifdef WIN32
+	auto ptr = reinterpret_cast<uint8_t const*>(data);
+	while (size > 0) {
+		int written = _write(_fd, ptr, static_cast<unsigned int>(std::min<size_t>(size, 1ull << 30)));
+		if (written <= 0) {
+			throw std::runtime_error(string_printf("Failed to write to descriptor %d.", _fd));
+		}
+		ptr += written;
+		size -= written;
+	}
+#else
+	struct iovec iov = {const_cast<void*>(data), size};
+	write_all(_fd, &iov, 1, string_printf("fd:%d", _fd).c_str());
+#endif
+}
+
+void hellextractor::fd_sink::put(stingray::sections_t const& sections)
+{
+#ifdef WIN32
+	sink::put(sections);
+#else
+	write_all(_fd, sections, string_printf("fd:%d", _fd).c_str());
+#endif
+}
+
+void hellextractor::fd_sink::finish()
+{
+	if (_owned && (_fd != -1)) {
+#ifdef WIN32
+		_close(_fd);
+#else
+		::close(_fd);
+#endif
+		_fd = -1;
+	}
+}
+
+hellextractor::stdout_sink::~stdout_sink() {}
+
+hellextractor::stdout_sink::stdout_sink() : fd_sink(1, false)
+{
+	// Anything still buffered by std::cout has to come out first.
+	std::cout.flush();
+#ifdef WIN32
+	_setmode(1, _O_BINARY);
+#endif
+}
+
+hellextractor::stream_sink::~stream_sink() {}
+
+hellextractor::stream_sink::stream_sink(std::ostream& target) : _target(target) {}
+
+void hellextractor::stream_sink::put(void const* data, size_t size)
+{
+	_target.write(reinterpret_cast<char const*>(data), static_cast<std::streamsize>(size));
+}
+
+void hellextractor::stream_sink::finish()
+{
+	_target.flush();
+}
+
+hellextractor::memory_sink::~memory_sink() {}
+
+hellextractor::memory_sink::memory_sink() {}
+
+std::string const& hellextractor::memory_sink::data() const
+{
+	return _data;
+}
+
+std::string hellextractor::memory_sink::take()
+{
+	return std::move(_data);
+}
+
+void hellextractor::memory_sink::allocate(size_t size)
+{
+	_data.reserve(size);
+}
+
+void hellextractor::memory_sink::put(void const* data, size_t size)
+{
+	_data.append(reinterpret_cast<char const*>(data), size);
+}
+
+hellextractor::archive_sink::~archive_sink() {}
+
+hellextractor::archive_sink::archive_sink(hellextractor::archive& archive, std::string name, int32_t level, std::vector<std::pair<void const*, size_t>> const& persistent) : _archive(archive), _name(name), _level(level), _persistent(persistent) {}
+
+void hellextractor::archive_sink::put(void const* data, size_t size)
+{
+	// Copied data is marked by a null section, which the archive points at its copy once it owns it.
+	if (_sections.empty() || (_sections.back().first != nullptr)) {
+		_sections.emplace_back(nullptr, 0);
+	}
+	_sections.back().second += size;
+	_data.append(reinterpret_cast<char const*>(data), size);
+}
+
+void hellextractor::archive_sink::put(stingray::sections_t const& sections)
+{
+	for (auto const& section : sections) {
+		if (section.second == 0) {
+			continue;
+		}
+		if (persistent(section.first, section.second)) {
+			_sections.emplace_back(section.first, section.second);
+		} else {
+			put(section.first, section.second);
+		}
+	}
+}
+
+void hellextractor::archive_sink::finish()
+{
+	_archive.add(std::move(_name), std::move(_data), std::move(_sections), _level);
+}
+
+bool hellextractor::archive_sink::persistent(void const* data, size_t size) const
+{
+	auto address = reinterpret_cast<uintptr_t>(data);
+	auto range   = std::upper_bound(_persistent.begin(), _persistent.end(), address, [](uintptr_t address, std::pair<void const*, size_t> const& range) { return address < reinterpret_cast<uintptr_t>(range.first); });
+	if (range == _persistent.begin()) {
+		return false;
+	}
+	--range;
+
+	auto begin = reinterpret_cast<uintptr_t>(range->first);
+	return (size <= range->second) && ((address - begin) <= (range->second - size));
+}
+
+hellextractor::discard_sink::~discard_sink() {}
+
+hellextractor::discard_sink::discard_sink() : _size(0) {}
+
+uint64_t hellextractor::discard_sink::size() const
+{
+	return _size;
+}
+
+void hellextractor::discard_sink::put(void const* /*data*/, size_t size)
+{
+	_size += size;
+}
+
+hellextractor::hash_sink::~hash_sink() {}
+
+hellextractor::hash_sink::hash_sink() : _size(0), _crc(0) {}
+
+uint64_t hellextractor::hash_sink::size() const
+{
+	return _size;
+}
+
+uint32_t hellextractor::hash_sink::crc() const
+{
+	return _crc;
+}
+
+void hellextractor::hash_sink::put(void const* data, size_t size)
+{
+	auto ptr = reinterpret_cast<uint8_t const*>(data);
+	_size += size;
+	while (size > 0) {
+		uint32_t chunk = static_cast<uint32_t>(std::min<size_t>(size, 1u << 30));
+		_crc           = zng_crc32(_crc, ptr, chunk);
+		ptr += chunk;
+		size -= chunk;
+	}
+}
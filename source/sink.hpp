@@ -0,0 +1,209 @@
+// Copyright 2024 Michael Fabian 'Xaymar' Dirks <info@xaymar.com>
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#pragma once
+#include <cinttypes>
+#include <cstddef>
+#include <filesystem>
+#include <memory>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <vector>
+#include "stingray.hpp"
+
+namespace hellextractor {
+	class archive;
+
+	/** Destination for converted outputs.
+	 *
+	 * Converters write plain blocks, or whole ranges of mapped container data which sinks may reference instead of
+	 * copying. Encoders built on std::ostream can use stream(), which is buffered and flushed before any direct write.
+	 */
+	class sink {
+		std::unique_ptr<std::streambuf> _buffer;
+		std::unique_ptr<std::ostream>   _stream;
+
+		public:
+		virtual ~sink();
+		sink();
+
+		/** Announce the final size before writing anything, if it is known. */
+		void reserve(size_t size);
+
+		void write(void const* data, size_t size);
+
+		/** Write ranges that stay valid until the sink is closed, such as mapped container data. */
+		void write(stingray::sections_t const& sections);
+
+		/** Stream that writes into this sink. */
+		std::ostream& stream();
+
+		/** Flush everything that is still buffered. Nothing may be written afterwards. */
+		void close();
+
+		protected:
+		virtual void allocate(size_t size);
+
+		virtual void put(void const* data, size_t size) = 0;
+
+		virtual void put(stingray::sections_t const& sections);
+
+		virtual void finish();
+
+		private:
+		void flush();
+	};
+
+	/** Writes to a new file, replacing any existing one.
+	 *
+	 * Everything goes to a temporary file next to it first, which only takes its place once the sink is closed. A sink
+	 * that is destroyed before that removes the temporary file again, so a cut short output is never left behind.
+	 */
+	class file_sink : public sink {
+		std::filesystem::path _path;
+		std::filesystem::path _temp_path;
+		std::shared_ptr<void> _file;
+
+		public:
+		virtual ~file_sink();
+		file_sink(std::filesystem::path path);
+
+		protected:
+		void allocate(size_t size) override;
+
+		void put(void const* data, size_t size) override;
+
+		void put(stingray::sections_t const& sections) override;
+
+		void finish() override;
+	};
+
+	/** Writes to an already open file descriptor, such as a pipe or socket. */
+	class fd_sink : public sink {
+		int  _fd;
+		bool _owned;
+
+		public:
+		virtual ~fd_sink();
+
+		/** @param owned Close the descriptor when the sink is closed. */
+		fd_sink(int fd, bool owned);
+
+		protected:
+		void put(void const* data, size_t size) override;
+
+		void put(stingray::sections_t const& sections) override;
+
+		void finish() override;
+	};
+
+	/** Writes to the standard output in binary mode. */
+	class stdout_sink : public fd_sink {
+		public:
+		virtual ~stdout_sink();
+		stdout_sink();
+	};
+
+	/** Writes to any std::ostream. */
+	class stream_sink : public sink {
+		std::ostream& _target;
+
+		public:
+		virtual ~stream_sink();
+		stream_sink(std::ostream& target);
+
+		protected:
+		void put(void const* data, size_t size) override;
+
+		void finish() override;
+	};
+
+	/** Collects everything in memory. */
+	class memory_sink : public sink {
+		std::string _data;
+
+		public:
+		virtual ~memory_sink();
+		memory_sink();
+
+		std::string const& data() const;
+
+		/** Move the collected data out of the sink. */
+		std::string take();
+
+		protected:
+		void allocate(size_t size) override;
+
+		void put(void const* data, size_t size) override;
+	};
+
+	/** Adds a single entry to an archive when closed.
+	 *
+	 * The archive compresses entries long after the sink is closed, so only ranges inside the given persistent ranges
+	 * are referenced by the entry. Everything else, such as headers built by converters, is copied.
+	 */
+	class archive_sink : public sink {
+		hellextractor::archive&                            _archive;
+		std::string                                        _name;
+		int32_t                                            _level;
+		std::vector<std::pair<void const*, size_t>> const& _persistent;
+		std::string                                        _data;
+		std::vector<std::pair<void const*, size_t>>        _sections;
+
+		public:
+		virtual ~archive_sink();
+
+		/** @param persistent Ranges sorted by address which stay valid until the archive is closed, such as the mapped containers. */
+		archive_sink(hellextractor::archive& archive, std::string name, int32_t level, std::vector<std::pair<void const*, size_t>> const& persistent);
+
+		protected:
+		void put(void const* data, size_t size) override;
+
+		void put(stingray::sections_t const& sections) override;
+
+		void finish() override;
+
+		private:
+		bool persistent(void const* data, size_t size) const;
+	};
+
+	/** Only counts the bytes written. */
+	class discard_sink : public sink {
+		uint64_t _size;
+
+		public:
+		virtual ~discard_sink();
+		discard_sink();
+
+		uint64_t size() const;
+
+		protected:
+		void put(void const* data, size_t size) override;
+	};
+
+	/** Only computes the CRC-32 and size of everything written. */
+	class hash_sink : public sink {
+		uint64_t _size;
+		uint32_t _crc;
+
+		public:
+		virtual ~hash_sink();
+		hash_sink();
+
+		uint64_t size() const;
+
+		uint32_t crc() const;
+
+		protected:
+		void put(void const* data, size_t size) override;
+	};
+} // namespace hellextractor
@@ -9,8 +9,12 @@
 // THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #pragma once
+#include <array>
 #include <cinttypes>
 #include <cstddef>
+#include <initializer_list>
+#include <stdexcept>
+#include <utility>
 
 namespace stingray {
 	class thin_hash_t;
@@ -19,6 +23,8 @@ namespace stingray {
 		uint64_t _value;
 
 		public:
+		constexpr hash_t() : _value(0){};
+
 		constexpr hash_t(uint64_t value) : _value(value){};
 
 		constexpr hash_t(stingray::hash_t const& other) : _value(other._value){};
@@ -77,4 +83,75 @@ namespace stingray {
 		operator uint32_t() const noexcept;
 	};
 
+	/** Fixed capacity list of memory ranges that make up a single output, in order.
+	 *
+	 * Ranges usually point directly into the mapped containers, so this never allocates.
+	 */
+	class sections_t {
+		public:
+		typedef std::pair<void const*, size_t> value_type;
+		static constexpr size_t                capacity = 32;
+
+		private:
+		std::array<value_type, capacity> _items;
+		size_t                           _count;
+
+		public:
+		sections_t() : _items(), _count(0) {}
+
+		sections_t(std::initializer_list<value_type> items) : _items(), _count(0)
+		{
+			for (auto const& item : items) {
+				push_back(item.first, item.second);
+			}
+		}
+
+		void push_back(void const* data, size_t size)
+		{
+			if (_count >= capacity) {
+				throw std::length_error("sections_t is full");
+			}
+			_items[_count++] = {data, size};
+		}
+
+		size_t size() const
+		{
+			return _count;
+		}
+
+		bool empty() const
+		{
+			return _count == 0;
+		}
+
+		/** Sum of the size of all ranges. */
+		size_t total() const
+		{
+			size_t total = 0;
+			for (size_t idx = 0; idx < _count; idx++) {
+				total += _items[idx].second;
+			}
+			return total;
+		}
+
+		value_type const& operator[](size_t idx) const
+		{
+			return _items[idx];
+		}
+
+		value_type& back()
+		{
+			return _items[_count - 1];
+		}
+
+		value_type const* begin() const
+		{
+			return _items.data();
+		}
+
+		value_type const* end() const
+		{
+			return _items.data() + _count;
+		}
+	};
 } // namespace stingray
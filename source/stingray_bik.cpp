@@ -21,17 +21,17 @@ stingray::bik::bik(stingray::data_110000F0::meta_t meta) : _meta(meta)
 	_data_sz        = _meta.stream_size ? _meta.stream_size : _meta.gpu_size;
 }
 
-size_t stingray::bik::size()
+size_t stingray::bik::size() const
 {
 	return _data_header_sz + _data_sz;
 }
 
-std::string stingray::bik::extension()
+std::string_view stingray::bik::extension() const
 {
 	return "bik";
 }
 
-std::list<std::pair<void const*, size_t>> stingray::bik::sections()
+stingray::sections_t stingray::bik::sections() const
 {
 	return {
 		{_data_header, _data_header_sz},
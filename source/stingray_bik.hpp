@@ -11,7 +11,7 @@
 #pragma once
 #include <cinttypes>
 #include <cstddef>
-#include <list>
+#include <string_view>
 #include "stingray_data.hpp"
 
 namespace stingray {
@@ -36,10 +36,10 @@ namespace stingray {
 		~bik();
 		bik(stingray::data_110000F0::meta_t meta);
 
-		size_t size();
+		size_t size() const;
 
-		std::string extension();
+		std::string_view extension() const;
 
-		std::list<std::pair<void const*, size_t>> sections();
+		stingray::sections_t sections() const;
 	};
 } // namespace stingray
@@ -0,0 +1,252 @@
+// Copyright 2024 Michael Fabian 'Xaymar' Dirks <info@xaymar.com>
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "stingray_compressed_stream.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <exception>
+#include <stdexcept>
+#include <thread>
+#include "zlib-ng.h"
+
+static constexpr size_t header_size = 12;
+
+static uint32_t read32(uint8_t const* ptr)
+{
+	uint32_t value;
+	memcpy(&value, ptr, sizeof(value));
+	return value;
+}
+
+stingray::compressed_stream::~compressed_stream() {}
+
+stingray::compressed_stream::compressed_stream(uint8_t const* data, size_t size, size_t threads, size_t cache) : _data(data), _size(size), _chunk_size(0), _last_size(0), _threads(std::max<size_t>(threads, 1)), _cache_limit(std::max<size_t>(cache, 1))
+{
+	if (!detect(data, size)) {
+		throw std::runtime_error("not a chunked zlib stream");
+	}
+
+	for (size_t offset = header_size; offset < size;) {
+		if ((size - offset) < sizeof(uint32_t)) {
+			throw std::overflow_error("offset >= size");
+		}
+		size_t length = read32(data + offset);
+		offset += sizeof(uint32_t);
+		if (length > (size - offset)) {
+			throw std::overflow_error("offset+size > size");
+		}
+		if ((length < 6) || (data[offset + 1] & 0x20)) { // Preset dictionaries are never used.
+			throw std::runtime_error("invalid zlib chunk");
+		}
+		_chunks.push_back({data + offset, length});
+		offset += length;
+	}
+
+	// Sizes aren't stored anywhere, so learn them from the first and last chunk.
+	auto first = decompress(0);
+	_chunk_size = first->size();
+	store(0, first);
+	if (_chunks.size() > 1) {
+		auto last  = decompress(_chunks.size() - 1);
+		_last_size = last->size();
+		store(_chunks.size() - 1, last);
+	} else {
+		_last_size = _chunk_size;
+	}
+	if ((_chunk_size == 0) || (_last_size > _chunk_size)) {
+		throw std::runtime_error("chunk size mismatch");
+	}
+}
+
+size_t stingray::compressed_stream::size() const
+{
+	return (_chunks.size() - 1) * _chunk_size + _last_size;
+}
+
+size_t stingray::compressed_stream::chunks() const
+{
+	return _chunks.size();
+}
+
+size_t stingray::compressed_stream::chunk_size() const
+{
+	return _chunk_size;
+}
+
+void stingray::compressed_stream::read(size_t offset, void* out, size_t size)
+{
+	if (offset > this->size()) {
+		throw std::overflow_error("offset >= size");
+	} else if (size > (this->size() - offset)) {
+		throw std::overflow_error("offset+size > size");
+	} else if (size == 0) {
+		return;
+	}
+
+	// Every chunk is copied out as soon as it is available, so only the cache holds on to them afterwards.
+	size_t first = offset / _chunk_size;
+	size_t count = (offset + size - 1) / _chunk_size - first + 1;
+	auto   copy  = [this, offset, out, size](size_t idx, block_t const& block) {
+		size_t begin = std::max(idx * _chunk_size, offset);
+		size_t end   = std::min(idx * _chunk_size + block->size(), offset + size);
+		memcpy(reinterpret_cast<uint8_t*>(out) + (begin - offset), block->data() + (begin - idx * _chunk_size), end - begin);
+	};
+
+	std::vector<size_t> missing;
+	for (size_t idx = first; idx < (first + count); idx++) {
+		if (auto block = cached(idx); block) {
+			copy(idx, block);
+		} else {
+			missing.push_back(idx);
+		}
+	}
+	if (missing.empty()) {
+		return;
+	}
+
+	std::atomic_size_t next = 0;
+	std::mutex         lock;
+	std::exception_ptr error;
+
+	auto work = [&]() {
+		try {
+			for (size_t idx = next++; idx < missing.size(); idx = next++) {
+				auto block = decompress(missing[idx]);
+				copy(missing[idx], block);
+				store(missing[idx], std::move(block));
+			}
+		} catch (...) {
+			std::lock_guard<std::mutex> lg(lock);
+			if (!error) {
+				error = std::current_exception();
+			}
+			next = missing.size();
+		}
+	};
+
+	std::vector<std::thread> workers;
+	for (size_t idx = 1, edx = std::min(_threads, missing.size()); idx < edx; idx++) {
+		workers.emplace_back(work);
+	}
+	work();
+	for (auto& worker : workers) {
+		worker.join();
+	}
+	if (error) {
+		std::rethrow_exception(error);
+	}
+}
+
+stingray::compressed_stream::block_t stingray::compressed_stream::chunk(size_t idx)
+{
+	if (idx >= _chunks.size()) {
+		throw std::out_of_range("idx >= edx");
+	}
+
+	if (auto block = cached(idx); block) {
+		return block;
+	}
+	auto block = decompress(idx);
+	store(idx, block);
+	return block;
+}
+
+bool stingray::compressed_stream::detect(uint8_t const* data, size_t size)
+{
+	if (size < (header_size + sizeof(uint32_t) + 6)) {
+		return false;
+	}
+
+	// A single zlib header is easily matched by chance, so every chunk has to have one, and the chain of sizes has to
+	// end exactly at the end of the file.
+	size_t offset = header_size;
+	while (offset < size) {
+		if ((size - offset) < sizeof(uint32_t)) {
+			return false;
+		}
+		size_t length = read32(data + offset);
+		offset += sizeof(uint32_t);
+		if ((length < 6) || (length > (size - offset))) {
+			return false;
+		}
+		uint8_t cmf = data[offset];
+		uint8_t flg = data[offset + 1];
+		if (((cmf & 0x0F) != 8) || ((cmf >> 4) > 7) || ((((cmf << 8) | flg) % 31) != 0) || (flg & 0x20)) {
+			return false;
+		}
+		offset += length;
+	}
+	return offset == size;
+}
+
+stingray::compressed_stream::block_t stingray::compressed_stream::decompress(size_t idx) const
+{
+	auto const& chunk    = _chunks[idx];
+	size_t      expected = ((idx + 1) == _chunks.size()) ? _last_size : _chunk_size;
+	auto        block    = std::make_shared<std::vector<uint8_t>>(expected ? expected : std::max<size_t>(chunk.size * 4, 0x10000));
+
+	zng_stream strm = {};
+	if (zng_inflateInit(&strm) != Z_OK) {
+		throw std::runtime_error("zng_inflateInit failed");
+	}
+	std::shared_ptr<zng_stream> guard(&strm, [](zng_stream* p) { zng_inflateEnd(p); });
+
+	strm.next_in  = chunk.data;
+	strm.avail_in = static_cast<uint32_t>(chunk.size);
+	size_t written = 0;
+	while (true) {
+		strm.next_out  = block->data() + written;
+		strm.avail_out = static_cast<uint32_t>(block->size() - written);
+		int result     = zng_inflate(&strm, Z_FINISH);
+		written        = block->size() - strm.avail_out;
+		if (result == Z_STREAM_END) {
+			break;
+		} else if (((result == Z_OK) || (result == Z_BUF_ERROR)) && (strm.avail_out == 0) && (expected == 0)) {
+			block->resize(block->size() * 2);
+		} else if (((result == Z_OK) || (result == Z_BUF_ERROR)) && (strm.avail_out == 0)) {
+			throw std::runtime_error("chunk size mismatch");
+		} else {
+			throw std::runtime_error("zng_inflate failed");
+		}
+	}
+	if (expected && (written != expected)) {
+		throw std::runtime_error("chunk size mismatch");
+	}
+	block->resize(written);
+	return block;
+}
+
+stingray::compressed_stream::block_t stingray::compressed_stream::cached(size_t idx)
+{
+	std::lock_guard<std::mutex> lg(_lock);
+	for (auto kv = _cache.begin(); kv != _cache.end(); kv++) {
+		if (kv->first == idx) {
+			_cache.splice(_cache.begin(), _cache, kv);
+			return kv->second;
+		}
+	}
+	return nullptr;
+}
+
+void stingray::compressed_stream::store(size_t idx, block_t block)
+{
+	std::lock_guard<std::mutex> lg(_lock);
+	for (auto const& kv : _cache) {
+		if (kv.first == idx) {
+			return;
+		}
+	}
+	_cache.emplace_front(idx, std::move(block));
+	while (_cache.size() > _cache_limit) {
+		_cache.pop_back();
+	}
+}
@@ -0,0 +1,80 @@
+// Copyright 2024 Michael Fabian 'Xaymar' Dirks <info@xaymar.com>
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#pragma once
+#include <cinttypes>
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace stingray {
+	/** Chunked zlib stream, as used by older .stream containers (see extra/010 Editor/stingray_stream.bt).
+	 *
+	 * The chunk boundaries are indexed once, after which any range of the decompressed stream can be read by inflating
+	 * only the chunks that cover it, independently of each other and across threads. Every chunk but the last one is
+	 * expected to decompress to the same size, which is checked as chunks are inflated. Recently used chunks are kept
+	 * in a small cache, so neighbouring reads don't inflate the same chunk twice.
+	 */
+	class compressed_stream {
+		// uint32_t magic_number; // Big Endian
+		// uint32_t __unk00;
+		// uint32_t __unk01;
+		// struct { uint32_t size; char zlib[size]; } chunks[];
+
+		struct chunk_t {
+			uint8_t const* data;
+			size_t         size;
+		};
+
+		typedef std::shared_ptr<std::vector<uint8_t> const> block_t;
+
+		uint8_t const*       _data;
+		size_t               _size;
+		std::vector<chunk_t> _chunks;
+		size_t               _chunk_size;
+		size_t               _last_size;
+		size_t               _threads;
+
+		std::mutex                            _lock;
+		std::list<std::pair<size_t, block_t>> _cache;
+		size_t                                _cache_limit;
+
+		public:
+		~compressed_stream();
+		compressed_stream(uint8_t const* data, size_t size, size_t threads, size_t cache = 64);
+
+		/** Size of the decompressed stream. */
+		size_t size() const;
+
+		size_t chunks() const;
+
+		/** Decompressed size of every chunk but the last one. */
+		size_t chunk_size() const;
+
+		/** Copy a range of the decompressed stream into 'out', inflating all missing chunks in parallel. */
+		void read(size_t offset, void* out, size_t size);
+
+		/** Decompressed contents of a single chunk. */
+		block_t chunk(size_t idx);
+
+		/** Check whether the data is a chunked zlib stream, by walking the sizes and zlib headers of all chunks. */
+		static bool detect(uint8_t const* data, size_t size);
+
+		private:
+		block_t decompress(size_t idx) const;
+
+		block_t cached(size_t idx);
+
+		void store(size_t idx, block_t block);
+	};
+} // namespace stingray
@@ -9,31 +9,126 @@
 // THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "stingray_data.hpp"
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include "stingray_compressed_stream.hpp"
+#include "string_printf.hpp"
 
-stingray::data_110000F0::data_110000F0(std::filesystem::path path)
+static constexpr uint32_t magic_number = 0xF0000011;
+
+stingray::data_110000F0::data_110000F0(std::filesystem::path path, size_t threads)
 {
+	// Sizes come from the mappings, so every file is only looked up once.
+	std::error_code ec;
 	_main_path = std::filesystem::absolute(path).replace_extension();
-	_main_size = std::filesystem::file_size(_main_path);
 	_main      = {_main_path};
+	_main_size = _main.size();
 
-	_stream_path = std::filesystem::absolute(path).replace_extension("stream");
+	_stream_path = std::filesystem::path(_main_path).replace_extension("stream");
+	_stream_ptr  = nullptr;
 	_stream_size = 0;
-	if (std::filesystem::exists(_stream_path)) {
-		_stream_size = std::filesystem::file_size(_stream_path);
+	if (std::filesystem::exists(_stream_path, ec)) {
 		_stream      = {_stream_path};
-	}
-
-	_gpu_path = std::filesystem::absolute(path).replace_extension("gpu_resources");
+		_stream_size = _stream->size();
+		_stream_ptr  = &(_stream.value());
+
+		// Older containers store the stream as independent zlib chunks, of which only the ones a file covers are inflated.
+		if (stingray::compressed_stream::detect(_stream_ptr, _stream_size)) {
+			try {
+				_stream_chunked = std::make_shared<stingray::compressed_stream>(_stream_ptr, _stream_size, threads);
+				_stream_ptr     = nullptr;
+				_stream_size    = _stream_chunked->size();
+			} catch (std::exception const& ex) {
+				std::cerr << string_printf("Warning: '%s' looks like a chunked zlib stream, but can't be read as one (%s). Using it as it is.", _stream_path.generic_string().c_str(), ex.what()) << std::endl;
+				_stream_chunked.reset();
+			}
+		}
+	}
+
+	_gpu_path = std::filesystem::path(_main_path).replace_extension("gpu_resources");
+	_gpu_ptr  = nullptr;
 	_gpu_size = 0;
-	if (std::filesystem::exists(_gpu_path)) {
-		_gpu_size = std::filesystem::file_size(_gpu_path);
+	if (std::filesystem::exists(_gpu_path, ec)) {
 		_gpu      = {_gpu_path};
+		_gpu_ptr  = &(_gpu.value());
+		_gpu_size = _gpu->size();
 	}
 
-	_ptr      = reinterpret_cast<decltype(_ptr)>(&_main);
+	if (_main_size < sizeof(header_t)) {
+		throw std::overflow_error("sizeof(header_t) > size");
+	}
+	_ptr = reinterpret_cast<decltype(_ptr)>(&_main);
+	if (_ptr->magic_number != magic_number) {
+		throw std::runtime_error("invalid magic number");
+	}
+	if ((sizeof(header_t) + sizeof(type_t) * uint64_t(_ptr->types) + sizeof(file_t) * uint64_t(_ptr->files)) > _main_size) {
+		throw std::overflow_error("types+files > size");
+	}
 	_ptr_type = reinterpret_cast<decltype(_ptr_type)>(&_main + sizeof(header_t));
 	_ptr_file = reinterpret_cast<decltype(_ptr_file)>(&_main + sizeof(header_t) + sizeof(type_t) * _ptr->types);
 	_ptr_data = reinterpret_cast<decltype(_ptr_data)>(&_main + sizeof(header_t) + sizeof(type_t) * _ptr->types + sizeof(file_t) * _ptr->files);
+
+	validate();
+}
+
+void stingray::data_110000F0::validate() const
+{
+	// Sections that don't exist are not an error, the accessors treat them as empty.
+	auto check = [](size_t idx, char const* section, uint64_t offset, uint64_t size, uint64_t limit) {
+		if ((size > 0) && ((offset >= limit) || ((offset + size) > limit))) {
+			throw std::overflow_error("file " + std::to_string(idx) + ": " + section + " offset+size > size");
+		}
+	};
+
+	for (size_t idx = 0, edx = files(); idx < edx; idx++) {
+		auto const& entry = _ptr_file[idx];
+		check(idx, "main", entry.offset, entry.size, _main_size);
+		if (_stream.has_value()) {
+			check(idx, "stream", entry.stream_offset, entry.stream_size, _stream_size);
+		}
+		if (_gpu.has_value()) {
+			check(idx, "gpu", entry.gpu_offset, entry.gpu_size, _gpu_size);
+		}
+	}
+}
+
+void stingray::data_110000F0::inflate_stream(meta_t& meta) const
+{
+	// Files that sit inside a single chunk are served straight from the chunk cache, everything else gets its own copy.
+	size_t offset = meta.file.stream_offset;
+	size_t first  = offset / _stream_chunked->chunk_size();
+	size_t last   = (offset + meta.stream_size - 1) / _stream_chunked->chunk_size();
+	if (first == last) {
+		auto block        = _stream_chunked->chunk(first);
+		meta.stream       = block->data() + (offset - first * _stream_chunked->chunk_size());
+		meta.stream_owner = std::move(block);
+	} else {
+		auto buffer = std::make_shared<std::vector<uint8_t>>(meta.stream_size);
+		_stream_chunked->read(offset, buffer->data(), buffer->size());
+		meta.stream       = buffer->data();
+		meta.stream_owner = std::move(buffer);
+	}
+}
+
+std::filesystem::path const& stingray::data_110000F0::path() const
+{
+	return _main_path;
+}
+
+std::vector<std::pair<std::string_view, mapped_file const*>> stingray::data_110000F0::mappings() const
+{
+	// mapped_file overloads operator&, so the addresses have to be taken with std::addressof.
+	std::vector<std::pair<std::string_view, mapped_file const*>> mappings{{"main", std::addressof(_main)}};
+	if (_stream.has_value()) {
+		mappings.emplace_back("stream", std::addressof(_stream.value()));
+	}
+	if (_gpu.has_value()) {
+		mappings.emplace_back("gpu_resources", std::addressof(_gpu.value()));
+	}
+	return mappings;
 }
 
 size_t stingray::data_110000F0::types() const
@@ -55,13 +150,15 @@ size_t stingray::data_110000F0::files() const
 	return _ptr->files;
 }
 
+// Every file was validated when the container was loaded, so only the index is checked from here on.
+
 stingray::data_110000F0::file_t const& stingray::data_110000F0::file(size_t idx) const
 {
 	if (idx >= files()) {
 		throw std::out_of_range("idx >= edx");
 	}
 
-	return _ptr_file[idx];
+	return file_unchecked(idx);
 }
 
 stingray::data_110000F0::meta_t stingray::data_110000F0::meta(size_t idx) const
@@ -70,132 +167,50 @@ stingray::data_110000F0::meta_t stingray::data_110000F0::meta(size_t idx) const
 		throw std::out_of_range("idx >= edx");
 	}
 
-	return meta_t{
-		.file        = file(idx),
-		.main_size   = main_size(idx),
-		.main        = main_data(idx),
-		.stream_size = stream_size(idx),
-		.stream      = stream_data(idx),
-		.gpu_size    = gpu_size(idx),
-		.gpu         = gpu_data(idx),
-	};
+	return meta_unchecked(idx);
 }
 
 bool stingray::data_110000F0::has_main(size_t idx) const
 {
-	if (idx >= files()) {
-		throw std::out_of_range("idx >= edx");
-	}
-
-	return (file(idx).size > 0);
+	return main_size(idx) > 0;
 }
 
 uint8_t const* stingray::data_110000F0::main_data(size_t idx) const
 {
-	if (idx >= files()) {
-		throw std::out_of_range("idx >= edx");
-	}
-
-	if (!has_main(idx)) {
-		return nullptr;
-	}
-
-	if (file(idx).offset >= _main_size) {
-		throw std::overflow_error("offset >= size");
-	} else if (file(idx).size + file(idx).offset > _main_size) {
-		throw std::overflow_error("offset+size > size");
-	}
-
-	return &_main + file(idx).offset;
+	return static_cast<uint8_t const*>(meta(idx).main);
 }
 
 size_t stingray::data_110000F0::main_size(size_t idx) const
 {
-	if (idx >= files()) {
-		throw std::out_of_range("idx >= edx");
-	}
-
 	return file(idx).size;
 }
 
 bool stingray::data_110000F0::has_stream(size_t idx) const
 {
-	if (idx >= files()) {
-		throw std::out_of_range("idx >= edx");
-	}
-
-	return (_stream.has_value()) && (file(idx).stream_size > 0);
+	return stream_size(idx) > 0;
 }
 
 uint8_t const* stingray::data_110000F0::stream_data(size_t idx) const
 {
-	if (idx >= files()) {
-		throw std::out_of_range("idx >= edx");
-	}
-
-	if (!has_stream(idx)) {
-		return nullptr;
-	}
-
-	if (file(idx).stream_offset >= _stream_size) {
-		throw std::overflow_error("offset >= size");
-	} else if (file(idx).stream_size + file(idx).stream_offset > _stream_size) {
-		throw std::overflow_error("offset+size > size");
-	}
-
-	return (&(_stream.value()) + file(idx).stream_offset);
+	return static_cast<uint8_t const*>(meta(idx).stream);
 }
 
 size_t stingray::data_110000F0::stream_size(size_t idx) const
 {
-	if (idx >= files()) {
-		throw std::out_of_range("idx >= edx");
-	}
-
-	if (!has_stream(idx)) {
-		return 0;
-	}
-
-	return file(idx).stream_size;
+	return meta(idx).stream_size;
 }
 
 bool stingray::data_110000F0::has_gpu(size_t idx) const
 {
-	if (idx >= files()) {
-		throw std::out_of_range("idx >= edx");
-	}
-
-	return (_gpu.has_value()) && (file(idx).gpu_size > 0);
+	return gpu_size(idx) > 0;
 }
 
 uint8_t const* stingray::data_110000F0::gpu_data(size_t idx) const
 {
-	if (idx >= files()) {
-		throw std::out_of_range("idx >= edx");
-	}
-
-	if (!has_gpu(idx)) {
-		return nullptr;
-	}
-
-	if (file(idx).gpu_offset >= _gpu_size) {
-		throw std::overflow_error("offset >= size");
-	} else if (file(idx).gpu_size + file(idx).gpu_offset > _gpu_size) {
-		throw std::overflow_error("offset+size > size");
-	}
-
-	return (&(_gpu.value()) + file(idx).gpu_offset);
+	return static_cast<uint8_t const*>(meta(idx).gpu);
 }
 
 size_t stingray::data_110000F0::gpu_size(size_t idx) const
 {
-	if (idx >= files()) {
-		throw std::out_of_range("idx >= edx");
-	}
-
-	if (!has_gpu(idx)) {
-		return 0;
-	}
-
-	return file(idx).gpu_size;
+	return meta(idx).gpu_size;
 }
@@ -12,12 +12,17 @@
 #include <cinttypes>
 #include <cstddef>
 #include <filesystem>
+#include <memory>
 #include <optional>
 #include <string_view>
+#include <utility>
+#include <vector>
 #include "mapped_file.hpp"
 #include "stingray.hpp"
 
 namespace stingray {
+	class compressed_stream;
+
 	class data_110000F0 {
 		// header_t header;
 		// type_t type[header.types];
@@ -28,12 +33,15 @@ namespace stingray {
 		mapped_file           _main;
 		size_t                _main_size;
 
-		std::filesystem::path      _stream_path;
-		std::optional<mapped_file> _stream;
-		size_t                     _stream_size;
+		std::filesystem::path                        _stream_path;
+		std::optional<mapped_file>                   _stream;
+		std::shared_ptr<stingray::compressed_stream> _stream_chunked; // Only for chunked zlib streams.
+		uint8_t const*                               _stream_ptr;
+		size_t                                       _stream_size;
 
 		std::filesystem::path      _gpu_path;
 		std::optional<mapped_file> _gpu;
+		uint8_t const*             _gpu_ptr;
 		size_t                     _gpu_size;
 
 		public:
@@ -102,10 +110,23 @@ namespace stingray {
 			void const* stream;
 			size_t      gpu_size;
 			void const* gpu;
+
+			std::shared_ptr<void const> stream_owner; // Keeps inflated .stream data of chunked containers alive.
 		};
 
 		public:
-		data_110000F0(std::filesystem::path path);
+		/** Map a container and its .stream and .gpu_resources files, and validate its structure.
+		 *
+		 * Throws if the header or tables don't fit, or if any file points outside of its sections.
+		 *
+		 * @param threads Number of threads used to inflate ranges of .stream files that are chunked zlib streams.
+		 */
+		data_110000F0(std::filesystem::path path, size_t threads = 1);
+
+		std::filesystem::path const& path() const;
+
+		/** Mapped files by section ("main", "stream", "gpu_resources"), for those that exist. */
+		std::vector<std::pair<std::string_view, mapped_file const*>> mappings() const;
 
 		size_t types() const;
 
@@ -134,6 +155,48 @@ namespace stingray {
 		uint8_t const* gpu_data(size_t idx) const;
 
 		size_t gpu_size(size_t idx) const;
+
+		/** Accessors without any checks, for loops over all files. Only idx < files() is up to the caller, as every file
+		 * was validated when the container was loaded.
+		 */
+		file_t const& file_unchecked(size_t idx) const
+		{
+			return _ptr_file[idx];
+		}
+
+		meta_t meta_unchecked(size_t idx) const
+		{
+			auto meta = layout_unchecked(idx);
+			if (_stream_chunked && (meta.stream_size > 0)) {
+				inflate_stream(meta);
+			}
+			return meta;
+		}
+
+		/** Same as meta_unchecked(), except that .stream data of chunked containers is left as nullptr instead of being
+		 * inflated, for loops that only need the sizes.
+		 */
+		meta_t layout_unchecked(size_t idx) const
+		{
+			auto const& entry  = _ptr_file[idx];
+			bool        stream = (_stream_ptr || _stream_chunked) && (entry.stream_size > 0);
+			bool        gpu    = _gpu_ptr && (entry.gpu_size > 0);
+			return meta_t{
+				.file         = entry,
+				.main_size    = entry.size,
+				.main         = (entry.size > 0) ? reinterpret_cast<uint8_t const*>(_ptr) + entry.offset : nullptr,
+				.stream_size  = stream ? entry.stream_size : 0,
+				.stream       = (stream && _stream_ptr) ? _stream_ptr + entry.stream_offset : nullptr,
+				.gpu_size     = gpu ? entry.gpu_size : 0,
+				.gpu          = gpu ? _gpu_ptr + entry.gpu_offset : nullptr,
+				.stream_owner = nullptr,
+			};
+		}
+
+		private:
+		void validate() const;
+
+		void inflate_stream(meta_t& meta) const;
 	};
 } // namespace stingray
 
@@ -0,0 +1,262 @@
+// Copyright 2024 Michael Fabian 'Xaymar' Dirks <info@xaymar.com>
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "stingray_file_table.hpp"
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <functional>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+// Below this many rows per thread, starting threads costs more than it saves.
+static constexpr size_t merge_chunk = 16384;
+
+namespace {
+	struct merge_entry_t {
+		uint64_t id;
+		uint64_t type;
+		uint32_t row;
+	};
+} // namespace
+
+/** Run work for every index below count, each on its own thread. */
+static void parallel(size_t count, std::function<void(size_t)> const& work)
+{
+	std::vector<std::thread> workers;
+	for (size_t idx = 1; idx < count; idx++) {
+		workers.emplace_back(work, idx);
+	}
+	work(0);
+	for (auto& worker : workers) {
+		worker.join();
+	}
+}
+
+static bool same_section(void const* a, void const* b, size_t size)
+{
+	if ((a == nullptr) || (b == nullptr)) {
+		return a == b;
+	}
+	return memcmp(a, b, size) == 0;
+}
+
+stingray::file_table::~file_table() {}
+
+stingray::file_table::file_table() : _containers(), _ids(), _types(), _container_indices(), _file_indices(), _main_offsets(), _main_sizes(), _stream_offsets(), _stream_sizes(), _gpu_offsets(), _gpu_sizes() {}
+
+void stingray::file_table::add(stingray::data_110000F0 const& container)
+{
+	uint32_t container_index = static_cast<uint32_t>(_containers.size());
+	_containers.push_back(&container);
+
+	size_t rows    = _ids.size() + container.files();
+	auto   reserve = [rows](auto&... columns) { (columns.reserve(rows), ...); };
+	reserve(_ids, _types, _container_indices, _file_indices, _main_offsets, _main_sizes, _stream_offsets, _stream_sizes, _gpu_offsets, _gpu_sizes);
+
+	for (size_t idx = 0, edx = container.files(); idx < edx; idx++) {
+		auto meta = container.layout_unchecked(idx);
+		_ids.push_back(meta.file.id);
+		_types.push_back(meta.file.type);
+		_container_indices.push_back(container_index);
+		_file_indices.push_back(static_cast<uint32_t>(idx));
+		_main_offsets.push_back(meta.file.offset);
+		_main_sizes.push_back(static_cast<uint32_t>(meta.main_size));
+		_stream_offsets.push_back(meta.file.stream_offset);
+		_stream_sizes.push_back(static_cast<uint32_t>(meta.stream_size));
+		_gpu_offsets.push_back(meta.file.gpu_offset);
+		_gpu_sizes.push_back(static_cast<uint32_t>(meta.gpu_size));
+	}
+}
+
+size_t stingray::file_table::size() const
+{
+	return _ids.size();
+}
+
+size_t stingray::file_table::container_count() const
+{
+	return _containers.size();
+}
+
+stingray::data_110000F0 const& stingray::file_table::container(size_t idx) const
+{
+	if (idx >= _containers.size()) {
+		throw std::out_of_range("idx >= edx");
+	}
+
+	return *_containers[idx];
+}
+
+stingray::data_110000F0::meta_t stingray::file_table::meta(size_t row) const
+{
+	if (row >= size()) {
+		throw std::out_of_range("idx >= edx");
+	}
+
+	return _containers[_container_indices[row]]->meta_unchecked(_file_indices[row]);
+}
+
+std::vector<size_t> stingray::file_table::select(stingray::hash_t type) const
+{
+	// Count first, so the second pass writes into exactly sized memory. Both loops only read the type column.
+	uint64_t const value = type;
+	size_t         count = 0;
+	for (size_t row = 0, edx = _types.size(); row < edx; row++) {
+		count += (_types[row] == value) ? 1 : 0;
+	}
+
+	std::vector<size_t> rows;
+	rows.reserve(count);
+	for (size_t row = 0, edx = _types.size(); row < edx; row++) {
+		if (_types[row] == value) {
+			rows.push_back(row);
+		}
+	}
+	return rows;
+}
+
+stingray::file_table::merged_t stingray::file_table::merge(std::span<size_t const> rows, size_t threads, bool compare) const
+{
+	size_t const count = rows.size();
+	size_t const parts = std::clamp<size_t>(count / merge_chunk, 1, std::max<size_t>(threads, 1));
+	auto         range = [count, parts](size_t part) { return std::pair<size_t, size_t>{count * part / parts, count * (part + 1) / parts}; };
+
+	std::vector<merge_entry_t> entries(count);
+	std::vector<merge_entry_t> scratch(count);
+	parallel(parts, [&](size_t part) {
+		for (auto [idx, edx] = range(part); idx < edx; idx++) {
+			entries[idx] = merge_entry_t{_ids[rows[idx]], _types[rows[idx]], static_cast<uint32_t>(rows[idx])};
+		}
+	});
+
+	// LSD radix sort, 8 bits per pass. The type is the lower half of the key, so the id decides the order first.
+	std::vector<std::array<size_t, 256>> histograms(parts);
+	for (size_t pass = 0; pass < 16; pass++) {
+		auto digit = [pass](merge_entry_t const& entry) { return static_cast<size_t>((((pass < 8) ? entry.type : entry.id) >> ((pass % 8) * 8)) & 0xFF); };
+
+		parallel(parts, [&](size_t part) {
+			histograms[part].fill(0);
+			for (auto [idx, edx] = range(part); idx < edx; idx++) {
+				histograms[part][digit(entries[idx])]++;
+			}
+		});
+
+		// Offsets are handed out by digit and then by part, which keeps equal digits in their previous order. A pass in
+		// which every entry has the same digit would not move anything, which is common for the bytes of types.
+		bool   trivial = false;
+		size_t offset  = 0;
+		for (size_t value = 0; value < 256; value++) {
+			size_t start = offset;
+			for (auto& histogram : histograms) {
+				offset += std::exchange(histogram[value], offset);
+			}
+			trivial |= (offset - start) == count;
+		}
+		if (trivial) {
+			continue;
+		}
+
+		parallel(parts, [&](size_t part) {
+			auto& positions = histograms[part];
+			for (auto [idx, edx] = range(part); idx < edx; idx++) {
+				scratch[positions[digit(entries[idx])]++] = entries[idx];
+			}
+		});
+		std::swap(entries, scratch);
+	}
+
+	// Equal keys are now adjacent, with the first given row of each in front.
+	merged_t                                   merged{{}, 0, {}};
+	std::vector<std::pair<uint32_t, uint32_t>> duplicates;
+	for (size_t idx = 0; idx < count;) {
+		merge_entry_t const& kept = entries[idx];
+		merged.rows.push_back(kept.row);
+		while ((++idx < count) && (entries[idx].id == kept.id) && (entries[idx].type == kept.type)) {
+			duplicates.emplace_back(kept.row, entries[idx].row);
+		}
+	}
+	merged.duplicates = duplicates.size();
+
+	// Comparing contents reads both copies, which is worth spreading over all threads.
+	std::vector<uint8_t> differs(duplicates.size(), 0);
+	size_t const         checkers = compare ? std::clamp<size_t>(duplicates.size(), 1, std::max<size_t>(threads, 1)) : 1;
+	parallel(checkers, [&](size_t part) {
+		for (size_t idx = duplicates.size() * part / checkers, edx = duplicates.size() * (part + 1) / checkers; idx < edx; idx++) {
+			auto [a, b] = duplicates[idx];
+			if ((_main_sizes[a] != _main_sizes[b]) || (_stream_sizes[a] != _stream_sizes[b]) || (_gpu_sizes[a] != _gpu_sizes[b])) {
+				differs[idx] = 1;
+			} else if (compare) {
+				auto lhs     = meta(a);
+				auto rhs     = meta(b);
+				differs[idx] = !(same_section(lhs.main, rhs.main, lhs.main_size) && same_section(lhs.stream, rhs.stream, lhs.stream_size) && same_section(lhs.gpu, rhs.gpu, lhs.gpu_size));
+			}
+		}
+	});
+	for (size_t idx = 0; idx < duplicates.size(); idx++) {
+		if (differs[idx]) {
+			merged.conflicts.push_back(conflict_t{duplicates[idx].first, duplicates[idx].second});
+		}
+	}
+
+	return merged;
+}
+
+std::span<uint64_t const> stingray::file_table::ids() const
+{
+	return _ids;
+}
+
+std::span<uint64_t const> stingray::file_table::types() const
+{
+	return _types;
+}
+
+std::span<uint32_t const> stingray::file_table::container_indices() const
+{
+	return _container_indices;
+}
+
+std::span<uint32_t const> stingray::file_table::file_indices() const
+{
+	return _file_indices;
+}
+
+std::span<uint32_t const> stingray::file_table::main_offsets() const
+{
+	return _main_offsets;
+}
+
+std::span<uint32_t const> stingray::file_table::main_sizes() const
+{
+	return _main_sizes;
+}
+
+std::span<uint32_t const> stingray::file_table::stream_offsets() const
+{
+	return _stream_offsets;
+}
+
+std::span<uint32_t const> stingray::file_table::stream_sizes() const
+{
+	return _stream_sizes;
+}
+
+std::span<uint32_t const> stingray::file_table::gpu_offsets() const
+{
+	return _gpu_offsets;
+}
+
+std::span<uint32_t const> stingray::file_table::gpu_sizes() const
+{
+	return _gpu_sizes;
+}
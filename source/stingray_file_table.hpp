@@ -0,0 +1,104 @@
+// Copyright 2024 Michael Fabian 'Xaymar' Dirks <info@xaymar.com>
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#pragma once
+#include <cinttypes>
+#include <cstddef>
+#include <span>
+#include <vector>
+#include "stingray.hpp"
+#include "stingray_data.hpp"
+
+namespace stingray {
+	/** Columnar copy of the file tables of many containers.
+	 *
+	 * Every column is a dense array with one row per file, in the order the containers were added. Scans that only need
+	 * one or two columns, such as selecting a type, don't drag whole file_t records through the cache. Sizes are the
+	 * ones meta_t reports, so sections without a file are 0.
+	 */
+	class file_table {
+		std::vector<stingray::data_110000F0 const*> _containers;
+
+		std::vector<uint64_t> _ids;
+		std::vector<uint64_t> _types;
+		std::vector<uint32_t> _container_indices;
+		std::vector<uint32_t> _file_indices;
+		std::vector<uint32_t> _main_offsets;
+		std::vector<uint32_t> _main_sizes;
+		std::vector<uint32_t> _stream_offsets;
+		std::vector<uint32_t> _stream_sizes;
+		std::vector<uint32_t> _gpu_offsets;
+		std::vector<uint32_t> _gpu_sizes;
+
+		public:
+		struct conflict_t {
+			uint32_t kept;
+			uint32_t duplicate;
+		};
+
+		struct merged_t {
+			/** First row of every id and type, sorted by id and then type. */
+			std::vector<uint32_t> rows;
+			/** Rows which were dropped for having the same id and type as a kept row. */
+			size_t duplicates;
+			/** Dropped rows whose sizes, or contents if compared, differ from the kept row. */
+			std::vector<conflict_t> conflicts;
+		};
+
+		public:
+		~file_table();
+		file_table();
+
+		/** Append all files of a container, which has to outlive the table. */
+		void add(stingray::data_110000F0 const& container);
+
+		/** Number of rows. */
+		size_t size() const;
+
+		size_t container_count() const;
+
+		stingray::data_110000F0 const& container(size_t idx) const;
+
+		/** Resolve a row through the container it came from. */
+		stingray::data_110000F0::meta_t meta(size_t row) const;
+
+		/** Rows of the given type, in order. */
+		std::vector<size_t> select(stingray::hash_t type) const;
+
+		/** Merge rows with the same id and type, keeping the first of each.
+		 *
+		 * The rows are radix sorted by their 128-bit key on up to the given number of threads. The sort is stable, so the
+		 * order of the given rows decides which copy is kept. Duplicates are always checked for differing sizes, and
+		 * their contents are compared as well if compare is set.
+		 */
+		merged_t merge(std::span<size_t const> rows, size_t threads, bool compare) const;
+
+		std::span<uint64_t const> ids() const;
+
+		std::span<uint64_t const> types() const;
+
+		std::span<uint32_t const> container_indices() const;
+
+		std::span<uint32_t const> file_indices() const;
+
+		std::span<uint32_t const> main_offsets() const;
+
+		std::span<uint32_t const> main_sizes() const;
+
+		std::span<uint32_t const> stream_offsets() const;
+
+		std::span<uint32_t const> stream_sizes() const;
+
+		std::span<uint32_t const> gpu_offsets() const;
+
+		std::span<uint32_t const> gpu_sizes() const;
+	};
+} // namespace stingray
@@ -9,32 +9,361 @@
 // THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "stingray_texture.hpp"
+#include <algorithm>
+#include <cstring>
 
 // Known information
-// - gpu_resources only has mip level 2 and up again, which we won't need.
 // - File appear to be DDS, and there is a reference to TGA as well.
+// - The main section holds the header table followed by the DDS header.
+// - header_t::sections describes which ranges of the stream section hold which mip levels. Each entry starts at the mip
+//   level matching its width and height, and continues with the following levels.
+// - gpu_resources only has mip level 2 and up again, so it is used to fill in whatever the stream section doesn't have.
+
+#define TWOCC(a, b) ((a) | (b << 8))
+#define FOURCC(a, b, c, d) ((a) | (b << 8) | (c << 16) | (d << 24))
+
+static constexpr size_t dds_header_size  = 128;
+static constexpr size_t dx10_header_size = 20;
+
+static constexpr uint32_t DDSD_PITCH       = 0x8;
+static constexpr uint32_t DDSD_MIPMAPCOUNT = 0x20000;
+static constexpr uint32_t DDSD_LINEARSIZE  = 0x80000;
+static constexpr uint32_t DDSD_DEPTH       = 0x800000;
+static constexpr uint32_t DDPF_FOURCC      = 0x4;
+static constexpr uint32_t DDSCAPS_COMPLEX  = 0x8;
+static constexpr uint32_t DDSCAPS_MIPMAP   = 0x400000;
+static constexpr uint32_t DDSCAPS2_CUBEMAP = 0x200;
+static constexpr uint32_t DDSCAPS2_VOLUME  = 0x200000;
+
+static uint32_t read32(uint8_t const* ptr)
+{
+	uint32_t value;
+	memcpy(&value, ptr, sizeof(value));
+	return value;
+}
+
+static void write32(uint8_t* ptr, uint32_t value)
+{
+	memcpy(ptr, &value, sizeof(value));
+}
+
+/** Figure out the block dimension and the bytes per block of a DDS pixel format. Uncompressed formats are 1x1 blocks.
+ * Legacy formats are also mapped to their DXGI format, if there is an equivalent one.
+ */
+static bool block_layout(uint8_t const* dds, bool dx10, size_t& block, size_t& bytes, uint32_t& format)
+{
+	block  = 1;
+	bytes  = 0;
+	format = 0;
+
+	if (dx10) {
+		format = read32(dds + dds_header_size);
+		switch (format) {
+		case 70: // BC1
+		case 71:
+		case 72:
+		case 79: // BC4
+		case 80:
+		case 81:
+			block = 4;
+			bytes = 8;
+			break;
+		case 73: // BC2
+		case 74:
+		case 75:
+		case 76: // BC3
+		case 77:
+		case 78:
+		case 82: // BC5
+		case 83:
+		case 84:
+		case 94: // BC6H
+		case 95:
+		case 96:
+		case 97: // BC7
+		case 98:
+		case 99:
+			block = 4;
+			bytes = 16;
+			break;
+		case 1: // R32G32B32A32
+		case 2:
+		case 3:
+		case 4:
+			bytes = 16;
+			break;
+		case 9: // R16G16B16A16
+		case 10:
+		case 11:
+		case 12:
+		case 13:
+		case 14:
+		case 15: // R32G32
+		case 16:
+		case 17:
+		case 18:
+			bytes = 8;
+			break;
+		case 23: // R10G10B10A2
+		case 24:
+		case 25:
+		case 26: // R11G11B10
+		case 27: // R8G8B8A8
+		case 28:
+		case 29:
+		case 30:
+		case 31:
+		case 32:
+		case 33: // R16G16
+		case 34:
+		case 35:
+		case 36:
+		case 37:
+		case 38:
+		case 39: // R32
+		case 40:
+		case 41:
+		case 42:
+		case 43:
+		case 87: // B8G8R8A8
+		case 88:
+		case 90:
+		case 91:
+		case 92:
+		case 93:
+			bytes = 4;
+			break;
+		case 48: // R8G8
+		case 49:
+		case 50:
+		case 51:
+		case 52:
+		case 53: // R16
+		case 54:
+		case 56:
+		case 57:
+		case 58:
+		case 59:
+			bytes = 2;
+			break;
+		case 60: // R8
+		case 61:
+		case 62:
+		case 63:
+		case 64:
+		case 65: // A8
+			bytes = 1;
+			break;
+		default:
+			return false;
+		}
+		return true;
+	}
+
+	uint32_t pf_flags = read32(dds + 80);
+	if (pf_flags & DDPF_FOURCC) {
+		switch (read32(dds + 84)) {
+		case FOURCC('D', 'X', 'T', '1'):
+			format = 71;
+			break;
+		case FOURCC('D', 'X', 'T', '2'):
+		case FOURCC('D', 'X', 'T', '3'):
+			format = 74;
+			break;
+		case FOURCC('D', 'X', 'T', '4'):
+		case FOURCC('D', 'X', 'T', '5'):
+			format = 77;
+			break;
+		case FOURCC('A', 'T', 'I', '1'):
+		case FOURCC('B', 'C', '4', 'U'):
+			format = 80;
+			break;
+		case FOURCC('B', 'C', '4', 'S'):
+			format = 81;
+			break;
+		case FOURCC('A', 'T', 'I', '2'):
+		case FOURCC('B', 'C', '5', 'U'):
+			format = 83;
+			break;
+		case FOURCC('B', 'C', '5', 'S'):
+			format = 84;
+			break;
+		default:
+			return false;
+		}
+		block = 4;
+		bytes = ((format == 71) || (format == 80) || (format == 81)) ? 8 : 16;
+		return true;
+	}
+
+	uint32_t bits = read32(dds + 88);
+	if ((bits == 0) || (bits % 8)) {
+		return false;
+	}
+	bytes = bits / 8;
+	if ((bits == 32) && (read32(dds + 92) == 0x000000FF) && (read32(dds + 96) == 0x0000FF00) && (read32(dds + 100) == 0x00FF0000)) {
+		format = 28; // R8G8B8A8_UNORM
+	} else if ((bits == 32) && (read32(dds + 92) == 0x00FF0000) && (read32(dds + 96) == 0x0000FF00) && (read32(dds + 100) == 0x000000FF)) {
+		format = 87; // B8G8R8A8_UNORM
+	}
+	return true;
+}
 
 stingray::texture::~texture() {}
 
-stingray::texture::texture(stingray::data_110000F0::meta_t meta) : _meta(meta)
+stingray::texture::texture(stingray::data_110000F0::meta_t meta, int32_t mips) : _meta(meta), _chain(false), _dds_sz(0), _mip_count(0), _format(0), _width(0), _height(0), _first(0), _last(0)
 {
 	_header         = reinterpret_cast<decltype(_header)>(_meta.main);
 	_data_header    = reinterpret_cast<decltype(_data_header)>(reinterpret_cast<uint8_t const*>(_header) + sizeof(header_t));
 	_data_header_sz = _meta.main_size - sizeof(header_t);
-	_data           = reinterpret_cast<decltype(_data)>(_meta.stream ? _meta.stream : _meta.gpu);
-	_data_sz        = _meta.stream_size ? _meta.stream_size : _meta.gpu_size;
+
+	_chain = parse_chain(mips);
 }
 
-size_t stingray::texture::size()
+bool stingray::texture::parse_chain(int32_t mips)
 {
-	return _data_header_sz + _data_sz;
+	if ((_meta.main_size < sizeof(header_t)) || (_data_header_sz < dds_header_size)) {
+		return false;
+	}
+	if (read32(_data_header) != FOURCC('D', 'D', 'S', ' ')) {
+		return false;
+	}
+
+	// Arrays, cube maps and volumes interleave their mip chains, which the streamable sections don't describe.
+	uint32_t flags  = read32(_data_header + 8);
+	uint32_t caps2  = read32(_data_header + 112);
+	bool     dx10   = (read32(_data_header + 80) & DDPF_FOURCC) && (read32(_data_header + 84) == FOURCC('D', 'X', '1', '0'));
+	size_t   hdr_sz = dds_header_size + (dx10 ? dx10_header_size : 0);
+	if ((_data_header_sz < hdr_sz) || (flags & DDSD_DEPTH) || (caps2 & (DDSCAPS2_CUBEMAP | DDSCAPS2_VOLUME))) {
+		return false;
+	}
+	if (dx10 && ((read32(_data_header + 136) & 0x4) || (read32(_data_header + 140) > 1))) {
+		return false;
+	}
+
+	size_t block, bytes;
+	if (!block_layout(_data_header, dx10, block, bytes, _format)) {
+		return false;
+	}
+
+	uint32_t height = read32(_data_header + 12);
+	uint32_t width  = read32(_data_header + 16);
+	if ((width == 0) || (height == 0)) {
+		return false;
+	}
+	_width  = width;
+	_height = height;
+	_mip_count = (flags & DDSD_MIPMAPCOUNT) ? read32(_data_header + 28) : 1;
+	_mip_count = std::clamp<size_t>(_mip_count, 1, max_mips);
+
+	// Size of every mip level, and where it starts in a tightly packed chain.
+	std::array<size_t, max_mips + 1> offsets = {0};
+	for (size_t idx = 0; idx < _mip_count; idx++) {
+		size_t w      = std::max<size_t>(width >> idx, 1);
+		size_t h      = std::max<size_t>(height >> idx, 1);
+		_mip_sz[idx]  = ((w + block - 1) / block) * ((h + block - 1) / block) * bytes;
+		_mips[idx]    = nullptr;
+		offsets[idx + 1] = offsets[idx] + _mip_sz[idx];
+	}
+
+	// The stream section, as described by the streamable sections table.
+	auto stream = reinterpret_cast<uint8_t const*>(_meta.stream);
+	if (stream) {
+		bool described = false;
+		for (auto const& section : _header->sections) {
+			if ((section.size == 0) || (static_cast<size_t>(section.offset) + section.size > _meta.stream_size)) {
+				continue;
+			}
+
+			for (size_t idx = 0; idx < _mip_count; idx++) {
+				if ((std::max<size_t>(width >> idx, 1) != section.width) || (std::max<size_t>(height >> idx, 1) != section.height)) {
+					continue;
+				}
+
+				for (size_t jdx = idx; (jdx < _mip_count) && (offsets[jdx + 1] - offsets[idx] <= section.size); jdx++) {
+					if (!_mips[jdx]) {
+						_mips[jdx] = stream + section.offset + (offsets[jdx] - offsets[idx]);
+						described  = true;
+					}
+				}
+				break;
+			}
+		}
+
+		// Without a usable table, assume the stream section is a tightly packed chain starting at the largest level.
+		if (!described) {
+			for (size_t idx = 0; (idx < _mip_count) && (offsets[idx + 1] <= _meta.stream_size); idx++) {
+				_mips[idx] = stream + offsets[idx];
+			}
+		}
+	}
+
+	// The gpu section, and anything left in the main section, hold the tail of the chain.
+	auto fill_tail = [this, &offsets](uint8_t const* ptr, size_t size) {
+		if (!ptr || (size == 0)) {
+			return;
+		}
+		for (size_t idx = 0; idx < _mip_count; idx++) {
+			if ((offsets[_mip_count] - offsets[idx]) == size) {
+				for (size_t jdx = idx; jdx < _mip_count; jdx++) {
+					if (!_mips[jdx]) {
+						_mips[jdx] = ptr + (offsets[jdx] - offsets[idx]);
+					}
+				}
+				return;
+			}
+		}
+	};
+	fill_tail(reinterpret_cast<uint8_t const*>(_meta.gpu), _meta.gpu_size);
+	fill_tail(_data_header + hdr_sz, _data_header_sz - hdr_sz);
+
+	// Export the longest contiguous run of levels, starting at the largest available one.
+	for (_first = 0; (_first < _mip_count) && !_mips[_first]; _first++) {
+	}
+	if (_first == _mip_count) {
+		return false;
+	}
+	for (_last = _first; (_last < _mip_count) && _mips[_last]; _last++) {
+	}
+
+	if (mips > 0) {
+		_last = std::min<size_t>(_last, _first + static_cast<size_t>(mips));
+	} else if (mips < 0) {
+		_first = std::max<size_t>(_first, (_last > static_cast<size_t>(-mips)) ? (_last - static_cast<size_t>(-mips)) : 0);
+	}
+
+	// Rewrite the DDS header to match the levels that are actually exported.
+	_dds_sz = hdr_sz;
+	memcpy(_dds.data(), _data_header, _dds_sz);
+	size_t count = _last - _first;
+	write32(_dds.data() + 12, static_cast<uint32_t>(std::max<size_t>(height >> _first, 1)));
+	write32(_dds.data() + 16, static_cast<uint32_t>(std::max<size_t>(width >> _first, 1)));
+	write32(_dds.data() + 28, static_cast<uint32_t>(count));
+	if (flags & DDSD_LINEARSIZE) {
+		write32(_dds.data() + 20, static_cast<uint32_t>(_mip_sz[_first]));
+	} else if (flags & DDSD_PITCH) {
+		write32(_dds.data() + 20, static_cast<uint32_t>(std::max<size_t>(width >> _first, 1) * bytes));
+	}
+	uint32_t caps = read32(_dds.data() + 108);
+	if (count > 1) {
+		flags |= DDSD_MIPMAPCOUNT;
+		caps |= DDSCAPS_COMPLEX | DDSCAPS_MIPMAP;
+	} else {
+		caps &= ~DDSCAPS_MIPMAP;
+	}
+	write32(_dds.data() + 8, flags);
+	write32(_dds.data() + 108, caps);
+
+	return true;
 }
 
-std::string stingray::texture::extension()
+size_t stingray::texture::size() const
 {
-#define TWOCC(a, b) ((a) | (b << 8))
-#define FOURCC(a, b, c, d) ((a) | (b << 8) | (c << 16) | (d << 24))
+	return sections().total();
+}
 
+std::string_view stingray::texture::extension() const
+{
 	// Take a reasonable guess at what the actual file type is.
 	if (_meta.main_size - sizeof(header_t) >= 4) {
 		uint16_t magic16 = *reinterpret_cast<uint16_t const*>(_data_header);
@@ -50,10 +379,50 @@ std::string stingray::texture::extension()
 	return "texture";
 }
 
-std::list<std::pair<void const*, size_t>> stingray::texture::sections()
+size_t stingray::texture::mips()
 {
-	return {
-		{_data_header, _data_header_sz},
-		{_data, _data_sz},
-	};
+	return _chain ? (_last - _first) : 0;
+}
+
+uint32_t stingray::texture::format() const
+{
+	return _chain ? _format : 0;
+}
+
+uint32_t stingray::texture::width() const
+{
+	return static_cast<uint32_t>(std::max<size_t>(_width >> _first, 1));
+}
+
+uint32_t stingray::texture::height() const
+{
+	return static_cast<uint32_t>(std::max<size_t>(_height >> _first, 1));
+}
+
+uint8_t const* stingray::texture::pixels() const
+{
+	return _chain ? _mips[_first] : nullptr;
+}
+
+stingray::sections_t stingray::texture::sections() const
+{
+	if (!_chain) {
+		// Unknown layout, so keep whatever data we have together.
+		return {
+			{_data_header, _data_header_sz},
+			{_meta.stream ? _meta.stream : _meta.gpu, _meta.stream_size ? _meta.stream_size : _meta.gpu_size},
+		};
+	}
+
+	// Merge neighbouring levels that are also neighbours in memory, so the gather write stays short.
+	stingray::sections_t sections{{_dds.data(), _dds_sz}};
+	for (size_t idx = _first; idx < _last; idx++) {
+		auto& last = sections.back();
+		if ((sections.size() > 1) && (reinterpret_cast<uint8_t const*>(last.first) + last.second == _mips[idx])) {
+			last.second += _mip_sz[idx];
+		} else {
+			sections.push_back(_mips[idx], _mip_sz[idx]);
+		}
+	}
+	return sections;
 }
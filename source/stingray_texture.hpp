@@ -9,9 +9,10 @@
 // THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #pragma once
+#include <array>
 #include <cinttypes>
 #include <cstddef>
-#include <list>
+#include <string_view>
 #include "stingray_data.hpp"
 
 namespace stingray {
@@ -31,22 +32,59 @@ namespace stingray {
 			streamable_section_t sections[15];
 		};
 
+		static constexpr size_t max_mips = 16;
+
 		private:
 		stingray::data_110000F0::meta_t _meta;
 		header_t const*                 _header;
 		uint8_t const*                  _data_header;
 		size_t                          _data_header_sz;
-		uint8_t const*                  _data;
-		size_t                          _data_sz;
+
+		// Reassembled DDS, only valid if the mip chain could be parsed.
+		bool                                 _chain;
+		std::array<uint8_t, 148>             _dds;
+		size_t                               _dds_sz;
+		std::array<uint8_t const*, max_mips> _mips;
+		std::array<size_t, max_mips>         _mip_sz;
+		size_t                               _mip_count;
+		uint32_t                             _format;
+		uint32_t                             _width;
+		uint32_t                             _height;
+		size_t                               _first;
+		size_t                               _last;
 
 		public:
 		~texture();
-		texture(stingray::data_110000F0::meta_t meta);
 
-		size_t size();
+		/** Parse the texture and select which mip levels to export.
+		 *
+		 * @param mips Number of mip levels to export. Positive values keep the largest levels, negative values keep the
+		 *             smallest levels, and 0 keeps every level that is available.
+		 */
+		texture(stingray::data_110000F0::meta_t meta, int32_t mips = 0);
+
+		size_t size() const;
+
+		std::string_view extension() const;
+
+		/** Number of mip levels that will be exported, or 0 if this isn't a DDS with a known layout. */
+		size_t mips();
 
-		std::string extension();
+		/** DXGI format of the pixel data, with legacy FourCC formats mapped to their DXGI equivalent. 0 if unknown. */
+		uint32_t format() const;
 
-		std::list<std::pair<void const*, size_t>> sections();
+		/** Width of the largest exported mip level. */
+		uint32_t width() const;
+
+		/** Height of the largest exported mip level. */
+		uint32_t height() const;
+
+		/** Pixel data of the largest exported mip level. */
+		uint8_t const* pixels() const;
+
+		stingray::sections_t sections() const;
+
+		private:
+		bool parse_chain(int32_t mips);
 	};
 } // namespace stingray
@@ -9,86 +9,253 @@
 // THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "stingray_unit.hpp"
+#include <algorithm>
 #include <stdexcept>
 
+/** Build a name index sorted by name, keeping the original order among duplicate names. */
+static void build_index(std::vector<std::pair<stingray::thin_hash_t, uint32_t>>& index, std::span<stingray::thin_hash_t const> names)
+{
+	index.clear();
+	index.reserve(names.size());
+	for (size_t idx = 0; idx < names.size(); idx++) {
+		index.emplace_back(names[idx], static_cast<uint32_t>(idx));
+	}
+	std::sort(index.begin(), index.end(), [](auto const& lhs, auto const& rhs) {
+		return (static_cast<uint32_t>(lhs.first) < static_cast<uint32_t>(rhs.first)) || ((lhs.first == rhs.first) && (lhs.second < rhs.second));
+	});
+}
+
+static size_t find_index(std::vector<std::pair<stingray::thin_hash_t, uint32_t>> const& index, stingray::thin_hash_t name, size_t missing)
+{
+	auto kv = std::lower_bound(index.begin(), index.end(), name, [](auto const& lhs, stingray::thin_hash_t const& rhs) { return static_cast<uint32_t>(lhs.first) < static_cast<uint32_t>(rhs); });
+	if ((kv == index.end()) || !(kv->first == name)) {
+		return missing;
+	}
+	return kv->second;
+}
+
 stingray::unit::mesh::~mesh() {}
 
 stingray::unit::mesh::mesh() : _ptr(), _material_ptr(), _group_ptr() {}
 
-stingray::unit::mesh::mesh(uint8_t const* ptr)
+stingray::unit::mesh::mesh(uint8_t const* ptr, size_t size)
 {
-	_ptr          = reinterpret_cast<decltype(_ptr)>(ptr);
+	if (size < sizeof(data_t)) {
+		throw std::overflow_error("sizeof(data_t) > size");
+	}
+	_ptr = reinterpret_cast<decltype(_ptr)>(ptr);
+	if ((_ptr->material_offset > size) || ((size - _ptr->material_offset) / sizeof(stingray::thin_hash_t) < _ptr->materials)) {
+		throw std::overflow_error("materials > size");
+	}
+	if ((_ptr->group_offset > size) || ((size - _ptr->group_offset) / sizeof(group_t) < _ptr->groups)) {
+		throw std::overflow_error("groups > size");
+	}
 	_material_ptr = reinterpret_cast<decltype(_material_ptr)>(ptr + _ptr->material_offset);
 	_group_ptr    = reinterpret_cast<decltype(_group_ptr)>(ptr + _ptr->group_offset);
 }
 
+stingray::unit::mesh::data_t const* stingray::unit::mesh::data() const
+{
+	return _ptr;
+}
+
+size_t stingray::unit::mesh::groups() const
+{
+	return _ptr->groups;
+}
+
+stingray::unit::mesh::group_t const& stingray::unit::mesh::group(size_t idx) const
+{
+	if (idx >= _ptr->groups) {
+		throw std::out_of_range("idx >= edx");
+	}
+	return _group_ptr[idx];
+}
+
+size_t stingray::unit::mesh::materials() const
+{
+	return _ptr->materials;
+}
+
+stingray::thin_hash_t stingray::unit::mesh::material(size_t idx) const
+{
+	if (idx >= _ptr->materials) {
+		throw std::out_of_range("idx >= edx");
+	}
+	return _material_ptr[idx];
+}
+
 stingray::unit::mesh_list::~mesh_list() {}
 
-stingray::unit::mesh_list::mesh_list() : _ptr(), _offset_ptr(), _name_ptr(), _mesh_ptr(), _meshes(), _map() {}
+stingray::unit::mesh_list::mesh_list() : _ptr(), _size(), _offsets(), _names(), _index() {}
 
-stingray::unit::mesh_list::mesh_list(uint8_t const* ptr)
+stingray::unit::mesh_list::mesh_list(uint8_t const* ptr, size_t size)
 {
-	_ptr        = reinterpret_cast<decltype(_ptr)>(ptr);
-	_offset_ptr = reinterpret_cast<decltype(_offset_ptr)>(ptr + sizeof(data_t));
-	_name_ptr   = reinterpret_cast<decltype(_name_ptr)>(ptr + sizeof(data_t) + (sizeof(uint32_t) * _ptr->count));
-	_mesh_ptr   = reinterpret_cast<decltype(_mesh_ptr)>(ptr + sizeof(data_t) + (sizeof(uint32_t) * _ptr->count) + (sizeof(stingray::thin_hash_t) * _ptr->count));
+	if (size < sizeof(data_t)) {
+		throw std::overflow_error("sizeof(data_t) > size");
+	}
+	auto header = reinterpret_cast<data_t const*>(ptr);
+	if ((size - sizeof(data_t)) / (sizeof(uint32_t) + sizeof(stingray::thin_hash_t)) < header->count) {
+		throw std::overflow_error("count > size");
+	}
 
-	_meshes.reserve(_ptr->count);
-	for (size_t idx = 0; idx < _ptr->count; idx++) {
-		_meshes.emplace_back(std::make_shared<stingray::unit::mesh>(_mesh_ptr));
+	// Mesh offsets are relative to the end of the count.
+	_ptr     = ptr + sizeof(data_t);
+	_size    = size - sizeof(data_t);
+	_offsets = {reinterpret_cast<uint32_t const*>(_ptr), header->count};
+	_names   = {reinterpret_cast<stingray::thin_hash_t const*>(_ptr + sizeof(uint32_t) * header->count), header->count};
+
+	// Validate every mesh once, so that at() can't fail later on.
+	for (size_t idx = 0; idx < _offsets.size(); idx++) {
+		at(idx);
 	}
-	for (size_t idx = 0; idx < _ptr->count; idx++) {
-		_map.emplace(_name_ptr[idx], _meshes[idx]);
+	build_index(_index, _names);
+}
+
+size_t stingray::unit::mesh_list::size() const
+{
+	return _offsets.size();
+}
+
+stingray::unit::mesh stingray::unit::mesh_list::at(size_t idx) const
+{
+	if (idx >= _offsets.size()) {
+		throw std::out_of_range("idx >= edx");
+	}
+	if (_offsets[idx] >= _size) {
+		throw std::overflow_error("offset >= size");
 	}
+	return {_ptr + _offsets[idx], _size - _offsets[idx]};
 }
 
-size_t stingray::unit::mesh_list::size()
+stingray::thin_hash_t stingray::unit::mesh_list::name(size_t idx) const
 {
-	return _meshes.size();
+	if (idx >= _names.size()) {
+		throw std::out_of_range("idx >= edx");
+	}
+	return _names[idx];
 }
 
-std::shared_ptr<stingray::unit::mesh> stingray::unit::mesh_list::at(size_t idx)
+std::span<stingray::thin_hash_t const> stingray::unit::mesh_list::names() const
 {
-	return _meshes[idx];
+	return _names;
 }
 
-std::map<stingray::thin_hash_t, std::shared_ptr<stingray::unit::mesh>> stingray::unit::mesh_list::get()
+size_t stingray::unit::mesh_list::find(stingray::thin_hash_t name) const
 {
-	return _map;
+	return find_index(_index, name, size());
 }
 
-stingray::unit::node_list::~node_list() {}
+stingray::unit::datatype_list::~datatype_list() {}
 
-stingray::unit::node_list::node_list() : _ptr(), _trss_ptr(), _name_ptr(), _metas(), _map() {}
+stingray::unit::datatype_list::datatype_list() : _ptr(), _offsets() {}
 
-stingray::unit::node_list::node_list(uint8_t const* ptr)
+stingray::unit::datatype_list::datatype_list(uint8_t const* ptr, size_t size)
 {
-	_ptr      = reinterpret_cast<decltype(_ptr)>(ptr);
-	_trss_ptr = reinterpret_cast<decltype(_trss_ptr)>(ptr + sizeof(header_t));
-	_name_ptr = reinterpret_cast<decltype(_name_ptr)>(ptr + sizeof(header_t) + (sizeof(float) * 16 * _ptr->count));
+	if (size < sizeof(header_t)) {
+		throw std::overflow_error("sizeof(header_t) > size");
+	}
+	auto header = reinterpret_cast<header_t const*>(ptr);
+	if ((size - sizeof(header_t)) / (sizeof(uint32_t) * 2) < header->count) {
+		throw std::overflow_error("count > size");
+	}
+	_ptr     = ptr;
+	_offsets = {reinterpret_cast<uint32_t const*>(ptr + sizeof(header_t)), header->count};
 
-	_metas.reserve(_ptr->count + 1);
-	for (size_t idx = 0; idx < _ptr->count; idx++) {
-		_metas.emplace_back(std::make_shared<stingray::unit::node_list::meta_t>(_name_ptr[idx], &_trss_ptr[idx], &_link_ptr[idx]));
+	for (size_t idx = 0; idx < _offsets.size(); idx++) {
+		if ((_offsets[idx] > size) || ((size - _offsets[idx]) < sizeof(datatype_t))) {
+			throw std::overflow_error("offset+size > size");
+		}
 	}
-	for (size_t idx = 0; idx < _ptr->count; idx++) {
-		_map.emplace(_name_ptr[idx], _metas[idx]);
+}
+
+size_t stingray::unit::datatype_list::size() const
+{
+	return _offsets.size();
+}
+
+stingray::unit::datatype_t const* stingray::unit::datatype_list::at(size_t idx) const
+{
+	if (idx >= _offsets.size()) {
+		throw std::out_of_range("idx >= edx");
 	}
+	return reinterpret_cast<datatype_t const*>(_ptr + _offsets[idx]);
 }
 
-size_t stingray::unit::node_list::size()
+size_t stingray::unit::element_size(element_format format)
 {
-	return _metas.size();
+	switch (format) {
+	case element_format::F32VEC2:
+		return sizeof(float) * 2;
+	case element_format::F32VEC3:
+		return sizeof(float) * 3;
+	case element_format::_4_4B_WIDE:
+	case element_format::_24_4B_WIDE:
+	case element_format::_25_4B_WIDE:
+	case element_format::_26_4B_WIDE:
+		return 4;
+	case element_format::F16VEC2:
+		return sizeof(uint16_t) * 2;
+	default:
+		return 0;
+	}
 }
 
-std::shared_ptr<stingray::unit::node_list::meta_t> stingray::unit::node_list::at(size_t idx)
+stingray::unit::node_list::~node_list() {}
+
+stingray::unit::node_list::node_list() : _trss(), _links(), _names(), _index() {}
+
+stingray::unit::node_list::node_list(uint8_t const* ptr, size_t size)
 {
-	return _metas[idx];
+	if (size < sizeof(header_t)) {
+		throw std::overflow_error("sizeof(header_t) > size");
+	}
+	auto header = reinterpret_cast<header_t const*>(ptr);
+	if ((size - sizeof(header_t)) / (sizeof(trss_t) + sizeof(float) * 16 + sizeof(link_t) + sizeof(stingray::thin_hash_t)) < header->count) {
+		throw std::overflow_error("count > size");
+	}
+
+	size_t count = header->count;
+	auto   trss  = ptr + sizeof(header_t);
+	auto   links = trss + (sizeof(trss_t) * count) + (sizeof(float) * 16 * count);
+	auto   names = links + (sizeof(link_t) * count);
+	_trss        = {reinterpret_cast<trss_t const*>(trss), count};
+	_links       = {reinterpret_cast<link_t const*>(links), count};
+	_names       = {reinterpret_cast<stingray::thin_hash_t const*>(names), count};
+	build_index(_index, _names);
 }
 
-std::map<stingray::thin_hash_t, std::shared_ptr<stingray::unit::node_list::meta_t>> const& stingray::unit::node_list::get()
+size_t stingray::unit::node_list::size() const
 {
-	return _map;
+	return _names.size();
+}
+
+stingray::unit::node_list::meta_t stingray::unit::node_list::at(size_t idx) const
+{
+	if (idx >= _names.size()) {
+		throw std::out_of_range("idx >= edx");
+	}
+	return {_names[idx], &_trss[idx], &_links[idx]};
+}
+
+std::span<stingray::unit::node_list::trss_t const> stingray::unit::node_list::trss() const
+{
+	return _trss;
+}
+
+std::span<stingray::unit::node_list::link_t const> stingray::unit::node_list::links() const
+{
+	return _links;
+}
+
+std::span<stingray::thin_hash_t const> stingray::unit::node_list::names() const
+{
+	return _names;
+}
+
+size_t stingray::unit::node_list::find(stingray::thin_hash_t name) const
+{
+	return find_index(_index, name, size());
 }
 
 stingray::unit::material_list::~material_list() {}
@@ -120,21 +287,55 @@ stingray::unit::unit::unit(stingray::data_110000F0::meta_t meta) : _meta(meta)
 
 	_ptr           = reinterpret_cast<decltype(_ptr)>(_meta.main);
 	_material_list = {reinterpret_cast<uint8_t const*>(_meta.main) + _ptr->materials_offset};
+
+	// Geometry is optional, and a unit with broken geometry tables is still exported as-is.
+	auto load = [this](auto& list, uint32_t offset) {
+		try {
+			if ((offset != 0) && (offset < _data_sz)) {
+				list = {_data + offset, _data_sz - offset};
+			}
+		} catch (std::exception const&) {
+			list = {};
+		}
+	};
+	load(_datatype_list, _ptr->datatypes_offset);
+	load(_mesh_list, _ptr->meshinfo_offset);
+	load(_node_list, _ptr->nodes_offset);
 }
 
-size_t stingray::unit::unit::size()
+size_t stingray::unit::unit::size() const
 {
 	return _data_sz;
 }
 
-std::string stingray::unit::unit::extension()
+std::string_view stingray::unit::unit::extension() const
 {
 	return "unit";
 }
 
-std::list<std::pair<void const*, size_t>> stingray::unit::unit::sections()
+stingray::sections_t stingray::unit::unit::sections() const
 {
 	return {
 		{_data, _data_sz},
 	};
 }
+
+stingray::data_110000F0::meta_t const& stingray::unit::unit::meta()
+{
+	return _meta;
+}
+
+stingray::unit::datatype_list& stingray::unit::unit::datatypes()
+{
+	return _datatype_list;
+}
+
+stingray::unit::mesh_list& stingray::unit::unit::meshes()
+{
+	return _mesh_list;
+}
+
+stingray::unit::node_list& stingray::unit::unit::nodes()
+{
+	return _node_list;
+}
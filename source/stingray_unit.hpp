@@ -11,11 +11,13 @@
 #pragma once
 #include <cinttypes>
 #include <cstddef>
-#include <list>
 #include <map>
 #include <memory>
 #include <set>
+#include <span>
 #include <string>
+#include <string_view>
+#include <vector>
 #include "stingray.hpp"
 #include "stingray_data.hpp"
 
@@ -154,39 +156,84 @@ namespace stingray {
 			public:
 			~mesh();
 			mesh();
-			mesh(uint8_t const* ptr);
+			mesh(uint8_t const* ptr, size_t size);
+
+			data_t const* data() const;
+
+			size_t groups() const;
+
+			group_t const& group(size_t idx) const;
+
+			size_t materials() const;
+
+			stingray::thin_hash_t material(size_t idx) const;
 		};
 
+		/** View over the mesh table of a unit.
+		 *
+		 * Meshes are resolved on access straight from the mapped data. Only a single sorted name index is allocated.
+		 */
 		class mesh_list {
 			public:
 			struct data_t {
 				uint32_t count;
-				//uint32_t offsets[count];
+				//uint32_t offsets[count]; // relative to the end of count
 				//stingray::thin_hash_t names[count];
 				//mesh_t meshes[count];
 			};
 
 			private:
-			data_t const*                _ptr;
-			uint32_t const*              _offset_ptr;
-			stingray::thin_hash_t const* _name_ptr;
-			uint8_t const*               _mesh_ptr;
+			uint8_t const* _ptr;
+			size_t         _size;
+
+			std::span<uint32_t const>              _offsets;
+			std::span<stingray::thin_hash_t const> _names;
 
-			std::vector<std::shared_ptr<mesh>>                     _meshes;
-			std::map<stingray::thin_hash_t, std::shared_ptr<mesh>> _map;
+			std::vector<std::pair<stingray::thin_hash_t, uint32_t>> _index;
 
 			public:
 			~mesh_list();
 			mesh_list();
-			mesh_list(uint8_t const* ptr);
+			mesh_list(uint8_t const* ptr, size_t size);
+
+			size_t size() const;
+
+			mesh at(size_t idx) const;
+
+			stingray::thin_hash_t name(size_t idx) const;
+
+			std::span<stingray::thin_hash_t const> names() const;
+
+			/** Index of the mesh with the given name, or size() if there is none. */
+			size_t find(stingray::thin_hash_t name) const;
+		};
+
+		class datatype_list {
+			public:
+			struct header_t {
+				uint32_t count;
+				//uint32_t offsets[count];
+				//uint32_t __unk[count];
+				//datatype_t datatypes[count];
+			};
 
-			size_t size();
+			private:
+			uint8_t const*            _ptr;
+			std::span<uint32_t const> _offsets;
+
+			public:
+			~datatype_list();
+			datatype_list();
+			datatype_list(uint8_t const* ptr, size_t size);
 
-			std::shared_ptr<mesh> at(size_t idx);
+			size_t size() const;
 
-			std::map<stingray::thin_hash_t, std::shared_ptr<mesh>> get();
+			datatype_t const* at(size_t idx) const;
 		};
 
+		/** Size in bytes of a single vertex element, or 0 if the format is not known. */
+		size_t element_size(element_format format);
+
 		class node_list {
 			public:
 			struct header_t {
@@ -197,8 +244,8 @@ namespace stingray {
 
 				// trss_t trss[count];
 				// float precalc[4 * 4 * count];
-				// link_t links[count]
-				// stingray::thinhash_t node[count];
+				// link_t links[count];
+				// stingray::thin_hash_t node[count];
 			};
 
 			struct trss_t {
@@ -220,24 +267,29 @@ namespace stingray {
 			};
 
 			private:
-			header_t const*              _ptr;
-			trss_t const*                _trss_ptr;
-			link_t const*                _link_ptr;
-			stingray::thin_hash_t const* _name_ptr;
+			std::span<trss_t const>                _trss;
+			std::span<link_t const>                _links;
+			std::span<stingray::thin_hash_t const> _names;
 
-			std::vector<std::shared_ptr<meta_t>>                     _metas;
-			std::map<stingray::thin_hash_t, std::shared_ptr<meta_t>> _map;
+			std::vector<std::pair<stingray::thin_hash_t, uint32_t>> _index;
 
 			public:
 			~node_list();
 			node_list();
-			node_list(uint8_t const* ptr);
+			node_list(uint8_t const* ptr, size_t size);
+
+			size_t size() const;
+
+			meta_t at(size_t idx) const;
+
+			std::span<trss_t const> trss() const;
 
-			size_t size();
+			std::span<link_t const> links() const;
 
-			std::shared_ptr<meta_t> at(size_t idx);
+			std::span<stingray::thin_hash_t const> names() const;
 
-			std::map<stingray::thin_hash_t, std::shared_ptr<meta_t>> const& get();
+			/** Index of the node with the given name, or size() if there is none. */
+			size_t find(stingray::thin_hash_t name) const;
 		};
 
 		class material_list {
@@ -299,6 +351,9 @@ namespace stingray {
 
 			data_t const* _ptr;
 			material_list _material_list;
+			datatype_list _datatype_list;
+			mesh_list     _mesh_list;
+			node_list     _node_list;
 
 			uint8_t const* _data;
 			size_t         _data_sz;
@@ -307,11 +362,19 @@ namespace stingray {
 			~unit();
 			unit(stingray::data_110000F0::meta_t meta);
 
-			size_t size();
+			size_t size() const;
+
+			std::string_view extension() const;
+
+			stingray::sections_t sections() const;
+
+			stingray::data_110000F0::meta_t const& meta();
+
+			datatype_list& datatypes();
 
-			std::string extension();
+			mesh_list& meshes();
 
-			std::list<std::pair<void const*, size_t>> sections();
+			node_list& nodes();
 		};
 	} // namespace unit
 } // namespace stingray
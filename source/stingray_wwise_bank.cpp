@@ -9,29 +9,128 @@
 // THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "stingray_wwise_bank.hpp"
+#include <algorithm>
+#include <cstring>
+
+static constexpr uint32_t tag_didx = 0x58444944; // "DIDX"
+static constexpr uint32_t tag_data = 0x41544144; // "DATA"
+static constexpr uint32_t tag_hirc = 0x43524948; // "HIRC"
+
+static uint32_t read32(uint8_t const* ptr)
+{
+	uint32_t v;
+	memcpy(&v, ptr, sizeof(v));
+	return v;
+}
 
 stingray::wwise_bank::~wwise_bank() {}
 
-stingray::wwise_bank::wwise_bank(stingray::data_110000F0::meta_t meta) : _meta(meta)
+stingray::wwise_bank::wwise_bank(stingray::data_110000F0::meta_t meta) : _meta(meta), _media(), _hirc(), _hirc_sz()
 {
 	_header  = reinterpret_cast<decltype(_header)>(_meta.main);
 	_data    = reinterpret_cast<decltype(_data)>(_meta.main) + sizeof(header_t);
 	_data_sz = _header->size;
+
+	index();
+}
+
+void stingray::wwise_bank::index()
+{
+	// Clamp to the mapped data, in case the header claims more than there is.
+	size_t size = std::min(_data_sz, (_meta.main_size > sizeof(header_t)) ? (_meta.main_size - sizeof(header_t)) : 0);
+
+	// The bank is a flat list of chunks, each with a tag and a size.
+	uint8_t const* didx    = nullptr;
+	size_t         didx_sz = 0;
+	uint8_t const* data    = nullptr;
+	size_t         data_sz = 0;
+	for (size_t offset = 0; (offset + 8) <= size;) {
+		uint32_t tag   = read32(_data + offset);
+		size_t   chunk = read32(_data + offset + 4);
+		offset += 8;
+		if (chunk > (size - offset)) {
+			break;
+		}
+
+		if (tag == tag_didx) {
+			didx    = _data + offset;
+			didx_sz = chunk;
+		} else if (tag == tag_data) {
+			data    = _data + offset;
+			data_sz = chunk;
+		} else if (tag == tag_hirc) {
+			_hirc    = _data + offset;
+			_hirc_sz = chunk;
+		}
+		offset += chunk;
+	}
+
+	// DIDX entries are { id, offset, size }, with offsets relative to the start of DATA.
+	if (didx && data) {
+		_media.reserve(didx_sz / 12);
+		for (size_t offset = 0; (offset + 12) <= didx_sz; offset += 12) {
+			uint32_t id     = read32(didx + offset);
+			uint32_t start  = read32(didx + offset + 4);
+			uint32_t length = read32(didx + offset + 8);
+			if ((start > data_sz) || (length > (data_sz - start))) {
+				continue;
+			}
+			_media.push_back({id, data + start, length});
+		}
+		std::stable_sort(_media.begin(), _media.end(), [](media_t const& lhs, media_t const& rhs) { return lhs.id < rhs.id; });
+	}
 }
 
-size_t stingray::wwise_bank::size()
+size_t stingray::wwise_bank::size() const
 {
 	return _data_sz;
 }
 
-std::string stingray::wwise_bank::extension()
+std::string_view stingray::wwise_bank::extension() const
 {
 	return "bnk";
 }
 
-std::list<std::pair<void const*, size_t>> stingray::wwise_bank::sections()
+stingray::sections_t stingray::wwise_bank::sections() const
 {
 	return {
 		{_data, _data_sz},
 	};
 }
+
+std::vector<stingray::wwise_bank::media_t> const& stingray::wwise_bank::media()
+{
+	return _media;
+}
+
+stingray::wwise_bank::media_t const* stingray::wwise_bank::find_media(uint32_t id) const
+{
+	auto kv = std::lower_bound(_media.begin(), _media.end(), id, [](media_t const& lhs, uint32_t rhs) { return lhs.id < rhs; });
+	if ((kv == _media.end()) || (kv->id != id)) {
+		return nullptr;
+	}
+	return &*kv;
+}
+
+std::vector<stingray::wwise_bank::object_t> stingray::wwise_bank::objects()
+{
+	std::vector<object_t> objects;
+	if (!_hirc || (_hirc_sz < 4)) {
+		return objects;
+	}
+
+	// Objects are { uint8 type, uint32 size, uint32 id, ... }, where size counts everything after itself.
+	uint32_t count = read32(_hirc);
+	objects.reserve(std::min<size_t>(count, _hirc_sz / 9));
+	size_t offset = 4;
+	for (uint32_t idx = 0; (idx < count) && ((offset + 9) <= _hirc_sz); idx++) {
+		uint8_t  type = _hirc[offset];
+		uint32_t size = read32(_hirc + offset + 1);
+		if ((size < 4) || (size > (_hirc_sz - offset - 5))) {
+			break;
+		}
+		objects.push_back({type, read32(_hirc + offset + 5), size});
+		offset += 5 + size;
+	}
+	return objects;
+}
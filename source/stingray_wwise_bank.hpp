@@ -11,7 +11,9 @@
 #pragma once
 #include <cinttypes>
 #include <cstddef>
-#include <list>
+#include <string>
+#include <string_view>
+#include <vector>
 #include "stingray_data.hpp"
 
 namespace stingray {
@@ -23,20 +25,49 @@ namespace stingray {
 			uint64_t name_hash;
 		};
 
+		/** An embedded WEM, as listed in the DIDX chunk and stored in the DATA chunk. */
+		struct media_t {
+			uint32_t       id;
+			uint8_t const* data;
+			size_t         size;
+		};
+
+		/** An object in the HIRC chunk. */
+		struct object_t {
+			uint8_t  type;
+			uint32_t id;
+			uint32_t size;
+		};
+
 		private:
 		stingray::data_110000F0::meta_t _meta;
 		header_t const*                 _header;
 		uint8_t const*                  _data;
 		size_t                          _data_sz;
 
+		std::vector<media_t> _media;
+		uint8_t const*       _hirc;
+		size_t               _hirc_sz;
+
 		public:
 		~wwise_bank();
 		wwise_bank(stingray::data_110000F0::meta_t meta);
 
-		size_t size();
+		size_t size() const;
 
-		std::string extension();
+		std::string_view extension() const;
 
-		std::list<std::pair<void const*, size_t>> sections();
+		stingray::sections_t sections() const;
+
+		/** Embedded WEMs sorted by id. Entries which don't fit into the DATA chunk are left out. */
+		std::vector<media_t> const& media();
+
+		media_t const* find_media(uint32_t id) const;
+
+		/** Walk the HIRC chunk, stopping at the first object that doesn't fit. */
+		std::vector<object_t> objects();
+
+		private:
+		void index();
 	};
 } // namespace stingray
@@ -19,17 +19,17 @@ stingray::wwise_stream::wwise_stream(stingray::data_110000F0::meta_t meta) : _me
 	_data_sz = _header->size;
 }
 
-size_t stingray::wwise_stream::size()
+size_t stingray::wwise_stream::size() const
 {
 	return _data_sz;
 }
 
-std::string stingray::wwise_stream::extension()
+std::string_view stingray::wwise_stream::extension() const
 {
 	return "wem";
 }
 
-std::list<std::pair<void const*, size_t>> stingray::wwise_stream::sections()
+stingray::sections_t stingray::wwise_stream::sections() const
 {
 	return {
 		{_data, _data_sz},
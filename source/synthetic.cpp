@@ -0,0 +1,507 @@
+// Copyright 2024 Michael Fabian 'Xaymar' Dirks <info@xaymar.com>
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "synthetic.hpp"
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <numeric>
+#include <stdexcept>
+#include "hasher.hpp"
+#include "stingray_data.hpp"
+#include "string_printf.hpp"
+
+static constexpr std::string_view kind_names[] = {
+	"texture", "bik", "unit", "wwise_stream", "wwise_bank", "other",
+};
+
+static constexpr uint64_t kind_types[] = {
+	0x329ec6a0c63842cdull, // texture
+	0x18fa2930f06559aaull, // bik
+	0x3f45a7e90b8da4e0ull, // unit
+	0x0e44215d23554b50ull, // wwise_stream
+	0x99d750e6d37b5a53ull, // wwise_bank
+};
+
+// Types without a converter, which are dumped as they are.
+static constexpr uint64_t other_types[] = {
+	0xe217d12cfa8d4ea1ull, // lua
+	0xfa3d5604e610a03eull, // material
+	0x7ae7e5d19e6d9cadull, // package
+	0x26cc46766d331e93ull, // animation
+	0x5c16065104d486a4ull, // state_machine
+};
+
+/** SplitMix64, which is much faster than std::mt19937_64 for filling payloads. */
+static uint64_t next_random(uint64_t& state)
+{
+	uint64_t value = (state += 0x9E3779B97F4A7C15ull);
+	value          = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ull;
+	value          = (value ^ (value >> 27)) * 0x94D049BB133111EBull;
+	return value ^ (value >> 31);
+}
+
+/** Integer in [0, count). The modulo bias is far too small to matter for test data. */
+static uint64_t next_below(uint64_t& state, uint64_t count)
+{
+	return next_random(state) % count;
+}
+
+/** Number in [0, 1), from the top 53 bits. */
+static double next_chance(uint64_t& state)
+{
+	return static_cast<double>(next_random(state) >> 11) * (1. / static_cast<double>(uint64_t(1) << 53));
+}
+
+/** Roughly log-uniform size in [min, max]: an evenly picked power of two, then an even spot within it. */
+static size_t next_size(uint64_t& state, size_t min, size_t max)
+{
+	if (min >= max) {
+		return min;
+	}
+
+	uint64_t low  = std::bit_width(min) - 1;
+	uint64_t high = std::bit_width(max - 1) - 1;
+	uint64_t base = uint64_t(1) << (low + next_below(state, high - low + 1));
+	return std::clamp<size_t>(base + next_below(state, base), min, max);
+}
+
+static void fill(uint8_t* data, size_t size, uint64_t& state)
+{
+	for (; size >= sizeof(uint64_t); data += sizeof(uint64_t), size -= sizeof(uint64_t)) {
+		uint64_t value = next_random(state);
+		memcpy(data, &value, sizeof(value));
+	}
+	if (size > 0) {
+		uint64_t value = next_random(state);
+		memcpy(data, &value, size);
+	}
+}
+
+static std::vector<uint8_t> random_bytes(size_t size, uint64_t& state)
+{
+	std::vector<uint8_t> buffer(size);
+	fill(buffer.data(), buffer.size(), state);
+	return buffer;
+}
+
+template<typename T>
+static void put(std::vector<uint8_t>& buffer, T const& value)
+{
+	auto ptr = reinterpret_cast<uint8_t const*>(&value);
+	buffer.insert(buffer.end(), ptr, ptr + sizeof(T));
+}
+
+static void put_text(std::vector<uint8_t>& buffer, std::string_view text)
+{
+	buffer.insert(buffer.end(), text.begin(), text.end());
+}
+
+static size_t align(size_t value, size_t alignment)
+{
+	return (value + alignment - 1) & ~(alignment - 1);
+}
+
+/** DXT1 texture with a full mip chain. The largest level is streamed, the rest of the chain is in the gpu section. */
+static void build_texture(hellextractor::synthetic::container& container, stingray::hash_t id, stingray::hash_t type, size_t size, uint64_t& state)
+{
+	auto level_size = [](uint32_t dim) { return static_cast<size_t>(std::max<uint32_t>(dim / 4, 1)) * std::max<uint32_t>(dim / 4, 1) * 8; };
+
+	uint32_t dim = 4;
+	while ((dim < 8192) && (level_size(dim * 2) <= size)) {
+		dim *= 2;
+	}
+	uint32_t mips = 1;
+	for (uint32_t d = dim; d > 1; d /= 2) {
+		mips++;
+	}
+
+	std::vector<uint8_t> main;
+	put<uint32_t>(main, 0);
+	put<uint32_t>(main, 0);
+	put<uint32_t>(main, 0);
+	for (size_t idx = 0; idx < 15; idx++) { // streamable_section_t
+		put<uint32_t>(main, 0);
+		put<uint32_t>(main, (idx == 0) ? static_cast<uint32_t>(level_size(dim)) : 0);
+		put<uint16_t>(main, (idx == 0) ? static_cast<uint16_t>(dim) : 0);
+		put<uint16_t>(main, (idx == 0) ? static_cast<uint16_t>(dim) : 0);
+	}
+
+	// DDS header, with DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_MIPMAPCOUNT | DDSD_LINEARSIZE.
+	put_text(main, "DDS ");
+	put<uint32_t>(main, 124);
+	put<uint32_t>(main, 0x000A1007);
+	put<uint32_t>(main, dim);
+	put<uint32_t>(main, dim);
+	put<uint32_t>(main, static_cast<uint32_t>(level_size(dim)));
+	put<uint32_t>(main, 0);
+	put<uint32_t>(main, mips);
+	for (size_t idx = 0; idx < 11; idx++) {
+		put<uint32_t>(main, 0);
+	}
+	put<uint32_t>(main, 32);
+	put<uint32_t>(main, 0x4); // DDPF_FOURCC
+	put_text(main, "DXT1");
+	for (size_t idx = 0; idx < 5; idx++) {
+		put<uint32_t>(main, 0);
+	}
+	put<uint32_t>(main, 0x401008); // DDSCAPS_COMPLEX | DDSCAPS_TEXTURE | DDSCAPS_MIPMAP
+	for (size_t idx = 0; idx < 4; idx++) {
+		put<uint32_t>(main, 0);
+	}
+
+	size_t tail = 0;
+	for (uint32_t d = dim / 2; d > 0; d /= 2) {
+		tail += level_size(d);
+	}
+	container.add(id, type, std::move(main), random_bytes(level_size(dim), state), random_bytes(tail, state));
+}
+
+static void build_bik(hellextractor::synthetic::container& container, stingray::hash_t id, stingray::hash_t type, size_t size, uint64_t& state)
+{
+	std::vector<uint8_t> main(16, 0);
+	put_text(main, "BIKi");
+	put<uint32_t>(main, static_cast<uint32_t>(size + 44 - 8));
+	auto header = random_bytes(40, state);
+	main.insert(main.end(), header.begin(), header.end());
+	container.add(id, type, std::move(main), random_bytes(size, state), {});
+}
+
+/** Unit without any meshes, followed by opaque data. */
+static void build_unit(hellextractor::synthetic::container& container, stingray::hash_t id, stingray::hash_t type, size_t size, uint64_t& state)
+{
+	std::vector<uint8_t> main(120, 0);
+	uint32_t             mesh_list = static_cast<uint32_t>(main.size());
+	memcpy(main.data() + 112, &mesh_list, sizeof(mesh_list));
+	put<uint32_t>(main, 0);
+	auto tail = random_bytes(size, state);
+	main.insert(main.end(), tail.begin(), tail.end());
+	container.add(id, type, std::move(main), {}, {});
+}
+
+static void build_wwise_stream(hellextractor::synthetic::container& container, stingray::hash_t id, stingray::hash_t type, size_t size, uint64_t& state)
+{
+	size = std::max<size_t>(size, 12);
+
+	std::vector<uint8_t> stream;
+	put_text(stream, "RIFF");
+	put<uint32_t>(stream, static_cast<uint32_t>(size - 8));
+	put_text(stream, "WAVE");
+	auto data = random_bytes(size - stream.size(), state);
+	stream.insert(stream.end(), data.begin(), data.end());
+
+	std::vector<uint8_t> main;
+	put<uint32_t>(main, 0);
+	put<uint32_t>(main, 0);
+	put<uint32_t>(main, static_cast<uint32_t>(stream.size()));
+	container.add(id, type, std::move(main), std::move(stream), {});
+}
+
+/** Sound bank with embedded WEMs of roughly 8 KiB each, and a small HIRC chunk. */
+static void build_wwise_bank(hellextractor::synthetic::container& container, stingray::hash_t id, stingray::hash_t type, size_t size, uint64_t& state)
+{
+	size_t count = std::clamp<size_t>(size / 8192, 1, 64);
+	size_t each  = std::max<size_t>(size / count, 16);
+
+	std::vector<uint8_t> didx;
+	std::vector<uint8_t> data;
+	for (size_t idx = 0; idx < count; idx++) {
+		data.resize(align(data.size(), 16));
+		put<uint32_t>(didx, static_cast<uint32_t>(next_random(state)));
+		put<uint32_t>(didx, static_cast<uint32_t>(data.size()));
+		put<uint32_t>(didx, static_cast<uint32_t>(each));
+		put_text(data, "RIFF");
+		auto wem = random_bytes(each - 4, state);
+		data.insert(data.end(), wem.begin(), wem.end());
+	}
+
+	std::vector<uint8_t> hirc;
+	put<uint32_t>(hirc, static_cast<uint32_t>(count));
+	for (size_t idx = 0; idx < count; idx++) {
+		put<uint8_t>(hirc, 2); // Sound
+		put<uint32_t>(hirc, 8);
+		put<uint32_t>(hirc, static_cast<uint32_t>(next_random(state)));
+		put<uint32_t>(hirc, static_cast<uint32_t>(idx));
+	}
+
+	std::vector<uint8_t> bank;
+	auto                 chunk = [&bank](std::string_view tag, std::vector<uint8_t> const& content) {
+		put_text(bank, tag);
+		put<uint32_t>(bank, static_cast<uint32_t>(content.size()));
+		bank.insert(bank.end(), content.begin(), content.end());
+	};
+	chunk("BKHD", std::vector<uint8_t>(16, 0));
+	chunk("DIDX", didx);
+	chunk("DATA", data);
+	chunk("HIRC", hirc);
+
+	std::vector<uint8_t> main;
+	put<uint32_t>(main, 0);
+	put<uint32_t>(main, static_cast<uint32_t>(bank.size()));
+	put<uint64_t>(main, 0);
+	main.insert(main.end(), bank.begin(), bank.end());
+	container.add(id, type, std::move(main), {}, {});
+}
+
+void hellextractor::synthetic::parse_mix(std::string_view text, options_t& options)
+{
+	while (!text.empty()) {
+		auto entry = text.substr(0, text.find(','));
+		text.remove_prefix(std::min(entry.size() + 1, text.size()));
+
+		auto split = entry.find('=');
+		if (split == std::string_view::npos) {
+			throw std::runtime_error(string_printf("Expected <kind>=<weight>, got '%.*s'", static_cast<int>(entry.size()), entry.data()));
+		}
+		auto key   = entry.substr(0, split);
+		auto value = std::string{entry.substr(split + 1)};
+
+		auto kv = std::find(std::begin(kind_names), std::end(kind_names), key);
+		if (kv == std::end(kind_names)) {
+			throw std::runtime_error(string_printf("Unknown kind '%.*s'", static_cast<int>(key.size()), key.data()));
+		}
+		options.mix[static_cast<size_t>(kv - std::begin(kind_names))] = static_cast<uint32_t>(std::stoul(value));
+	}
+}
+
+std::string_view hellextractor::synthetic::name(kind value)
+{
+	if (value >= kind::_COUNT) {
+		throw std::out_of_range("idx >= edx");
+	}
+	return kind_names[static_cast<size_t>(value)];
+}
+
+stingray::hash_t hellextractor::synthetic::type(kind value, uint64_t seed)
+{
+	if (value >= kind::_COUNT) {
+		throw std::out_of_range("idx >= edx");
+	} else if (value == kind::OTHER) {
+		return other_types[seed % std::size(other_types)];
+	}
+	return kind_types[static_cast<size_t>(value)];
+}
+
+hellextractor::synthetic::container::~container() {}
+
+hellextractor::synthetic::container::container() : _files() {}
+
+void hellextractor::synthetic::container::add(stingray::hash_t id, stingray::hash_t type, std::vector<uint8_t> main, std::vector<uint8_t> stream, std::vector<uint8_t> gpu)
+{
+	_files.push_back({id, type, std::move(main), std::move(stream), std::move(gpu)});
+}
+
+size_t hellextractor::synthetic::container::files() const
+{
+	return _files.size();
+}
+
+void hellextractor::synthetic::container::write(std::filesystem::path path) const
+{
+	typedef stingray::data_110000F0 data_t;
+
+	// Types are listed in order, with the number of files of each type.
+	std::map<uint64_t, uint32_t> types;
+	for (auto const& file : _files) {
+		types[file.type]++;
+	}
+
+	size_t data_offset = sizeof(data_t::header_t) + sizeof(data_t::type_t) * types.size() + sizeof(data_t::file_t) * _files.size();
+	size_t main_size   = align(data_offset, 16);
+	size_t stream_size = 0;
+	size_t gpu_size    = 0;
+
+	std::vector<data_t::file_t> table;
+	table.reserve(_files.size());
+	for (size_t idx = 0; idx < _files.size(); idx++) {
+		auto const&    file  = _files[idx];
+		data_t::file_t entry = {};
+		entry.id             = file.id;
+		entry.type           = file.type;
+		entry.offset         = static_cast<uint32_t>(main_size);
+		entry.stream_offset  = static_cast<uint32_t>(file.stream.empty() ? 0 : stream_size);
+		entry.gpu_offset     = static_cast<uint32_t>(file.gpu.empty() ? 0 : gpu_size);
+		entry.size           = static_cast<uint32_t>(file.main.size());
+		entry.stream_size    = static_cast<uint32_t>(file.stream.size());
+		entry.gpu_size       = static_cast<uint32_t>(file.gpu.size());
+		entry.index          = static_cast<uint32_t>(idx);
+		table.push_back(entry);
+		main_size = align(main_size + file.main.size(), 16);
+		if (!file.stream.empty()) {
+			stream_size = align(stream_size + file.stream.size(), 16);
+		}
+		if (!file.gpu.empty()) {
+			gpu_size = align(gpu_size + file.gpu.size(), 256);
+		}
+	}
+	if ((main_size > UINT32_MAX) || (stream_size > UINT32_MAX) || (gpu_size > UINT32_MAX)) {
+		throw std::overflow_error("offset+size > size");
+	}
+
+	data_t::header_t header = {};
+	header.magic_number                       = 0xF0000011;
+	header.types                              = static_cast<uint32_t>(types.size());
+	header.files                              = static_cast<uint32_t>(_files.size());
+	header.gpu_resources_size_aligned_to_256b = static_cast<uint32_t>(align(gpu_size, 256));
+
+	std::vector<uint8_t> main;
+	main.reserve(main_size);
+	put(main, header);
+	for (auto const& kv : types) {
+		data_t::type_t type      = {};
+		type.id                  = kv.first;
+		type.count               = kv.second;
+		type.__unk03_always_0x10 = 0x10;
+		type.__unk04_always_0x40 = 0x40;
+		put(main, type);
+	}
+	for (auto const& file : table) {
+		put(main, file);
+	}
+
+	std::vector<uint8_t> stream;
+	std::vector<uint8_t> gpu;
+	stream.reserve(stream_size);
+	gpu.reserve(gpu_size);
+	for (auto const& file : _files) {
+		main.resize(align(main.size(), 16));
+		main.insert(main.end(), file.main.begin(), file.main.end());
+		if (!file.stream.empty()) {
+			stream.insert(stream.end(), file.stream.begin(), file.stream.end());
+			stream.resize(align(stream.size(), 16));
+		}
+		if (!file.gpu.empty()) {
+			gpu.insert(gpu.end(), file.gpu.begin(), file.gpu.end());
+			gpu.resize(align(gpu.size(), 256));
+		}
+	}
+
+	auto write_file = [](std::filesystem::path const& path, std::vector<uint8_t> const& data) {
+		std::ofstream file{path, std::ios::binary | std::ios::trunc | std::ios::out};
+		if (!file.is_open()) {
+			throw std::runtime_error(string_printf("Failed to open file '%s'", path.generic_u8string().c_str()));
+		}
+		file.write(reinterpret_cast<char const*>(data.data()), static_cast<std::streamsize>(data.size()));
+		if (!file.good()) {
+			throw std::runtime_error(string_printf("Failed to write file '%s'", path.generic_u8string().c_str()));
+		}
+	};
+	write_file(path, main);
+	if (!stream.empty()) {
+		write_file(std::filesystem::path{path}.replace_extension("stream"), stream);
+	}
+	if (!gpu.empty()) {
+		write_file(std::filesystem::path{path}.replace_extension("gpu_resources"), gpu);
+	}
+}
+
+hellextractor::synthetic::generator::~generator() {}
+
+hellextractor::synthetic::generator::generator(options_t options) : _options(options), _random(options.seed), _hasher(hellextractor::hash::instance::create(hellextractor::hash::type::MURMUR_64A)), _files(), _names()
+{
+	if ((_options.min_size == 0) || (_options.min_size > _options.max_size)) {
+		throw std::runtime_error("The minimum size must be between 1 and the maximum size");
+	}
+	if (std::all_of(_options.mix.begin(), _options.mix.end(), [](uint32_t weight) { return weight == 0; })) {
+		throw std::runtime_error("At least one kind must have a weight above zero");
+	}
+}
+
+std::vector<std::filesystem::path> hellextractor::synthetic::generator::generate(std::filesystem::path directory)
+{
+	std::filesystem::create_directories(directory);
+
+	std::vector<std::filesystem::path> paths;
+	for (size_t idx = 0; idx < _options.containers; idx++) {
+		container files;
+
+		// Duplicates are only taken from earlier containers, like patches that ship a file again.
+		size_t earlier = _files.size();
+		for (size_t jdx = 0; jdx < _options.files; jdx++) {
+			bool   duplicate = (earlier > 0) && (next_chance(_random) < _options.duplicates);
+			file_t file      = duplicate ? _files[next_below(_random, earlier)] : next();
+			build(files, file.id, file.type, file.category, file.size, file.seed);
+		}
+
+		auto path = directory / string_printf("%016" PRIx64, next_random(_random));
+		files.write(path);
+		paths.push_back(path);
+	}
+
+	// Not every name is known, so that untranslated files are covered too.
+	std::ofstream names{directory / "names.txt", std::ios::trunc | std::ios::out};
+	if (!names.is_open()) {
+		throw std::runtime_error(string_printf("Failed to open file '%s'", (directory / "names.txt").generic_u8string().c_str()));
+	}
+	names << "// Synthetic file names, seed " << _options.seed << std::endl;
+	for (auto const& name : _names) {
+		names << name << std::endl;
+	}
+
+	return paths;
+}
+
+void hellextractor::synthetic::generator::build(container& container, stingray::hash_t id, stingray::hash_t type, kind category, size_t size, uint64_t seed)
+{
+	uint64_t state = seed;
+	switch (category) {
+	case kind::TEXTURE:
+		build_texture(container, id, type, size, state);
+		break;
+	case kind::BIK:
+		build_bik(container, id, type, size, state);
+		break;
+	case kind::UNIT:
+		build_unit(container, id, type, size, state);
+		break;
+	case kind::WWISE_STREAM:
+		build_wwise_stream(container, id, type, size, state);
+		break;
+	case kind::WWISE_BANK:
+		build_wwise_bank(container, id, type, size, state);
+		break;
+	default:
+		container.add(id, type, random_bytes(size, state), {}, {});
+		break;
+	}
+}
+
+hellextractor::synthetic::generator::file_t hellextractor::synthetic::generator::next()
+{
+	// Walk the weights until the picked point falls into one of them.
+	uint64_t pick  = next_below(_random, std::accumulate(_options.mix.begin(), _options.mix.end(), uint64_t(0)));
+	size_t   index = 0;
+	while (pick >= _options.mix[index]) {
+		pick -= _options.mix[index++];
+	}
+
+	auto category = static_cast<kind>(index);
+	auto size     = next_size(_random, _options.min_size, _options.max_size);
+	auto seed     = next_random(_random);
+
+	// Ids are hashed from unique names, the same way the name databases hash them.
+	auto file_name = string_printf("synthetic/%s/%08zx", name(category).data(), _files.size());
+	auto hash      = _hasher->hash(file_name.data(), file_name.size());
+	if (next_chance(_random) < _options.named) {
+		_names.push_back(file_name);
+	}
+
+	_files.push_back({
+		.id       = *reinterpret_cast<uint64_t const*>(hash.data()),
+		.type     = type(category, seed),
+		.category = category,
+		.size     = size,
+		.seed     = seed,
+	});
+	return _files.back();
+}
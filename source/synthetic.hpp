@@ -0,0 +1,114 @@
+// Copyright 2024 Michael Fabian 'Xaymar' Dirks <info@xaymar.com>
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#pragma once
+#include <array>
+#include <cinttypes>
+#include <cstddef>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "hasher.hpp"
+#include "stingray.hpp"
+
+namespace hellextractor::synthetic {
+	/** Kinds of files the generator knows how to build. */
+	enum class kind : size_t {
+		TEXTURE,
+		BIK,
+		UNIT,
+		WWISE_STREAM,
+		WWISE_BANK,
+		OTHER,
+
+		_COUNT,
+	};
+
+	struct options_t {
+		uint64_t seed       = 1;
+		size_t   containers = 4;
+		size_t   files      = 1000; // Per container.
+		double   duplicates = 0.1; // Share of files that also appear in an earlier container.
+		double   named      = 0.9; // Share of file names that are written to names.txt.
+		size_t   min_size   = 256; // Payload sizes are roughly log-uniform between min_size and max_size.
+		size_t   max_size   = 256 * 1024;
+
+		// Relative weights of each kind.
+		std::array<uint32_t, static_cast<size_t>(kind::_COUNT)> mix = {4, 1, 2, 3, 1, 6};
+	};
+
+	/** Parse a type mix such as "texture=4,bik=1,other=0". Kinds that aren't listed keep their weight. */
+	void parse_mix(std::string_view text, options_t& options);
+
+	std::string_view name(kind value);
+
+	/** Type hash of a kind. OTHER has no single type, and returns one of a few types no converter handles. */
+	stingray::hash_t type(kind value, uint64_t seed = 0);
+
+	/** A data_110000F0 container which is built in memory, then written out with its .stream and .gpu_resources. */
+	class container {
+		struct file_t {
+			stingray::hash_t     id;
+			stingray::hash_t     type;
+			std::vector<uint8_t> main;
+			std::vector<uint8_t> stream;
+			std::vector<uint8_t> gpu;
+		};
+
+		std::vector<file_t> _files;
+
+		public:
+		~container();
+		container();
+
+		void add(stingray::hash_t id, stingray::hash_t type, std::vector<uint8_t> main, std::vector<uint8_t> stream, std::vector<uint8_t> gpu);
+
+		size_t files() const;
+
+		/** Write the container, and the .stream and .gpu_resources files if any file has data in them. */
+		void write(std::filesystem::path path) const;
+	};
+
+	/** Generates reproducible synthetic installs: the same options always produce the same bytes, with any compiler and standard library. */
+	class generator {
+		struct file_t {
+			stingray::hash_t id;
+			stingray::hash_t type;
+			kind             category;
+			size_t           size;
+			uint64_t         seed;
+		};
+
+		options_t                                      _options;
+		uint64_t                                       _random; // SplitMix64 state.
+		std::shared_ptr<hellextractor::hash::instance> _hasher;
+		std::vector<file_t>                            _files;
+		std::vector<std::string>                       _names;
+
+		public:
+		~generator();
+		generator(options_t options);
+
+		/** Generate all containers into the directory, along with a names.txt name database.
+		 *
+		 * @return Paths of the generated containers.
+		 */
+		std::vector<std::filesystem::path> generate(std::filesystem::path directory);
+
+		/** Build the payload of a single file. */
+		static void build(container& container, stingray::hash_t id, stingray::hash_t type, kind category, size_t size, uint64_t seed);
+
+		private:
+		file_t next();
+	};
+} // namespace hellextractor::synthetic
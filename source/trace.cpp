@@ -0,0 +1,149 @@
+// Copyright 2024 Michael Fabian 'Xaymar' Dirks <info@xaymar.com>
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "trace.hpp"
+#include <atomic>
+#include <fstream>
+#include <list>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+#include "string_printf.hpp"
+
+#include <nlohmann/json.hpp>
+
+struct event_t {
+	std::string_view name;
+	int64_t          start; // Nanoseconds since the trace was enabled.
+	int64_t          duration; // Nanoseconds.
+	std::string      detail;
+};
+
+struct buffer_t {
+	uint64_t             thread;
+	std::string          name;
+	std::vector<event_t> events;
+};
+
+static std::atomic<bool>                         trace_enabled = false;
+static hellextractor::trace::clock_t::time_point trace_start;
+static std::mutex                                trace_lock;
+static std::list<buffer_t>                       trace_buffers; // Stable addresses, and outlives the threads.
+static thread_local buffer_t*                    trace_local = nullptr;
+
+static std::string quote(std::string const& text)
+{
+	// Details may contain file names that aren't valid UTF-8.
+	return nlohmann::ordered_json(text).dump(-1, ' ', false, nlohmann::ordered_json::error_handler_t::replace);
+}
+
+static buffer_t& local()
+{
+	if (!trace_local) {
+		std::unique_lock<std::mutex> ul(trace_lock);
+		trace_local         = &trace_buffers.emplace_back();
+		trace_local->thread = trace_buffers.size();
+		trace_local->name   = string_printf("thread %" PRIu64, trace_local->thread);
+	}
+	return *trace_local;
+}
+
+static int64_t nanoseconds(hellextractor::trace::clock_t::duration duration)
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+}
+
+static std::string microseconds(int64_t nanoseconds)
+{
+	return string_printf("%" PRId64 ".%03" PRId64, nanoseconds / 1000, nanoseconds % 1000);
+}
+
+hellextractor::trace::span::~span()
+{
+	if (_active) {
+		complete(_name, _start, clock_t::now(), std::move(_detail));
+	}
+}
+
+hellextractor::trace::span::span(std::string_view name) : _name(name), _detail(), _start(), _active(enabled())
+{
+	if (_active) {
+		_start = clock_t::now();
+	}
+}
+
+hellextractor::trace::span::operator bool() const
+{
+	return _active;
+}
+
+void hellextractor::trace::span::detail(std::string value)
+{
+	if (_active) {
+		_detail = std::move(value);
+	}
+}
+
+void hellextractor::trace::enable()
+{
+	trace_start   = clock_t::now();
+	local().name  = "main";
+	trace_enabled = true;
+}
+
+bool hellextractor::trace::enabled()
+{
+	return trace_enabled.load(std::memory_order_relaxed);
+}
+
+void hellextractor::trace::complete(std::string_view name, clock_t::time_point start, clock_t::time_point end, std::string detail)
+{
+	if (!enabled()) {
+		return;
+	}
+	local().events.push_back({name, nanoseconds(start - trace_start), nanoseconds(end - start), std::move(detail)});
+}
+
+void hellextractor::trace::name_thread(std::string name)
+{
+	if (enabled()) {
+		local().name = std::move(name);
+	}
+}
+
+void hellextractor::trace::write(std::filesystem::path const& path)
+{
+	std::ofstream stream{path, std::ios::trunc | std::ios::out | std::ios::binary};
+	if (!stream.is_open()) {
+		throw std::runtime_error(string_printf("Failed to open trace file '%s' for writing.", path.generic_string().c_str()));
+	}
+
+	// Written by hand instead of building one nlohmann::ordered_json document, as there can be millions of events.
+	std::unique_lock<std::mutex> ul(trace_lock);
+	std::string                  separator = "\n";
+	stream << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+	for (auto const& buffer : trace_buffers) {
+		stream << separator << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer.thread << ",\"args\":{\"name\":" << quote(buffer.name) << "}}";
+		separator = ",\n";
+		for (auto const& event : buffer.events) {
+			stream << separator << "{\"name\":" << quote(std::string(event.name)) << ",\"cat\":\"hellextractor\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer.thread;
+			stream << ",\"ts\":" << microseconds(event.start) << ",\"dur\":" << microseconds(event.duration);
+			if (!event.detail.empty()) {
+				stream << ",\"args\":{\"detail\":" << quote(event.detail) << "}";
+			}
+			stream << "}";
+		}
+	}
+	stream << "\n]}\n";
+	if (!stream) {
+		throw std::runtime_error(string_printf("Failed to write trace file '%s'.", path.generic_string().c_str()));
+	}
+}
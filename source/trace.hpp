@@ -0,0 +1,63 @@
+// Copyright 2024 Michael Fabian 'Xaymar' Dirks <info@xaymar.com>
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#pragma once
+#include <chrono>
+#include <cinttypes>
+#include <cstddef>
+#include <filesystem>
+#include <string>
+#include <string_view>
+
+namespace hellextractor {
+	/** Chrome trace event recorder, for chrome://tracing and Perfetto.
+	 *
+	 * Every thread records complete events into its own buffer, so recording never takes a lock. While disabled, spans
+	 * only check a flag and never read the clock. Names must be string literals, as only the view is kept.
+	 */
+	class trace {
+		public:
+		typedef std::chrono::steady_clock clock_t;
+
+		/** Records the time from construction to destruction as an event on the current thread. */
+		class span {
+			std::string_view    _name;
+			std::string         _detail;
+			clock_t::time_point _start;
+			bool                _active;
+
+			public:
+			~span();
+			span(std::string_view name);
+			span(span const&) = delete;
+
+			/** True if the span is being recorded, so details are only built when needed. */
+			explicit operator bool() const;
+
+			/** Attach a detail, such as the file being worked on. */
+			void detail(std::string value);
+		};
+
+		/** Start recording. Events from before this are lost. */
+		static void enable();
+
+		static bool enabled();
+
+		/** Record an event on the current thread. */
+		static void complete(std::string_view name, clock_t::time_point start, clock_t::time_point end, std::string detail = {});
+
+		/** Name the current thread in the trace. */
+		static void name_thread(std::string name);
+
+		/** Write all recorded events as JSON. Threads that recorded anything must be done by now. */
+		static void write(std::filesystem::path const& path);
+	};
+} // namespace hellextractor
@@ -0,0 +1,176 @@
+// Copyright 2024 Michael Fabian 'Xaymar' Dirks <info@xaymar.com>
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "vertex.hpp"
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+#include <set>
+#include <unordered_map>
+#include "half.hpp"
+#include "string_printf.hpp"
+
+using stingray::unit::element_format;
+using stingray::unit::element_type;
+
+static constexpr uint32_t gltf_unsigned_byte = 5121;
+static constexpr uint32_t gltf_float         = 5126;
+
+// Vertices converted per step, sized to keep the scratch buffers on the stack.
+static constexpr size_t kernel_block = 256;
+
+/** Copy Size bytes per vertex. */
+template<size_t Size>
+static void copy_kernel(void* out, uint8_t const* in, size_t stride, size_t count)
+{
+	auto ptr = reinterpret_cast<uint8_t*>(out);
+	for (size_t idx = 0; idx < count; idx++) {
+		memcpy(ptr + idx * Size, in + idx * stride, Size);
+	}
+}
+
+/** Convert a pair of half floats per vertex into Components floats, padding with zeros. */
+template<size_t Components>
+static void half2_kernel(void* out, uint8_t const* in, size_t stride, size_t count)
+{
+	static_assert(Components >= 2);
+	auto     ptr = reinterpret_cast<float*>(out);
+	uint16_t halves[kernel_block * 2];
+	float    floats[kernel_block * 2];
+	for (size_t base = 0; base < count; base += kernel_block) {
+		size_t block = std::min(kernel_block, count - base);
+		for (size_t idx = 0; idx < block; idx++) {
+			memcpy(&halves[idx * 2], in + (base + idx) * stride, sizeof(uint16_t) * 2);
+		}
+		if constexpr (Components == 2) {
+			half_to_float(ptr + base * 2, halves, block * 2);
+		} else {
+			half_to_float(floats, halves, block * 2);
+			for (size_t idx = 0; idx < block; idx++) {
+				float* vertex = ptr + (base + idx) * Components;
+				vertex[0]     = floats[idx * 2];
+				vertex[1]     = floats[idx * 2 + 1];
+				for (size_t c = 2; c < Components; c++) {
+					vertex[c] = 0.f;
+				}
+			}
+		}
+	}
+}
+
+static void assign(hellextractor::vertex::attribute_t& attribute, bool native, hellextractor::vertex::kernel_t kernel, uint32_t component_type, char const* type, size_t size)
+{
+	attribute.native         = native;
+	attribute.kernel         = kernel;
+	attribute.component_type = component_type;
+	attribute.type           = type;
+	attribute.size           = size;
+}
+
+/** Pick the kernel and output type for an element. Returns false if it can't be represented. */
+static bool describe(hellextractor::vertex::attribute_t& attribute, element_format format, bool position)
+{
+	switch (format) {
+	case element_format::F32VEC2:
+		assign(attribute, true, copy_kernel<8>, gltf_float, "VEC2", 8);
+		return !position;
+	case element_format::F32VEC3:
+		assign(attribute, true, copy_kernel<12>, gltf_float, "VEC3", 12);
+		return true;
+	case element_format::F16VEC2: // glTF has no half floats, so these are always converted.
+		if (position) {
+			assign(attribute, false, half2_kernel<3>, gltf_float, "VEC3", 12);
+		} else {
+			assign(attribute, false, half2_kernel<2>, gltf_float, "VEC2", 8);
+		}
+		return true;
+	case element_format::_4_4B_WIDE:
+	case element_format::_24_4B_WIDE:
+	case element_format::_25_4B_WIDE:
+	case element_format::_26_4B_WIDE:
+		assign(attribute, true, copy_kernel<4>, gltf_unsigned_byte, "VEC4", 4);
+		return !position;
+	default:
+		return false;
+	}
+}
+
+static hellextractor::vertex::layout_t build(stingray::unit::datatype_t const& datatype)
+{
+	hellextractor::vertex::layout_t layout = {false, 0, 0, {}};
+	if ((datatype.elements == 0) || (datatype.elements > 16)) {
+		return layout;
+	}
+
+	bool                  position = false;
+	std::set<std::string> names;
+	for (size_t idx = 0; idx < datatype.elements; idx++) {
+		auto const& element = datatype.element[idx];
+		size_t      size    = stingray::unit::element_size(element.format);
+		if (size == 0) {
+			return layout;
+		}
+		size_t offset = layout.stride;
+		layout.stride += size;
+
+		hellextractor::vertex::attribute_t attribute = {};
+		attribute.element                            = idx;
+		attribute.offset                             = offset;
+
+		bool is_position = false;
+		if (!position && (element.type == element_type::POSITION) && (element.layer == 0) && ((element.format == element_format::F32VEC3) || (element.format == element_format::F16VEC2))) {
+			attribute.name = "POSITION";
+			is_position    = true;
+		} else if ((element.type == element_type::TEXCOORD) && ((element.format == element_format::F32VEC2) || (element.format == element_format::F16VEC2))) {
+			attribute.name = string_printf("TEXCOORD_%" PRIu32, element.layer);
+		} else {
+			// Anything without a matching glTF semantic is kept as an application specific attribute.
+			attribute.name = string_printf("_TYPE%" PRIu32 "_%" PRIu32, static_cast<uint32_t>(element.type), element.layer);
+		}
+		if (names.count(attribute.name) || !describe(attribute, element.format, is_position)) {
+			continue;
+		}
+		names.insert(attribute.name);
+
+		if (is_position) {
+			position        = true;
+			layout.position = layout.attributes.size();
+		}
+		layout.attributes.push_back(std::move(attribute));
+	}
+
+	layout.valid = position;
+	return layout;
+}
+
+hellextractor::vertex::layout_t const& hellextractor::vertex::layout(stingray::unit::datatype_t const& datatype)
+{
+	static std::mutex                                 lock;
+	static std::unordered_map<std::string, layout_t> cache;
+
+	// Keyed on the type, format and layer of every element, which is all that the layout depends on.
+	std::string key;
+	size_t      elements = std::min<size_t>(datatype.elements, 16);
+	key.reserve(sizeof(uint32_t) * (1 + 3 * elements));
+	auto append = [&key](uint32_t v) { key.append(reinterpret_cast<char const*>(&v), sizeof(v)); };
+	append(datatype.elements);
+	for (size_t idx = 0; idx < elements; idx++) {
+		append(static_cast<uint32_t>(datatype.element[idx].type));
+		append(static_cast<uint32_t>(datatype.element[idx].format));
+		append(datatype.element[idx].layer);
+	}
+
+	std::unique_lock<std::mutex> ul(lock);
+	if (auto kv = cache.find(key); kv != cache.end()) {
+		return kv->second;
+	}
+	return cache.emplace(std::move(key), build(datatype)).first->second;
+}
@@ -0,0 +1,52 @@
+// Copyright 2024 Michael Fabian 'Xaymar' Dirks <info@xaymar.com>
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#pragma once
+#include <cinttypes>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "stingray_unit.hpp"
+
+namespace hellextractor::vertex {
+	/** Decode one element of count vertices, found every stride bytes, into a tightly packed output stream. */
+	typedef void (*kernel_t)(void* out, uint8_t const* in, size_t stride, size_t count);
+
+	/** How a datatype element maps onto a glTF vertex attribute. */
+	struct attribute_t {
+		std::string name;
+		size_t      element;
+		size_t      offset;
+
+		// Whether the source data can be referenced as-is. The kernel can always produce a packed copy.
+		bool     native;
+		kernel_t kernel;
+
+		uint32_t    component_type;
+		char const* type;
+		size_t      size;
+	};
+
+	struct layout_t {
+		bool   valid;
+		size_t stride;
+		size_t position;
+
+		std::vector<attribute_t> attributes;
+	};
+
+	/** Get the decoding layout for a datatype.
+	 *
+	 * Layouts are built once per distinct element array and cached for the lifetime of the process, so the element
+	 * formats are only looked at once per datatype instead of once per vertex. The result is never invalidated.
+	 */
+	layout_t const& layout(stingray::unit::datatype_t const& datatype);
+} // namespace hellextractor::vertex
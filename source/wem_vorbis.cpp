@@ -0,0 +1,653 @@
+// Copyright 2024 Michael Fabian 'Xaymar' Dirks <info@xaymar.com>
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "wem_vorbis.hpp"
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string_view>
+#include "string_printf.hpp"
+
+static constexpr std::string_view vendor = "Hellextractor";
+
+static uint16_t read16(uint8_t const* ptr)
+{
+	uint16_t value;
+	memcpy(&value, ptr, sizeof(value));
+	return value;
+}
+
+static uint32_t read32(uint8_t const* ptr)
+{
+	uint32_t value;
+	memcpy(&value, ptr, sizeof(value));
+	return value;
+}
+
+static uint32_t ilog(uint32_t value)
+{
+	uint32_t bits = 0;
+	for (; value; value >>= 1) {
+		++bits;
+	}
+	return bits;
+}
+
+/** Number of quantized values in a lookup type 1 codebook, see _book_maptype1_quantvals in libvorbis. */
+static uint32_t maptype1_quantvals(uint32_t entries, uint32_t dimensions)
+{
+	if (dimensions == 0) {
+		throw std::runtime_error("Codebook has no dimensions.");
+	}
+	uint32_t vals = 1;
+	while (true) {
+		uint64_t acc  = 1;
+		uint64_t acc1 = 1;
+		for (uint32_t idx = 0; idx < dimensions; ++idx) {
+			acc *= vals;
+			acc1 *= vals + 1;
+			if (acc1 > entries) {
+				break;
+			}
+		}
+		if ((acc <= entries) && (acc1 > entries)) {
+			return vals;
+		} else if (acc > entries) {
+			--vals;
+		} else {
+			++vals;
+		}
+	}
+}
+
+namespace {
+	/** Reads bits least significant first, as both Vorbis and Wwise pack them. */
+	class bit_reader {
+		uint8_t const* _data;
+		size_t         _size;
+		size_t         _position;
+
+		public:
+		bit_reader(uint8_t const* data, size_t size) : _data(data), _size(size * 8), _position(0) {}
+
+		uint32_t get(size_t bits)
+		{
+			if ((_size - _position) < bits) {
+				throw std::runtime_error("Unexpected end of packet.");
+			}
+
+			uint32_t value = 0;
+			for (size_t idx = 0; idx < bits; ++idx, ++_position) {
+				value |= static_cast<uint32_t>((_data[_position >> 3] >> (_position & 7)) & 1) << idx;
+			}
+			return value;
+		}
+
+		size_t position() const
+		{
+			return _position;
+		}
+	};
+
+	class bit_writer {
+		std::vector<uint8_t>& _out;
+		uint8_t               _bit;
+
+		public:
+		bit_writer(std::vector<uint8_t>& out) : _out(out), _bit(0) {}
+
+		void put(uint32_t value, size_t bits)
+		{
+			for (size_t idx = 0; idx < bits; ++idx) {
+				if (_bit == 0) {
+					_out.push_back(0);
+				}
+				_out.back() |= ((value >> idx) & 1) << _bit;
+				_bit = (_bit + 1) & 7;
+			}
+		}
+
+		/** Append whole bytes at the current bit position. */
+		void bytes(uint8_t const* data, size_t size)
+		{
+			if (_bit == 0) {
+				_out.insert(_out.end(), data, data + size);
+				return;
+			}
+
+			for (size_t idx = 0; idx < size; ++idx) {
+				_out.back() |= data[idx] << _bit;
+				_out.push_back(data[idx] >> (8 - _bit));
+			}
+		}
+
+		/** Copy bits from the reader to the output unchanged. */
+		uint32_t copy(bit_reader& reader, size_t bits)
+		{
+			uint32_t value = reader.get(bits);
+			put(value, bits);
+			return value;
+		}
+
+		void header(uint8_t type)
+		{
+			put(type, 8);
+			bytes(reinterpret_cast<uint8_t const*>("vorbis"), 6);
+		}
+	};
+} // namespace
+
+static constexpr auto crc_table = []() {
+	std::array<uint32_t, 256> table{};
+	for (uint32_t idx = 0; idx < 256; ++idx) {
+		uint32_t crc = idx << 24;
+		for (size_t bit = 0; bit < 8; ++bit) {
+			crc = (crc & 0x80000000) ? ((crc << 1) ^ 0x04C11DB7) : (crc << 1);
+		}
+		table[idx] = crc;
+	}
+	return table;
+}();
+
+static uint32_t ogg_crc(uint32_t crc, uint8_t const* data, size_t size)
+{
+	for (size_t idx = 0; idx < size; ++idx) {
+		crc = (crc << 8) ^ crc_table[((crc >> 24) ^ data[idx]) & 0xFF];
+	}
+	return crc;
+}
+
+/** Size of a packet written on pages of its own. */
+static size_t ogg_size(size_t size)
+{
+	size_t segments = size / 255 + 1;
+	size_t pages    = (segments + 254) / 255;
+	return size + segments + pages * 27;
+}
+
+/** Write a packet on pages of its own, continuing it on more pages if it needs more than 255 lacing values. */
+static void ogg_write(std::ostream& stream, uint32_t& sequence, uint8_t const* data, size_t size, uint64_t granule, bool first, bool last)
+{
+	size_t segments = size / 255 + 1;
+	size_t segment  = 0;
+	do {
+		size_t  count = std::min<size_t>(segments - segment, 255);
+		bool    ends  = (segment + count) == segments;
+		uint8_t page[27 + 255];
+
+		memcpy(page, "OggS", 4);
+		page[4] = 0;
+		page[5] = (segment ? 0x01 : 0x00) | ((first && !segment) ? 0x02 : 0x00) | ((last && ends) ? 0x04 : 0x00);
+
+		uint64_t position = ends ? granule : ~0ull;
+		uint32_t serial   = 1;
+		uint32_t crc      = 0;
+		memcpy(page + 6, &position, sizeof(position));
+		memcpy(page + 14, &serial, sizeof(serial));
+		memcpy(page + 18, &sequence, sizeof(sequence));
+		memcpy(page + 22, &crc, sizeof(crc));
+		page[26] = static_cast<uint8_t>(count);
+
+		size_t body = 0;
+		for (size_t idx = 0; idx < count; ++idx) {
+			size_t lace    = std::min<size_t>(size - (segment + idx) * 255, 255);
+			page[27 + idx] = static_cast<uint8_t>(lace);
+			body += lace;
+		}
+
+		uint8_t const* payload = data + segment * 255;
+		crc                    = ogg_crc(ogg_crc(0, page, 27 + count), payload, body);
+		memcpy(page + 22, &crc, sizeof(crc));
+
+		stream.write(reinterpret_cast<char const*>(page), 27 + count);
+		stream.write(reinterpret_cast<char const*>(payload), body);
+
+		++sequence;
+		segment += count;
+	} while (segment < segments);
+}
+
+static void rebuild_codebook(bit_writer& writer, uint8_t const* data, size_t size)
+{
+	bit_reader reader{data, size};
+
+	uint32_t dimensions = reader.get(4);
+	uint32_t entries    = reader.get(14);
+	writer.put(0x564342, 24);
+	writer.put(dimensions, 16);
+	writer.put(entries, 24);
+
+	if (writer.copy(reader, 1)) { // Ordered
+		writer.copy(reader, 5);
+		uint32_t entry = 0;
+		while (entry < entries) {
+			entry += writer.copy(reader, ilog(entries - entry));
+		}
+		if (entry > entries) {
+			throw std::runtime_error("Codebook has too many ordered entries.");
+		}
+	} else {
+		uint32_t length_bits = reader.get(3);
+		uint32_t sparse      = reader.get(1);
+		if ((length_bits == 0) || (length_bits > 5)) {
+			throw std::runtime_error("Codebook has an invalid codeword length size.");
+		}
+		writer.put(sparse, 1);
+		for (uint32_t idx = 0; idx < entries; ++idx) {
+			if (!sparse || writer.copy(reader, 1)) {
+				writer.put(reader.get(length_bits), 5);
+			}
+		}
+	}
+
+	uint32_t lookup = reader.get(1);
+	writer.put(lookup, 4);
+	if (lookup == 1) {
+		writer.copy(reader, 32); // Minimum
+		writer.copy(reader, 32); // Delta
+		uint32_t value_bits = writer.copy(reader, 4) + 1;
+		writer.copy(reader, 1); // Sequence
+		for (uint32_t idx = 0, edx = maptype1_quantvals(entries, dimensions); idx < edx; ++idx) {
+			writer.copy(reader, value_bits);
+		}
+	}
+
+	if ((reader.position() / 8 + 1) != size) {
+		throw std::runtime_error("Codebook size doesn't match its contents.");
+	}
+}
+
+hellextractor::vorbis_codebooks::~vorbis_codebooks() {}
+
+hellextractor::vorbis_codebooks::vorbis_codebooks(std::filesystem::path const& path)
+{
+	std::ifstream file{path, std::ios::binary | std::ios::in};
+	if (!file.is_open()) {
+		throw std::runtime_error(string_printf("Failed to open codebook library '%s'.", path.generic_string().c_str()));
+	}
+	_data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+
+	if (_data.size() < 4) {
+		throw std::runtime_error("Codebook library is too small.");
+	}
+	uint32_t table = read32(_data.data() + _data.size() - 4);
+	if ((table > (_data.size() - 4)) || ((_data.size() - table) % 4)) {
+		throw std::runtime_error("Codebook library has an invalid offset table.");
+	}
+
+	// The last entry of the table is the table's own offset, which ends the last codebook.
+	_offsets.resize((_data.size() - table) / 4);
+	for (size_t idx = 0; idx < _offsets.size(); ++idx) {
+		_offsets[idx] = read32(_data.data() + table + idx * 4);
+		if ((_offsets[idx] > table) || (idx && (_offsets[idx] < _offsets[idx - 1]))) {
+			throw std::runtime_error("Codebook library has an invalid offset table.");
+		}
+	}
+	_data.resize(table);
+}
+
+size_t hellextractor::vorbis_codebooks::size() const
+{
+	return _offsets.size() - 1;
+}
+
+std::pair<uint8_t const*, size_t> hellextractor::vorbis_codebooks::at(size_t id) const
+{
+	if (id >= size()) {
+		throw std::out_of_range("idx >= edx");
+	}
+	return {_data.data() + _offsets[id], _offsets[id + 1] - _offsets[id]};
+}
+
+hellextractor::wem_vorbis::~wem_vorbis() {}
+
+hellextractor::wem_vorbis::wem_vorbis(uint8_t const* data, size_t size, vorbis_codebooks const& codebooks) : _mode_bits(0), _mod_packets(false), _size(0)
+{
+	if ((size < 12) || (memcmp(data, "RIFF", 4) != 0) || (memcmp(data + 8, "WAVE", 4) != 0)) {
+		throw std::runtime_error("Not a little endian RIFF WAVE file.");
+	}
+
+	uint8_t const* fmt        = nullptr;
+	size_t         fmt_size   = 0;
+	uint8_t const* vorb       = nullptr;
+	size_t         vorb_size  = 0;
+	uint8_t const* chunk      = nullptr;
+	size_t         chunk_size = 0;
+	for (size_t offset = 12; (offset < size) && ((size - offset) >= 8);) {
+		uint8_t const* ptr    = data + offset;
+		size_t         length = read32(ptr + 4);
+		if (length > (size - offset - 8)) {
+			break;
+		}
+		if (memcmp(ptr, "fmt ", 4) == 0) {
+			fmt      = ptr + 8;
+			fmt_size = length;
+		} else if (memcmp(ptr, "vorb", 4) == 0) {
+			vorb      = ptr + 8;
+			vorb_size = length;
+		} else if (memcmp(ptr, "data", 4) == 0) {
+			chunk      = ptr + 8;
+			chunk_size = length;
+		}
+		offset += 8 + length + (length & 1);
+	}
+	if (!fmt || !chunk || (fmt_size < 0x12)) {
+		throw std::runtime_error("RIFF file is missing the 'fmt ' or 'data' chunk.");
+	}
+	if (read16(fmt) != 0xFFFF) {
+		throw std::runtime_error("RIFF file is not Wwise Vorbis.");
+	}
+	if (!vorb && (fmt_size == 0x42)) { // Newer versions embed the 'vorb' chunk in 'fmt '.
+		vorb      = fmt + 0x18;
+		vorb_size = 0x2A;
+	}
+
+	uint8_t  channels    = static_cast<uint8_t>(read16(fmt + 2));
+	uint32_t sample_rate = read32(fmt + 4);
+	uint32_t avg_bytes   = read32(fmt + 8);
+
+	// Only the layouts that store the block sizes are supported, older ones still carry the full Vorbis headers.
+	uint32_t setup_offset;
+	uint32_t audio_offset;
+	uint8_t  blocksize_0;
+	uint8_t  blocksize_1;
+	size_t   packet_header;
+	if (!vorb) {
+		throw std::runtime_error("RIFF file is missing the 'vorb' chunk.");
+	} else if (vorb_size == 0x2A) {
+		uint32_t mod_signal = read32(vorb + 0x04);
+		_mod_packets        = (mod_signal != 0x4A) && (mod_signal != 0x4B) && (mod_signal != 0x69) && (mod_signal != 0x70);
+		setup_offset        = read32(vorb + 0x10);
+		audio_offset        = read32(vorb + 0x14);
+		blocksize_0         = vorb[0x28];
+		blocksize_1         = vorb[0x29];
+		packet_header       = 2;
+	} else if ((vorb_size == 0x32) || (vorb_size == 0x34)) {
+		setup_offset  = read32(vorb + 0x18);
+		audio_offset  = read32(vorb + 0x1C);
+		blocksize_0   = vorb[0x30];
+		blocksize_1   = vorb[0x31];
+		packet_header = 6;
+	} else {
+		throw std::runtime_error(string_printf("Unsupported 'vorb' chunk size %zu.", vorb_size));
+	}
+	uint32_t sample_count = read32(vorb);
+	if ((channels == 0) || (blocksize_0 < 6) || (blocksize_1 > 13) || (blocksize_0 > blocksize_1)) {
+		throw std::runtime_error("Invalid Wwise Vorbis stream parameters.");
+	}
+
+	// Identification header.
+	{
+		bit_writer writer{_identification};
+		writer.header(1);
+		writer.put(0, 32);
+		writer.put(channels, 8);
+		writer.put(sample_rate, 32);
+		writer.put(0, 32);
+		writer.put(avg_bytes * 8, 32);
+		writer.put(0, 32);
+		writer.put(blocksize_0, 4);
+		writer.put(blocksize_1, 4);
+		writer.put(1, 1);
+	}
+
+	// Comment header.
+	{
+		bit_writer writer{_comment};
+		writer.header(3);
+		writer.put(static_cast<uint32_t>(vendor.size()), 32);
+		writer.bytes(reinterpret_cast<uint8_t const*>(vendor.data()), vendor.size());
+		writer.put(0, 32);
+		writer.put(1, 1);
+	}
+
+	// Setup header, with the codebooks restored from the library.
+	if ((setup_offset > chunk_size) || ((chunk_size - setup_offset) < packet_header)) {
+		throw std::runtime_error("Setup packet is out of bounds.");
+	}
+	{
+		uint8_t const* ptr    = chunk + setup_offset;
+		size_t         length = read16(ptr);
+		if (length > (chunk_size - setup_offset - packet_header)) {
+			throw std::runtime_error("Setup packet is out of bounds.");
+		}
+		rebuild_setup(ptr + packet_header, length, channels, codebooks);
+	}
+
+	// Audio packets. Wwise doesn't store the packet type, nor the window flags of long blocks when using modified packets.
+	for (size_t offset = audio_offset; (offset <= chunk_size) && ((chunk_size - offset) >= packet_header);) {
+		uint8_t const* ptr    = chunk + offset;
+		size_t         length = read16(ptr);
+		if (length > (chunk_size - offset - packet_header)) {
+			break;
+		}
+		offset += packet_header + length;
+		if (length == 0) {
+			continue;
+		}
+
+		packet_t packet{ptr + packet_header, static_cast<uint32_t>(length), static_cast<uint32_t>(length), 0, 0, false, false};
+		packet.mode = (packet.data[0] >> (_mod_packets ? 0 : 1)) & ((1u << _mode_bits) - 1);
+		if (packet.mode >= _blockflags.size()) {
+			throw std::runtime_error("Audio packet uses an unknown mode.");
+		}
+		_packets.push_back(packet);
+	}
+
+	uint64_t granule = 0;
+	for (size_t idx = 0; idx < _packets.size(); ++idx) {
+		auto& packet = _packets[idx];
+		bool  block  = _blockflags[packet.mode];
+		if (idx) {
+			bool previous = _blockflags[_packets[idx - 1].mode];
+			granule += ((1ull << (previous ? blocksize_1 : blocksize_0)) + (1ull << (block ? blocksize_1 : blocksize_0))) / 4;
+		}
+		packet.granule = granule;
+
+		if (_mod_packets) {
+			if (block) {
+				packet.prev = idx && _blockflags[_packets[idx - 1].mode];
+				packet.next = ((idx + 1) < _packets.size()) && _blockflags[_packets[idx + 1].mode];
+			}
+			// One bit for the packet type, and two for the window flags of long blocks.
+			packet.out_size = static_cast<uint32_t>((packet.size * 8 + 1 + (block ? 2 : 0) + 7) / 8);
+		}
+	}
+	if (!_packets.empty() && sample_count && (sample_count < _packets.back().granule)) {
+		_packets.back().granule = sample_count;
+	}
+
+	_size = ogg_size(_identification.size()) + ogg_size(_comment.size()) + ogg_size(_setup.size());
+	for (auto const& packet : _packets) {
+		_size += ogg_size(packet.out_size);
+	}
+}
+
+size_t hellextractor::wem_vorbis::size() const
+{
+	return _size;
+}
+
+void hellextractor::wem_vorbis::write(std::ostream& stream) const
+{
+	uint32_t sequence = 0;
+	ogg_write(stream, sequence, _identification.data(), _identification.size(), 0, true, false);
+	ogg_write(stream, sequence, _comment.data(), _comment.size(), 0, false, false);
+	ogg_write(stream, sequence, _setup.data(), _setup.size(), 0, false, _packets.empty());
+
+	std::vector<uint8_t> buffer;
+	for (size_t idx = 0; idx < _packets.size(); ++idx) {
+		build(_packets[idx], buffer);
+		ogg_write(stream, sequence, buffer.data(), buffer.size(), _packets[idx].granule, false, (idx + 1) == _packets.size());
+	}
+}
+
+void hellextractor::wem_vorbis::rebuild_setup(uint8_t const* data, size_t size, uint8_t channels, vorbis_codebooks const& codebooks)
+{
+	bit_reader reader{data, size};
+	bit_writer writer{_setup};
+	writer.header(5);
+
+	uint32_t codebook_count = writer.copy(reader, 8) + 1;
+	for (uint32_t idx = 0; idx < codebook_count; ++idx) {
+		auto codebook = codebooks.at(reader.get(10));
+		rebuild_codebook(writer, codebook.first, codebook.second);
+	}
+
+	// Time domain transforms, unused and stripped by Wwise.
+	writer.put(0, 6);
+	writer.put(0, 16);
+
+	uint32_t floor_count = writer.copy(reader, 6) + 1;
+	for (uint32_t idx = 0; idx < floor_count; ++idx) {
+		writer.put(1, 16); // Always floor type 1.
+
+		uint32_t             partitions = writer.copy(reader, 5);
+		std::vector<uint8_t> partition_classes(partitions);
+		uint32_t             maximum_class = 0;
+		for (auto& partition_class : partition_classes) {
+			partition_class = static_cast<uint8_t>(writer.copy(reader, 4));
+			maximum_class   = std::max<uint32_t>(maximum_class, partition_class);
+		}
+
+		std::vector<uint8_t> class_dimensions(maximum_class + 1);
+		for (auto& dimensions : class_dimensions) {
+			dimensions          = static_cast<uint8_t>(writer.copy(reader, 3) + 1);
+			uint32_t subclasses = writer.copy(reader, 2);
+			if (subclasses && (writer.copy(reader, 8) >= codebook_count)) {
+				throw std::runtime_error("Floor uses an unknown master book.");
+			}
+			for (uint32_t sdx = 0; sdx < (1u << subclasses); ++sdx) {
+				uint32_t book = writer.copy(reader, 8);
+				if (book && ((book - 1) >= codebook_count)) {
+					throw std::runtime_error("Floor uses an unknown subclass book.");
+				}
+			}
+		}
+
+		writer.copy(reader, 2); // Multiplier
+		uint32_t range_bits = writer.copy(reader, 4);
+		for (auto partition_class : partition_classes) {
+			for (uint32_t ddx = 0; ddx < class_dimensions[partition_class]; ++ddx) {
+				writer.copy(reader, range_bits);
+			}
+		}
+	}
+
+	uint32_t residue_count = writer.copy(reader, 6) + 1;
+	for (uint32_t idx = 0; idx < residue_count; ++idx) {
+		uint32_t type = reader.get(2);
+		if (type > 2) {
+			throw std::runtime_error("Residue uses an unknown type.");
+		}
+		writer.put(type, 16);
+
+		writer.copy(reader, 24); // Begin
+		writer.copy(reader, 24); // End
+		writer.copy(reader, 24); // Partition size
+		uint32_t classifications = writer.copy(reader, 6) + 1;
+		if (writer.copy(reader, 8) >= codebook_count) {
+			throw std::runtime_error("Residue uses an unknown class book.");
+		}
+
+		std::vector<uint8_t> cascade(classifications);
+		for (auto& entry : cascade) {
+			entry = static_cast<uint8_t>(writer.copy(reader, 3));
+			if (writer.copy(reader, 1)) {
+				entry |= static_cast<uint8_t>(writer.copy(reader, 5) << 3);
+			}
+		}
+		for (auto entry : cascade) {
+			for (uint32_t bit = 0; bit < 8; ++bit) {
+				if ((entry & (1u << bit)) && (writer.copy(reader, 8) >= codebook_count)) {
+					throw std::runtime_error("Residue uses an unknown book.");
+				}
+			}
+		}
+	}
+
+	uint32_t mapping_count = writer.copy(reader, 6) + 1;
+	for (uint32_t idx = 0; idx < mapping_count; ++idx) {
+		writer.put(0, 16); // Always mapping type 0.
+
+		uint32_t submaps = 1;
+		if (writer.copy(reader, 1)) {
+			submaps = writer.copy(reader, 4) + 1;
+		}
+		if (writer.copy(reader, 1)) { // Square polar coupling
+			uint32_t steps = writer.copy(reader, 8) + 1;
+			uint32_t bits  = ilog(channels - 1u);
+			for (uint32_t sdx = 0; sdx < steps; ++sdx) {
+				uint32_t magnitude = writer.copy(reader, bits);
+				uint32_t angle     = writer.copy(reader, bits);
+				if ((magnitude == angle) || (magnitude >= channels) || (angle >= channels)) {
+					throw std::runtime_error("Mapping has invalid channel coupling.");
+				}
+			}
+		}
+		if (writer.copy(reader, 2) != 0) {
+			throw std::runtime_error("Mapping has reserved bits set.");
+		}
+		if (submaps > 1) {
+			for (uint32_t cdx = 0; cdx < channels; ++cdx) {
+				if (writer.copy(reader, 4) >= submaps) {
+					throw std::runtime_error("Mapping uses an unknown submap.");
+				}
+			}
+		}
+		for (uint32_t sdx = 0; sdx < submaps; ++sdx) {
+			writer.copy(reader, 8); // Time configuration
+			if (writer.copy(reader, 8) >= floor_count) {
+				throw std::runtime_error("Mapping uses an unknown floor.");
+			}
+			if (writer.copy(reader, 8) >= residue_count) {
+				throw std::runtime_error("Mapping uses an unknown residue.");
+			}
+		}
+	}
+
+	uint32_t mode_count = writer.copy(reader, 6) + 1;
+	_mode_bits          = static_cast<uint8_t>(ilog(mode_count - 1));
+	_blockflags.resize(mode_count);
+	for (uint32_t idx = 0; idx < mode_count; ++idx) {
+		_blockflags[idx] = writer.copy(reader, 1) != 0;
+		writer.put(0, 16); // Window type
+		writer.put(0, 16); // Transform type
+		if (writer.copy(reader, 8) >= mapping_count) {
+			throw std::runtime_error("Mode uses an unknown mapping.");
+		}
+	}
+
+	writer.put(1, 1); // Framing
+}
+
+void hellextractor::wem_vorbis::build(packet_t const& packet, std::vector<uint8_t>& out) const
+{
+	out.clear();
+	out.reserve(packet.out_size);
+	if (!_mod_packets) {
+		out.insert(out.end(), packet.data, packet.data + packet.size);
+		return;
+	}
+
+	// Restore the packet type and window flags in front of the mode number, then shift the rest of the packet along.
+	bit_writer writer{out};
+	writer.put(0, 1);
+	writer.put(packet.mode, _mode_bits);
+	if (_blockflags[packet.mode]) {
+		writer.put(packet.prev, 1);
+		writer.put(packet.next, 1);
+	}
+	writer.put(packet.data[0] >> _mode_bits, 8 - _mode_bits);
+	writer.bytes(packet.data + 1, packet.size - 1);
+}
@@ -0,0 +1,82 @@
+// Copyright 2024 Michael Fabian 'Xaymar' Dirks <info@xaymar.com>
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#pragma once
+#include <cinttypes>
+#include <cstddef>
+#include <filesystem>
+#include <ostream>
+#include <utility>
+#include <vector>
+
+namespace hellextractor {
+	/** Packed Vorbis codebook library, as referenced by the setup header of Wwise Vorbis streams.
+	 *
+	 * The file is a concatenation of packed codebooks followed by a table of their offsets, with the position of that
+	 * table stored in the last four bytes (such as packed_codebooks_aoTuV_603.bin).
+	 */
+	class vorbis_codebooks {
+		std::vector<uint8_t>  _data;
+		std::vector<uint32_t> _offsets;
+
+		public:
+		~vorbis_codebooks();
+		vorbis_codebooks(std::filesystem::path const& path);
+
+		size_t size() const;
+
+		/** Packed codebook with the given id. Throws std::out_of_range for unknown ids. */
+		std::pair<uint8_t const*, size_t> at(size_t id) const;
+	};
+
+	/** Wwise Vorbis (.wem) to Ogg Vorbis transcoder.
+	 *
+	 * Construction parses the RIFF headers, rebuilds the three standard Vorbis header packets and plans every audio
+	 * packet, so the exact size of the Ogg stream is known up front. write() then streams one page per packet straight
+	 * from the source data, without ever holding more than a single packet in memory.
+	 */
+	class wem_vorbis {
+		struct packet_t {
+			uint8_t const* data;
+			uint32_t       size;
+			uint32_t       out_size;
+			uint64_t       granule;
+			uint8_t        mode;
+			bool           prev;
+			bool           next;
+		};
+
+		std::vector<uint8_t>  _identification;
+		std::vector<uint8_t>  _comment;
+		std::vector<uint8_t>  _setup;
+		std::vector<packet_t> _packets;
+		std::vector<bool>     _blockflags;
+		uint8_t               _mode_bits;
+		bool                  _mod_packets;
+		size_t                _size;
+
+		public:
+		~wem_vorbis();
+
+		/** Throws std::runtime_error if the data isn't a supported Wwise Vorbis stream. */
+		wem_vorbis(uint8_t const* data, size_t size, vorbis_codebooks const& codebooks);
+
+		/** Exact size of the Ogg stream in bytes. */
+		size_t size() const;
+
+		void write(std::ostream& stream) const;
+
+		private:
+		void rebuild_setup(uint8_t const* data, size_t size, uint8_t channels, vorbis_codebooks const& codebooks);
+
+		void build(packet_t const& packet, std::vector<uint8_t>& out) const;
+	};
+} // namespace hellextractor